@@ -0,0 +1,28 @@
+#ifndef PLIKE_BENCH_UTIL_H
+#define PLIKE_BENCH_UTIL_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+// Helpers shared by the benchmarks. Each benchmark is a program of its
+// own, so they are defined here rather than linked in.
+
+static inline double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Creates path and has write fill it in, passing context along. False if
+// the file couldn't be created or written.
+static inline bool write_program(const char* path, void (*write)(FILE* file, const void* context),
+                                 const void* context) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    write(file, context);
+    bool written = !ferror(file);
+    return fclose(file) == 0 && written;
+}
+
+#endif // PLIKE_BENCH_UTIL_H
@@ -0,0 +1,315 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "parser.h"
+#include "errors.h"
+#include "config.h"
+#include "bench_util.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Expression parser benchmark
+// Checks that the precedence climbing parser groups a set of expressions
+// the way the grammar says and reports a set of broken ones without
+// crashing, then times it on an expression-heavy program
+// and measures how much stack each level of parenthesized nesting costs.
+
+#define BENCH_STATEMENTS 50000
+#define BENCH_ROUNDS 5
+#define BENCH_NESTING 2000
+#define BENCH_STACK_SIZE (64 * 1024 * 1024)
+#define STACK_FILL 0xA5
+
+static const struct { const char* source; const char* grouping; } cases[] = {
+    {"a + b * c", "(a + (b * c))"},
+    {"a - b - c", "((a - b) - c)"},
+    {"a / b * c % d", "(((a / b) * c) % d)"},
+    {"a < b == c > d", "((a < b) == (c > d))"},
+    {"a << 1 == b", "(a << (1 == b))"},
+    {"a & b ^ c | d", "(((a & b) ^ c) | d)"},
+    {"a | b && c || d", "(((a | b) && c) || d)"},
+    {"a || b && c", "(a || (b && c))"},
+    {"-a * b", "((-a) * b)"},
+    {"!a && ~b", "((!a) && (~b))"},
+    {"(a + b) * c", "((a + b) * c)"},
+    {"a >> b << c", "((a >> b) << c)"},
+    {"a == b != c", "((a == b) != c)"},
+    {"a + b * c - d / e <= f && a != 0", "((((a + (b * c)) - (d / e)) <= f) && (a != 0))"},
+};
+
+// Each is reported, and parsing goes on with the next statement
+static const char* broken_cases[] = {
+    "(a .LE. 2) .OR. (b .GT. 3)",
+    "a.b + c",
+    "a. + b",
+    "(a + b).c",
+};
+
+static const char* expression_lines[] = {
+    "        x := a + b * c - d / e % f\n",
+    "        x := (a + b) * (c - d) / (e + 1)\n",
+    "        x := a < b && c >= d || e != f\n",
+    "        x := a << 2 | b >> 1 & c ^ d\n",
+    "        x := -a * -b + ~c - !d\n",
+    "        x := a * b + c * d + e * f + a * c + b * d\n",
+    "        x := ((a + b) * (c + d) - (e + f)) * 2 + 1\n",
+};
+
+static void write_prologue(FILE* file) {
+    fputs("procedure Main()\n    var a, b, c, d, e, f, x : integer\n    begin\n", file);
+}
+
+static void write_epilogue(FILE* file) {
+    fputs("    end\nend Main\n", file);
+}
+
+static const char* op_text(TokenType op) {
+    switch (op) {
+        case TOK_OR: return "||";
+        case TOK_AND: return "&&";
+        case TOK_BITOR: return "|";
+        case TOK_BITXOR: return "^";
+        case TOK_BITAND: return "&";
+        case TOK_LSHIFT: return "<<";
+        case TOK_RSHIFT: return ">>";
+        case TOK_EQ: return "==";
+        case TOK_NE: return "!=";
+        case TOK_LT: return "<";
+        case TOK_GT: return ">";
+        case TOK_LE: return "<=";
+        case TOK_GE: return ">=";
+        case TOK_PLUS: return "+";
+        case TOK_MINUS: return "-";
+        case TOK_MULTIPLY: return "*";
+        case TOK_DIVIDE: return "/";
+        case TOK_MOD: return "%";
+        case TOK_NOT: return "!";
+        case TOK_BITNOT: return "~";
+        default: return "?";
+    }
+}
+
+// Writes node fully parenthesized
+static void render(const ASTNode* node, char* out, size_t size) {
+    size_t used = strlen(out);
+    if (used + 1 >= size) return;
+    switch (node->type) {
+        case NODE_BINARY_OP:
+            strncat(out, "(", size - used - 1);
+            render(node->children[0], out, size);
+            used = strlen(out);
+            snprintf(out + used, size - used, " %s ", op_text(node->data.binary_op.op));
+            render(node->children[1], out, size);
+            used = strlen(out);
+            strncat(out, ")", size - used - 1);
+            break;
+        case NODE_UNARY_OP:
+            snprintf(out + used, size - used, "(%s", op_text(node->data.unary_op.op));
+            render(node->children[0], out, size);
+            used = strlen(out);
+            strncat(out, ")", size - used - 1);
+            break;
+        default:
+            strncat(out, node->data.value ? node->data.value : "?", size - used - 1);
+            break;
+    }
+}
+
+static void collect_assignments(ASTNode* node, ASTNode** found, size_t* count, size_t max) {
+    if (!node) return;
+    if (node->type == NODE_ASSIGNMENT && *count < max) {
+        found[(*count)++] = node;
+        return;
+    }
+    if (node->type == NODE_FUNCTION || node->type == NODE_PROCEDURE) {
+        collect_assignments(node->data.function.body, found, count, max);
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        collect_assignments(node->children[i], found, count, max);
+    }
+}
+
+static void write_grouping_cases(FILE* file, const void* context) {
+    (void)context;
+    write_prologue(file);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        fprintf(file, "        x := %s\n", cases[i].source);
+    }
+    write_epilogue(file);
+}
+
+static bool check_grouping(const char* path) {
+    size_t case_count = sizeof(cases) / sizeof(cases[0]);
+    if (!write_program(path, write_grouping_cases, NULL)) return false;
+
+    Lexer* lexer = lexer_create(path);
+    if (!lexer) return false;
+    Parser* parser = parser_create(lexer);
+    ASTNode* ast = parser ? parser_parse(parser) : NULL;
+
+    ASTNode* found[sizeof(cases) / sizeof(cases[0])];
+    size_t count = 0;
+    collect_assignments(ast, found, &count, case_count);
+
+    bool ok = ast && error_count() == 0 && count == case_count;
+    for (size_t i = 0; ok && i < case_count; i++) {
+        char text[256] = "";
+        render(found[i]->children[1], text, sizeof(text));
+        if (strcmp(text, cases[i].grouping) != 0) {
+            printf("  MISMATCH: %s parsed as %s, expected %s\n", cases[i].source, text, cases[i].grouping);
+            ok = false;
+        }
+    }
+    if (parser) parser_destroy(parser);
+    lexer_destroy(lexer);
+    return ok;
+}
+
+// Each broken case in a statement of its own, followed by a good one
+static void write_broken_cases(FILE* file, const void* context) {
+    (void)context;
+    write_prologue(file);
+    for (size_t i = 0; i < sizeof(broken_cases) / sizeof(broken_cases[0]); i++) {
+        fprintf(file, "        x := %s\n        x := a\n", broken_cases[i]);
+    }
+    write_epilogue(file);
+}
+
+// True if every broken case was reported and the parse got to the end
+static bool check_recovery(const char* path) {
+    size_t case_count = sizeof(broken_cases) / sizeof(broken_cases[0]);
+    if (!write_program(path, write_broken_cases, NULL)) return false;
+
+    Lexer* lexer = lexer_create(path);
+    if (!lexer) return false;
+    Parser* parser = parser_create(lexer);
+    error_mute();
+    ASTNode* ast = parser ? parser_parse(parser) : NULL;
+    int errors = error_unmute();
+    bool ok = ast && errors >= (int)case_count && parser->ctx.current->type == TOK_EOF;
+    if (parser) parser_destroy(parser);
+    lexer_destroy(lexer);
+    return ok;
+}
+
+// Parses path once per round; returns statements per second
+static double bench_parse(const char* path, size_t statements) {
+    double best = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        double start = now_seconds();
+        Lexer* lexer = lexer_create(path);
+        if (!lexer) return 0;
+        Parser* parser = parser_create(lexer);
+        if (!parser) {
+            lexer_destroy(lexer);
+            return 0;
+        }
+        ASTNode* ast = parser_parse(parser);
+        double rate = statements / (now_seconds() - start);
+        if (!ast) rate = 0;
+        if (rate > best) best = rate;
+        parser_destroy(parser);
+        lexer_destroy(lexer);
+    }
+    return best;
+}
+
+static void* parse_thread(void* path) {
+    Lexer* lexer = lexer_create(path);
+    if (!lexer) return NULL;
+    Parser* parser = parser_create(lexer);
+    if (parser) {
+        parser_parse(parser);
+        parser_destroy(parser);
+    }
+    lexer_destroy(lexer);
+    return NULL;
+}
+
+// Parses path on a thread whose stack starts out filled with a pattern, and
+// returns how many bytes of it were touched
+static size_t stack_high_water(const char* path) {
+    unsigned char* stack = malloc(BENCH_STACK_SIZE);
+    if (!stack) return 0;
+    memset(stack, STACK_FILL, BENCH_STACK_SIZE);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, BENCH_STACK_SIZE);
+    pthread_t thread;
+    size_t used = 0;
+    if (pthread_create(&thread, &attr, parse_thread, (void*)path) == 0) {
+        pthread_join(thread, NULL);
+        size_t untouched = 0;
+        while (untouched < BENCH_STACK_SIZE && stack[untouched] == STACK_FILL) untouched++;
+        used = BENCH_STACK_SIZE - untouched;
+    }
+    pthread_attr_destroy(&attr);
+    free(stack);
+    return used;
+}
+
+// context points at the nesting depth
+static void write_nested(FILE* file, const void* context) {
+    int depth = *(const int*)context;
+    write_prologue(file);
+    fputs("        x := ", file);
+    for (int i = 0; i < depth; i++) fputc('(', file);
+    fputs("a + 1", file);
+    for (int i = 0; i < depth; i++) fputc(')', file);
+    fputc('\n', file);
+    write_epilogue(file);
+}
+
+static size_t nesting_stack(const char* path, int depth) {
+    if (!write_program(path, write_nested, &depth)) return 0;
+    return stack_high_water(path);
+}
+
+static void write_expressions(FILE* file, const void* context) {
+    (void)context;
+    write_prologue(file);
+    size_t line_count = sizeof(expression_lines) / sizeof(expression_lines[0]);
+    for (size_t i = 0; i < BENCH_STATEMENTS; i++) {
+        fputs(expression_lines[i % line_count], file);
+    }
+    write_epilogue(file);
+}
+
+int main(void) {
+    config_init();
+
+    const char* path = "bench_expr.plike";
+    int status = 0;
+
+    printf("=== Expression parser ===\n");
+    if (check_grouping(path)) {
+        printf("  grouping: %zu expressions as expected\n", sizeof(cases) / sizeof(cases[0]));
+    } else {
+        printf("  MISMATCH: expressions grouped differently from the grammar\n");
+        status = 1;
+    }
+    if (check_recovery(path)) {
+        printf("  recovery: %zu broken expressions reported\n", sizeof(broken_cases) / sizeof(broken_cases[0]));
+    } else {
+        printf("  FAILED: broken expressions were not all reported\n");
+        status = 1;
+    }
+
+    if (!write_program(path, write_expressions, NULL)) {
+        fprintf(stderr, "Could not create %s\n", path);
+        return 1;
+    }
+
+    double rate = bench_parse(path, BENCH_STATEMENTS);
+    printf("  %-22s %12.0f statements/sec\n", "parse", rate);
+
+    size_t shallow = nesting_stack(path, 1);
+    size_t deep = nesting_stack(path, BENCH_NESTING + 1);
+    printf("  %-22s %12.0f bytes of stack per level\n", "parenthesized nesting",
+           (double)(deep - shallow) / BENCH_NESTING);
+
+    remove(path);
+    return status;
+}
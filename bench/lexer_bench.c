@@ -0,0 +1,115 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "lexer.h"
+#include "config.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Lexer benchmark
+// Lexes a generated program with every operator style's tables. Then lexes
+// it ahead on several threads and checks that against scanning on demand.
+
+#define BENCH_STATEMENTS 200000
+#define BENCH_ROUNDS 5
+
+static const char* sample_lines[] = {
+    "    total := total + values[i] * 2\n",
+    "    if count >= 10 and not done then\n",
+    "    x := .not. (a .and. b) .or. c\n",
+    "    mask := (flags & 0xFF00) >> 8 | 0b1010\n",
+    "    ratio := 3.14159 / 2.0 - 1.5f\n",
+    "    procedure Swap(in/out a: integer, in/out b: integer)\n",
+    "    for k := 1 to n step 2 do // walk the odd entries\n",
+    "    var matrix : 2d array [1..n, 1..m] of real\n",
+    "    print(\"value: \", result)\n",
+    "    /* block comment */ p := *node\n",
+    "    /* a comment that\n       runs over two lines */ q := &node\n",
+    "    endwhile\n",
+    "    while left <= right and data[mid] != target do\n",
+};
+
+static void write_statements(FILE* file, const void* context) {
+    (void)context;
+    size_t line_count = sizeof(sample_lines) / sizeof(sample_lines[0]);
+    for (size_t i = 0; i < BENCH_STATEMENTS; i++) {
+        fputs(sample_lines[(i * 5) % line_count], file);
+    }
+}
+
+// Lexes path once per round, on threads threads when that is more than
+// one; returns tokens per second and leaves the token count and a checksum
+// of the stream in *tokens and *checksum
+static double bench_scanner(const char* path, int threads, size_t* tokens, unsigned long* checksum) {
+    double best = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        Lexer* lexer = lexer_create(path);
+        if (!lexer) return 0;
+
+        size_t count = 0;
+        unsigned long sum = 0;
+        double start = now_seconds();
+        if (threads > 1) lexer_lex_parallel(lexer, threads);
+        for (;;) {
+            Token* token = lexer_next_token(lexer);
+            if (!token) continue;
+            if (token->type == TOK_EOF) break;
+            count++;
+            sum = sum * 31 + (unsigned long)token->type * 7 + token->offset + token->length +
+                  (unsigned long)token->loc.line * 13 + (unsigned long)token->loc.column;
+        }
+        double rate = count / (now_seconds() - start);
+        if (rate > best) best = rate;
+        *tokens = count;
+        *checksum = sum;
+        lexer_destroy(lexer);
+    }
+    return best;
+}
+
+int main(void) {
+    config_init();
+
+    const char* path = "bench_lexer.plike";
+    if (!write_program(path, write_statements, NULL)) {
+        fprintf(stderr, "Could not create %s\n", path);
+        return 1;
+    }
+
+    const struct { const char* name; const Keyword* table; } styles[] = {
+        {"standard", keywords_standard},
+        {"dotted", keywords_dotted},
+        {"mixed", keywords_mixed},
+    };
+
+    int status = 0;
+    printf("=== Lexer: operator styles ===\n");
+    for (size_t s = 0; s < sizeof(styles) / sizeof(styles[0]); s++) {
+        keywords = styles[s].table;
+        size_t tokens = 0;
+        unsigned long sum = 0;
+        double rate = bench_scanner(path, 1, &tokens, &sum);
+        printf("  %-22s %12.0f tokens/sec (%zu tokens)\n", styles[s].name, rate, tokens);
+    }
+
+    keywords = keywords_mixed;
+    printf("=== Lexer: threads ===\n");
+    size_t serial_tokens = 0;
+    unsigned long serial_sum = 0;
+    double serial = bench_scanner(path, 1, &serial_tokens, &serial_sum);
+    printf("  %-22s %12.0f tokens/sec\n", "on demand", serial);
+    for (int threads = 2; threads <= 8; threads *= 2) {
+        size_t parallel_tokens = 0;
+        unsigned long parallel_sum = 0;
+        double parallel = bench_scanner(path, threads, &parallel_tokens, &parallel_sum);
+        printf("  %2d threads %11s %12.0f tokens/sec (%.2fx)\n", threads, "", parallel, parallel / serial);
+        if (parallel_tokens != serial_tokens || parallel_sum != serial_sum) {
+            printf("  MISMATCH: parallel lexing disagrees on the token stream\n");
+            status = 1;
+        }
+    }
+
+    remove(path);
+    return status;
+}
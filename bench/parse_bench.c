@@ -0,0 +1,168 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "parser.h"
+#include "errors.h"
+#include "config.h"
+#include "bench_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Parse benchmark
+// Parses a program made of many procedures, each calling the ones either
+// side of it, with --jobs set to 1, 2, 4 and 8, and checks that every run builds
+// the same tree, resolves the same calls and looks up as many names. Then times
+// a signature-only parse, and one that expands every body afterwards, which
+// has to build the same tree again.
+
+#define BENCH_PROCEDURES 4000
+#define BENCH_STATEMENTS 40
+#define BENCH_ROUNDS 5
+
+static const char* body_lines[] = {
+    "        x := a + b * c - d / e\n",
+    "        if x > a and b != c then\n            x := x - 1\n        endif\n",
+    "        for i := 1 to n do\n            x := x + values[i]\n        endfor\n",
+    "        while x < n do\n            x := (x + 1) * 2\n        endwhile\n",
+};
+
+static void write_procedures(FILE* file, const void* context) {
+    (void)context;
+    size_t line_count = sizeof(body_lines) / sizeof(body_lines[0]);
+    for (int p = 0; p < BENCH_PROCEDURES; p++) {
+        fprintf(file, "procedure Work_%d(in: n)\n", p);
+        fputs("    var a, b, c, d, e, i, n, x : integer\n", file);
+        fputs("    var values : array [1..n] of integer\n    begin\n", file);
+        for (int s = 0; s < BENCH_STATEMENTS; s++) {
+            fputs(body_lines[(size_t)(p + s) % line_count], file);
+        }
+        if (p > 0) fprintf(file, "        Work_%d(x)\n", p - 1);
+        if (p + 1 < BENCH_PROCEDURES) fprintf(file, "        Work_%d(x)\n", p + 1);
+        // Nested blocks followed by a call to the procedure itself look like
+        // 'end end Work_N' to a signature-only parse, short of the real end
+        fputs("        begin\n            begin\n                x := 1\n            end\n        end\n", file);
+        fprintf(file, "        Work_%d(x)\n", p);
+        fprintf(file, "    end\nend Work_%d\n\n", p);
+    }
+}
+
+// Adds up the shape of the tree and which names it resolved, so runs can
+// be compared
+static unsigned long checksum(const ASTNode* node) {
+    if (!node) return 1;
+    unsigned long sum = (unsigned long)node->type * 31 + (unsigned long)node->child_count +
+                        (ast_symbol(node) ? 5 : 0);
+    if (node->type == NODE_FUNCTION || node->type == NODE_PROCEDURE) {
+        sum = sum * 17 + checksum(node->data.function.body);
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        sum = sum * 7 + checksum(node->children[i]);
+    }
+    return sum;
+}
+
+// Lexes ahead and parses path on jobs threads once per round; returns
+// procedures per second and leaves the tree's checksum in *sum and the
+// number of symbol lookups in *lookups
+static double bench_parse(const char* path, int jobs, unsigned long* sum, size_t* lookups) {
+    g_config.jobs = jobs;
+    double best = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        Lexer* lexer = lexer_create(path);
+        if (!lexer) return 0;
+        Parser* parser = parser_create(lexer);
+        if (!parser) {
+            lexer_destroy(lexer);
+            return 0;
+        }
+        lexer_lex_parallel(lexer, jobs > 1 ? jobs : 2);
+        double start = now_seconds();
+        ASTNode* ast = parser_parse(parser);
+        double rate = BENCH_PROCEDURES / (now_seconds() - start);
+        if (!ast || error_count() != 0) rate = 0;
+        if (rate > best) best = rate;
+        *sum = checksum(ast);
+        *lookups = parser->ctx.symbols->lookups;
+        parser_destroy(parser);
+        lexer_destroy(lexer);
+    }
+    return best;
+}
+
+// Parses path for signatures only once per round, expanding every body
+// afterwards if expand is set
+static double bench_lazy(const char* path, bool expand, unsigned long* sum) {
+    g_config.jobs = 1;
+    g_config.check_signatures = true;
+    double best = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        Lexer* lexer = lexer_create(path);
+        if (!lexer) break;
+        Parser* parser = parser_create(lexer);
+        if (!parser) {
+            lexer_destroy(lexer);
+            break;
+        }
+        lexer_lex_parallel(lexer, 2);
+        double start = now_seconds();
+        ASTNode* ast = parser_parse(parser);
+        bool ok = ast && (!expand || parser_expand_bodies(parser));
+        double rate = BENCH_PROCEDURES / (now_seconds() - start);
+        if (!ok || error_count() != 0) rate = 0;
+        if (rate > best) best = rate;
+        *sum = checksum(ast);
+        parser_destroy(parser);
+        lexer_destroy(lexer);
+    }
+    g_config.check_signatures = false;
+    return best;
+}
+
+int main(void) {
+    config_init();
+
+    const char* path = "bench_parse.plike";
+    if (!write_program(path, write_procedures, NULL)) {
+        fprintf(stderr, "Could not create %s\n", path);
+        return 1;
+    }
+
+    int status = 0;
+    printf("=== Parser: threads (%d procedures) ===\n", BENCH_PROCEDURES);
+    unsigned long serial_sum = 0;
+    size_t serial_lookups = 0;
+    double serial = bench_parse(path, 1, &serial_sum, &serial_lookups);
+    printf("  %-22s %12.0f procedures/sec\n", "serial", serial);
+    for (int jobs = 2; jobs <= 8; jobs *= 2) {
+        unsigned long parallel_sum = 0;
+        size_t parallel_lookups = 0;
+        double parallel = bench_parse(path, jobs, &parallel_sum, &parallel_lookups);
+        printf("  %2d threads %11s %12.0f procedures/sec (%.2fx)\n", jobs, "", parallel, parallel / serial);
+        if (parallel_sum != serial_sum) {
+            printf("  MISMATCH: parallel parsing built a different tree\n");
+            status = 1;
+        }
+        if (parallel_lookups != serial_lookups) {
+            printf("  MISMATCH: parallel parsing did %zu symbol lookups, not %zu\n",
+                   parallel_lookups, serial_lookups);
+            status = 1;
+        }
+    }
+
+    printf("=== Parser: signatures only ===\n");
+    unsigned long lazy_sum = 0;
+    double lazy = bench_lazy(path, false, &lazy_sum);
+    printf("  %-22s %12.0f procedures/sec (%.2fx)\n", "signatures", lazy, lazy / serial);
+    double expanded = bench_lazy(path, true, &lazy_sum);
+    printf("  %-22s %12.0f procedures/sec (%.2fx)\n", "expanded afterwards", expanded, expanded / serial);
+    if (lazy == 0 || expanded == 0) {
+        printf("  FAILED: the signature-only parse reported errors\n");
+        status = 1;
+    } else if (lazy_sum != serial_sum) {
+        printf("  MISMATCH: expanded bodies differ from parsing them in place\n");
+        status = 1;
+    }
+
+    remove(path);
+    return status;
+}
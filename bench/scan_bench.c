@@ -0,0 +1,111 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "lexer_scan.h"
+#include "bench_util.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Scan kernel benchmark
+// Runs each bulk scanning kernel over generated input for every backend
+// this CPU supports and reports throughput in MB/s.
+
+#define BENCH_BYTES (16 * 1024 * 1024)
+#define BENCH_ROUNDS 5
+
+// Runs of blanks, identifiers, line comments and block comments, with
+// the odd UTF-8 comment
+static char* make_input(size_t length) {
+    static const char* pieces[] = {
+        "        ", "\t\t", " ", "total_count_value", "x", "i ", "matrix_row_index_2 ",
+        "                                ",
+        "// trailing comment text that runs to the end of the line\n",
+        "/* block comment\n   spanning a few\n   lines */",
+        "// caf\xc3\xa9 na\xc3\xafve \xe2\x80\x94 r\xc3\xa9sum\xc3\xa9\n",
+    };
+    char* buffer = malloc(length);
+    if (!buffer) return NULL;
+    size_t pos = 0;
+    unsigned seed = 1;
+    while (pos < length) {
+        seed = seed * 1103515245u + 12345u;
+        const char* piece = pieces[(seed >> 16) % (sizeof(pieces) / sizeof(pieces[0]))];
+        size_t n = strlen(piece);
+        if (n > length - pos) n = length - pos;
+        memcpy(buffer + pos, piece, n);
+        pos += n;
+    }
+    return buffer;
+}
+
+// Whether the lexer would call kernel at pos
+static bool is_kernel_start(int kernel, const char* source, size_t pos) {
+    char c = source[pos];
+    char prev = pos > 0 ? source[pos - 1] : '\n';
+    switch (kernel) {
+        case 0: return (c == ' ' || c == '\t') && prev != ' ' && prev != '\t';
+        case 1: return pos >= 2 && source[pos - 2] == '/' && prev == '/';
+        case 2: return pos >= 2 && source[pos - 2] == '/' && prev == '*';
+        case 3: return (isalnum((unsigned char)c) || c == '_') &&
+                       !(isalnum((unsigned char)prev) || prev == '_');
+        case 4: return pos == 0 || (unsigned char)prev >= 0x80;
+    }
+    return false;
+}
+
+// Calls kernel at every position the lexer would, and reports the bytes
+// it covers per second
+static double run_kernel(const LexerScanOps* ops, int kernel, const char* source, size_t length,
+                         const size_t* starts, size_t start_count) {
+    size_t covered = 0;
+    double start = now_seconds();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (size_t i = 0; i < start_count; i++) {
+            size_t pos = starts[i];
+            size_t end = pos;
+            size_t newlines = 0, last_newline = 0;
+            switch (kernel) {
+                case 0: end = ops->blank_run(source, pos, length); break;
+                case 1: end = ops->line_end(source, pos, length); break;
+                case 2: end = ops->block_comment_end(source, pos, length, &newlines, &last_newline); break;
+                case 3: end = ops->identifier_end(source, pos, length); break;
+                case 4: end = ops->ascii_run(source, pos, length); break;
+            }
+            covered += end - pos;
+        }
+    }
+    double elapsed = now_seconds() - start;
+    return (double)covered / elapsed / (1024.0 * 1024.0);
+}
+
+int main(void) {
+    static const char* kernels[] = {"blank_run", "line_end", "block_comment_end", "identifier_end",
+                                    "ascii_run"};
+    char* source = make_input(BENCH_BYTES);
+    if (!source) return 1;
+
+    size_t* starts = malloc(BENCH_BYTES * sizeof(size_t));
+    if (!starts) return 1;
+
+    printf("=== Scan kernels (selected: %s) ===\n", lexer_scan_ops()->name);
+    for (int kernel = 0; kernel < 5; kernel++) {
+        size_t start_count = 0;
+        for (size_t pos = 0; pos < BENCH_BYTES; pos++) {
+            if (is_kernel_start(kernel, source, pos)) starts[start_count++] = pos;
+        }
+        printf("%s (%zu calls)\n", kernels[kernel], start_count);
+        for (int backend = 0; backend < SCAN_BACKEND_COUNT; backend++) {
+            const LexerScanOps* ops = lexer_scan_backend((ScanBackend)backend);
+            if (!ops) continue;
+            printf("  %-22s %10.0f MB/s\n", ops->name,
+                   run_kernel(ops, kernel, source, BENCH_BYTES, starts, start_count));
+        }
+    }
+
+    free(starts);
+
+    free(source);
+    return 0;
+}
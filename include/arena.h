@@ -0,0 +1,31 @@
+#ifndef PLIKE_ARENA_H
+#define PLIKE_ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+// Bump allocator: allocations live until the whole arena is released
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t used;
+    size_t capacity;
+    char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock* head;
+    size_t block_size;
+    size_t bytes_used;
+    size_t block_count;
+} Arena;
+
+void arena_init(Arena* arena, size_t block_size);
+void* arena_alloc(Arena* arena, size_t size);
+// For types that need less than max alignment; alignment is a power of two
+void* arena_alloc_aligned(Arena* arena, size_t size, size_t alignment);
+char* arena_strndup(Arena* arena, const char* text, size_t length);
+void arena_merge(Arena* into, Arena* from);
+void arena_release(Arena* arena);
+
+#endif // PLIKE_ARENA_H
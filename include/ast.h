@@ -2,9 +2,12 @@
 #define PLIKE_AST_H
 
 #include "lexer.h"
+#include "arena.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #define MAX_ARRAY_DIMENSIONS 10
+#define AST_INLINE_CHILDREN 4   // Children held in the node before spilling to the arena
 
 typedef enum {
     NODE_PROGRAM,
@@ -87,29 +90,19 @@ typedef struct {
 typedef struct {
     char* name;
     char* type;
+    struct {
+        int dimensions;             // Number of dimensions, bounds are in ast_array_bounds()
+        bool has_dynamic_size;      // Whether any dimension uses variables
+    } array_info;
+    int pointer_level;
     bool is_array;
     bool is_pointer;
-    int pointer_level;
-    union {
-        struct {
-            int dimensions;             // Number of dimensions
-            ArrayBoundsData* bounds;    // Array bounds info, one per dimension
-            bool has_dynamic_size;      // Whether any dimension uses variables
-        } array_info;
-        struct {
-            bool is_reference;          // Whether variable is passed by reference
-        } scalar_info;
-    };
     bool is_param;
-    char* param_mode;          // "in", "out", or "inout"
-    bool is_constant;          // For const declarations
-    SourceLocation decl_loc;   // Location of declaration
+    struct Symbol* symbol;      // What the parser resolved the name to, or NULL
 } VariableData;
 
 typedef struct {
     TokenType op;
-    struct ASTNode* left;
-    struct ASTNode* right;
 } BinaryOpData;
 
 typedef struct {
@@ -119,6 +112,7 @@ typedef struct {
 
 typedef struct {
     int dimensions;
+    struct Symbol* symbol;      // The array's symbol, or NULL
 } ArrayAccessData;
 
 typedef struct {
@@ -127,6 +121,7 @@ typedef struct {
     ParameterMode mode;
     bool is_pointer;
     int pointer_level;
+    struct Symbol* symbol;
 } ParameterData;
 
 typedef struct {
@@ -147,9 +142,18 @@ typedef struct RecordTypeData {
     struct RecordTypeData* parent;  // For nested records
 } RecordTypeData;
 
+// Node locations keep their filename in a table shared by every node, so
+// they pack into 8 bytes; ast_location() unpacks one
+typedef struct {
+    uint32_t line;
+    uint16_t column;    // Saturates at UINT16_MAX
+    uint16_t file;      // 1-based index into the file table, 0 for none
+} AstLocation;
+
 typedef struct ASTNode {
     NodeType type;
-    SourceLocation loc;
+    uint32_t id;                // Key into the side tables, unique per arena
+    AstLocation loc;
     union {
         FunctionData function;
         VariableData variable;
@@ -158,13 +162,112 @@ typedef struct ASTNode {
         ArrayAccessData array_access;
         ParameterData parameter;
         char* value;  // For identifiers and literals   
+        struct {
+            char* text;             // Same slot as value
+            NumberLiteral literal;  // Decoded value
+        } number;                   // NODE_NUMBER
+        struct {
+            char* text;             // Same slot as value
+            struct Symbol* symbol;
+        } name;                     // NODE_IDENTIFIER and NODE_CALL
+    } data;
+    struct ASTNode** children;  // inline_children until they run out
+    int child_count;
+    int child_capacity;
+    struct AstArena* arena;     // Owning arena, NULL for a node from malloc()
+    struct ASTNode* inline_children[AST_INLINE_CHILDREN];
+} ASTNode;
+
+// ASTNode as it was with record and bounds payloads, number literals and
+// full locations inline. --stats compares against its size.
+typedef struct {
+    NodeType type;
+    SourceLocation loc;
+    union {
+        FunctionData function;
+        struct {
+            char* name;
+            char* type;
+            bool is_array;
+            bool is_pointer;
+            int pointer_level;
+            struct {
+                int dimensions;
+                ArrayBoundsData* bounds;
+                bool has_dynamic_size;
+            } array_info;
+            bool is_param;
+            char* param_mode;
+            bool is_constant;
+            SourceLocation decl_loc;
+        } variable;
+        struct {
+            TokenType op;
+            struct ASTNode* left;
+            struct ASTNode* right;
+        } binary_op;
+        char* value;
     } data;
     RecordTypeData record_type;
     ArrayBoundsData array_bounds;
+    NumberLiteral number;
     struct ASTNode** children;
     int child_count;
     int child_capacity;
-} ASTNode;
+    struct AstArena* arena;
+    struct ASTNode* inline_children[AST_INLINE_CHILDREN];
+} AstUnpackedNode;
+
+// Payloads only a few node types carry, keyed by node id
+typedef struct {
+    uint32_t* keys;             // Node ids, 0 for an empty slot
+    void** values;
+    size_t count;
+    size_t capacity;            // Power of two
+} AstSideTable;
+
+// Every node of a translation unit, with its spilled child arrays,
+// strings and record payloads, lives in one arena and is freed with it.
+// Array bounds stay on the heap, owned by the bounds side table.
+typedef struct AstArena {
+    Arena arena;
+    AstSideTable records;       // RecordTypeData, allocated in the arena
+    AstSideTable bounds;        // ArrayBoundsData, owned heap allocations
+    size_t node_count;
+    size_t spilled;             // Child arrays that outgrew the inline slots
+    size_t child_bytes;         // Bytes of spilled child arrays
+    size_t string_bytes;        // Bytes of strings copied by ast_strdup()
+    size_t payload_bytes;       // Bytes of record payloads
+} AstArena;
+
+// Where an AST arena's bytes went, for --stats
+typedef struct {
+    size_t nodes;
+    size_t node_bytes;
+    size_t child_bytes;
+    size_t side_bytes;          // Record payloads and the side table indexes
+    size_t bounds_bytes;        // Array bounds, on the heap
+    size_t string_bytes;
+} AstStats;
+
+// AST arenas. New nodes come from the arena in use, or from malloc() when
+// there is none; ast_destroy_node() leaves arena nodes to the arena.
+void ast_arena_init(AstArena* arena);
+void ast_arena_release(AstArena* arena);
+AstArena* ast_use_arena(AstArena* arena);
+char* ast_strdup(const char* text);
+char* ast_strcat(const char* prefix, const char* text);
+AstStats ast_arena_stats(const AstArena* arena);
+
+// Side tables. ast_record_type() adds an empty payload on first use;
+// ast_set_array_bounds() takes ownership of bounds.
+RecordTypeData* ast_record_type(ASTNode* node);
+ArrayBoundsData* ast_array_bounds(const ASTNode* node);
+bool ast_set_array_bounds(ASTNode* node, ArrayBoundsData* bounds);
+
+// The symbol the parser resolved a variable, identifier, parameter, call
+// or array access to, kept in the node's payload. Other nodes have none.
+struct Symbol* ast_symbol(const ASTNode* node);
 
 // AST functions
 ASTNode* ast_create_node(NodeType type);
@@ -179,4 +282,7 @@ bool ast_is_node_type(const ASTNode* node, NodeType type);
 const char* ast_node_type_to_string(ASTNode* node);
 char* ast_to_string(const ASTNode* node);
 void ast_set_location(ASTNode* node, SourceLocation loc);
+SourceLocation ast_location(const ASTNode* node);
+// Registering a filename up front lets other threads set locations in it
+void ast_register_file(const char* filename);
 #endif // PLIKE_AST_H
\ No newline at end of file
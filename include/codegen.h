@@ -19,6 +19,8 @@ typedef struct {
         int dimensions;
         int current_dim;
     } array_context;
+    struct CallSite* forward_calls;     // --stream: calls to functions not declared yet
+    size_t forward_call_count;
 } CodeGenerator;
 
 // Generator creation/destruction
@@ -28,6 +30,14 @@ void codegen_destroy(CodeGenerator* gen);
 // Main generation functions
 void codegen_generate(CodeGenerator* gen, ASTNode* ast);
 void codegen_generate_file(const char* filename, ASTNode* ast);
+// One top-level declaration, as codegen_generate() writes it in a program
+// after codegen_write_headers(), for translating one at a time
+void codegen_generate_declaration(CodeGenerator* gen, ASTNode* node);
+// Reports calls generated before their function's declaration was read,
+// whose arguments may have needed passing by reference; false if any
+bool codegen_check_forward_calls(CodeGenerator* gen);
+// Record types and a C prototype for each function, from signatures alone
+void codegen_generate_prototypes(CodeGenerator* gen, ASTNode* ast);
 
 // Individual generation functions
 void codegen_function(CodeGenerator* gen, ASTNode* node);
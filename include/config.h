@@ -35,6 +35,10 @@ typedef struct {
     char* output_filename;
     bool enable_verbose;
     bool enable_bounds_checking;
+    int jobs;                       // Threads to lex and parse with; 1 runs serially
+    bool print_stats;               // Report AST memory use and symbol lookups
+    bool check_signatures;          // Parse and emit function signatures only
+    bool stream;                    // Translate one top-level declaration at a time
 } TranslatorConfig;
 
 // Global configuration instance
@@ -98,4 +98,65 @@ void debug_mark_error_location(SourceLocation loc);
 void debug_print_error_context(SourceLocation loc);
 
 
+// Release builds (-DPLIKE_RELEASE, see `make release`) compile every hook
+// above out at the call site. Arguments stay inside an unevaluated sizeof,
+// so they still type-check and count as used. debug.c defines
+// PLIKE_DEBUG_IMPL to see the real functions.
+#if defined(PLIKE_RELEASE) && !defined(PLIKE_DEBUG_IMPL)
+#define DEBUG_HOOK(call) ((void)sizeof((call), 0))
+#define DEBUG_ENABLED(flag) 0
+#define debug_init(...) DEBUG_HOOK(debug_init(__VA_ARGS__))
+#define debug_set_flags(...) DEBUG_HOOK(debug_set_flags(__VA_ARGS__))
+#define debug_enable(...) DEBUG_HOOK(debug_enable(__VA_ARGS__))
+#define debug_disable(...) DEBUG_HOOK(debug_disable(__VA_ARGS__))
+#define debug_print_token(...) DEBUG_HOOK(debug_print_token(__VA_ARGS__))
+#define debug_print_ast(...) DEBUG_HOOK(debug_print_ast(__VA_ARGS__))
+#define debug_print_symbol_table(...) DEBUG_HOOK(debug_print_symbol_table(__VA_ARGS__))
+#define debug_print_symbol_scope(...) DEBUG_HOOK(debug_print_symbol_scope(__VA_ARGS__))
+#define debug_print_symbol(...) DEBUG_HOOK(debug_print_symbol(__VA_ARGS__))
+#define debug_print_codegen_state(...) DEBUG_HOOK(debug_print_codegen_state(__VA_ARGS__))
+#define debug_ast_node_create(...) DEBUG_HOOK(debug_ast_node_create(__VA_ARGS__))
+#define debug_ast_node_destroy(...) DEBUG_HOOK(debug_ast_node_destroy(__VA_ARGS__))
+#define debug_ast_node_transform(...) DEBUG_HOOK(debug_ast_node_transform(__VA_ARGS__))
+#define debug_ast_add_child(...) DEBUG_HOOK(debug_ast_add_child(__VA_ARGS__))
+#define debug_ast_node_complete(...) DEBUG_HOOK(debug_ast_node_complete(__VA_ARGS__))
+#define debug_symbol_create(...) DEBUG_HOOK(debug_symbol_create(__VA_ARGS__))
+#define debug_symbol_destroy(...) DEBUG_HOOK(debug_symbol_destroy(__VA_ARGS__))
+#define debug_scope_enter(...) DEBUG_HOOK(debug_scope_enter(__VA_ARGS__))
+#define debug_scope_exit(...) DEBUG_HOOK(debug_scope_exit(__VA_ARGS__))
+#define debug_symbol_lookup(...) DEBUG_HOOK(debug_symbol_lookup(__VA_ARGS__))
+#define debug_symbol_bounds_update(...) DEBUG_HOOK(debug_symbol_bounds_update(__VA_ARGS__))
+#define debug_symbol_table_operation(...) DEBUG_HOOK(debug_symbol_table_operation(__VA_ARGS__))
+#define debug_codegen_state(...) DEBUG_HOOK(debug_codegen_state(__VA_ARGS__))
+#define debug_codegen_expression(...) DEBUG_HOOK(debug_codegen_expression(__VA_ARGS__))
+#define debug_codegen_array(...) DEBUG_HOOK(debug_codegen_array(__VA_ARGS__))
+#define debug_codegen_function(...) DEBUG_HOOK(debug_codegen_function(__VA_ARGS__))
+#define debug_codegen_block(...) DEBUG_HOOK(debug_codegen_block(__VA_ARGS__))
+#define debug_codegen_symbol_resolution(...) DEBUG_HOOK(debug_codegen_symbol_resolution(__VA_ARGS__))
+#define debug_parser_state(...) DEBUG_HOOK(debug_parser_state(__VA_ARGS__))
+#define debug_parser_state_to(...) DEBUG_HOOK(debug_parser_state_to(__VA_ARGS__))
+#define debug_parser_expression(...) DEBUG_HOOK(debug_parser_expression(__VA_ARGS__))
+#define debug_parser_scope_enter(...) DEBUG_HOOK(debug_parser_scope_enter(__VA_ARGS__))
+#define debug_parser_scope_exit(...) DEBUG_HOOK(debug_parser_scope_exit(__VA_ARGS__))
+#define debug_parser_rule_start(...) DEBUG_HOOK(debug_parser_rule_start(__VA_ARGS__))
+#define debug_parser_rule_end(...) DEBUG_HOOK(debug_parser_rule_end(__VA_ARGS__))
+#define debug_parser_token_consume(...) DEBUG_HOOK(debug_parser_token_consume(__VA_ARGS__))
+#define debug_parser_error_sync(...) DEBUG_HOOK(debug_parser_error_sync(__VA_ARGS__))
+#define debug_print_parser_state(...) DEBUG_HOOK(debug_print_parser_state(__VA_ARGS__))
+#define debug_parser_procedure_start(...) DEBUG_HOOK(debug_parser_procedure_start(__VA_ARGS__))
+#define debug_parser_function_start(...) DEBUG_HOOK(debug_parser_function_start(__VA_ARGS__))
+#define debug_parser_parameter_start(...) DEBUG_HOOK(debug_parser_parameter_start(__VA_ARGS__))
+#define debug_token_type(...) DEBUG_HOOK(debug_token_type(__VA_ARGS__))
+#define debug_lexer_state(...) DEBUG_HOOK(debug_lexer_state(__VA_ARGS__))
+#define debug_token_details(...) DEBUG_HOOK(debug_token_details(__VA_ARGS__))
+#define debug_print_parser_state_d(...) DEBUG_HOOK(debug_print_parser_state_d(__VA_ARGS__))
+#define debug_visualize_ast(...) DEBUG_HOOK(debug_visualize_ast(__VA_ARGS__))
+#define debug_visualize_symbol_table(...) DEBUG_HOOK(debug_visualize_symbol_table(__VA_ARGS__))
+#define debug_visualize_codegen(...) DEBUG_HOOK(debug_visualize_codegen(__VA_ARGS__))
+#define debug_mark_error_location(...) DEBUG_HOOK(debug_mark_error_location(__VA_ARGS__))
+#define debug_print_error_context(...) DEBUG_HOOK(debug_print_error_context(__VA_ARGS__))
+#else
+#define DEBUG_ENABLED(flag) ((current_flags & (flag)) != 0)
+#endif
+
 #endif // PLIKE_DEBUG_H
\ No newline at end of file
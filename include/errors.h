@@ -7,7 +7,12 @@
 #include <stdbool.h>
 #include <stdarg.h>
 
+// Compiled out of release builds like the debug hooks in debug.h
+#ifdef PLIKE_RELEASE
+#define verbose_print(f_, ...) ((void)sizeof(printf((f_), ##__VA_ARGS__)))
+#else
 #define verbose_print(f_, ...) if (g_config.enable_verbose) printf((f_), ##__VA_ARGS__)
+#endif
 
 #define ERR_ARRAY_BOUNDS "Array index out of bounds"
 #define ERR_INVALID_ARRAY "Invalid array access"
@@ -32,7 +37,8 @@ typedef struct {
     ErrorSeverity severity;
     SourceLocation location;
     char* message;
-    char* source_line;
+    const char* source_line;    // Points into the lexer's source, not NUL-terminated
+    size_t source_line_length;
     int error_code;
 } Error;
 
@@ -43,8 +49,9 @@ void error_report(ErrorType type, ErrorSeverity severity,
 void error_at_token(Token* token, const char* format, ...);
 void error_at_current(const char* format, ...);
 
-// Error handling
+// Error handling. Only the first MAX_ERRORS errors are kept and printed.
 bool error_occurred(void);
+bool error_limit_reached(void);
 int error_count(void);
 void error_clear(void);
 void error_print_summary(void);
@@ -54,6 +61,21 @@ const char* error_type_string(ErrorType type);
 const char* error_severity_string(ErrorSeverity severity);
 void error_print_source_line(SourceLocation location);
 
+// Source context. Lines are sliced out of the lexer's buffer through its
+// line index, so the lexer must outlive any error reported against it.
+// Columns are converted from bytes to characters the same way.
+void error_set_source(const Lexer* lexer);
+void error_clear_source(const Lexer* lexer);
+bool error_source_line(int line, const char** text, size_t* length);
+int error_source_column(int line, int column);
+
+// Muting, for work that may be thrown away and redone. Errors reported on
+// a thread between error_mute() and error_unmute() are neither stored nor
+// printed, only counted; error_unmute() returns the count.
+void error_mute(void);
+int error_unmute(void);
+bool error_muted(void);
+
 // Error recovery
 void error_synchronize(void);
 bool error_panic_mode(void);
@@ -1,7 +1,10 @@
 #ifndef PLIKE_LEXER_H
 #define PLIKE_LEXER_H
 
+#include "arena.h"
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 typedef enum {
@@ -93,7 +96,8 @@ typedef enum {
     TOK_TRUE,           // true, .true.
     TOK_FALSE,          // false, .false.
     TOK_RECORD,
-    TOK_TYPE
+    TOK_TYPE,
+    TOK_COUNT           // Number of token types, for tables indexed by type
 } TokenType;
 
 typedef struct {
@@ -102,21 +106,101 @@ typedef struct {
     const char* filename;
 } SourceLocation;
 
+typedef enum {
+    NUMBER_NONE = 0,    // Not a numeric literal
+    NUMBER_DECIMAL,
+    NUMBER_HEX,         // 0x...
+    NUMBER_OCTAL,       // 0o...
+    NUMBER_BINARY,      // 0b...
+    NUMBER_REAL         // Fractional part or 'f' suffix
+} NumberKind;
+
+// Value of a numeric literal, decoded once by the lexer
+typedef struct {
+    NumberKind kind;
+    bool single;        // Real written with an 'f' suffix
+    union {
+        int64_t integer;
+        double real;
+    };
+} NumberLiteral;
+
+// Tokens are allocated from the lexer's arena and stay valid until
+// lexer_destroy(), or until lexer_release_tokens() is called twice after
+// they were handed out. value is NUL-terminated and either points at a static
+// operator spelling or at a copy of the source slice in the arena.
 typedef struct {
     TokenType type;
-    char* value;        // Dynamically allocated string value
+    uint32_t bracket;   // Bracket id for matched ( ) [ ], 0 otherwise
+    const char* value;
+    size_t offset;      // Slice of lexer->source this token was scanned from
+    size_t length;
     SourceLocation loc;
+    NumberLiteral number;   // TOK_NUMBER only
 } Token;
 
+// One bracket pair, recorded as the lexer scans so the parser can ask
+// about a group without rescanning the source
+typedef struct {
+    Token* open;
+    Token* close;       // NULL until the matching bracket is scanned
+    uint32_t commas;    // Commas directly inside this pair, not in nested ones
+    uint32_t next;      // Id of a same-kind pair opening right after close, or 0
+    bool next_known;    // The token after close has been scanned
+} BracketInfo;
+
+// Multi-byte UTF-8 characters of the input, recorded as it is validated
+// so diagnostics can count columns in characters. Stays empty for ASCII.
+typedef struct {
+    size_t* ends;           // Input offset just past each multi-byte character
+    size_t* extra;          // Continuation bytes up to and including each one
+    size_t count;
+    size_t capacity;
+    size_t dropped_extra;   // Continuation bytes of entries streamed out
+    size_t validated;       // Input offset validated up to
+    int line;               // Line being validated and its input offset,
+    size_t line_start;      // for lines the line index hasn't reached
+} Utf8Map;
+
 typedef struct LexerStruct {
     const char* filename;
-    char* source;
+    char* source;       // Not NUL-terminated when mapped; bound scans by source_length
     size_t source_length;
+    bool source_mapped;
+    size_t source_base;       // Input offset of source[0]; nonzero only when streaming
+    struct LexerStream* stream;   // Refillable window over a descriptor, or NULL
     size_t current;
     size_t start;
     int line;
     int column;
     char* line_start;
+    uint32_t* line_offsets;   // Start of each line seen so far in source, oldest first
+    size_t line_count;
+    size_t line_capacity;
+    size_t lines_dropped;     // Lines streamed out of the window before line_offsets[0]
+    const struct LexerScanOps* scan;  // Bulk scanning kernels for this CPU
+    const struct LexerTables* tables; // Generated DFA for the operator style
+    Arena arena;        // Owns every token and token value
+    Arena retired;      // Tokens handed out before the last lexer_release_tokens()
+    size_t token_count;
+    BracketInfo* brackets;    // Indexed by bracket id - 1 - brackets_dropped
+    size_t bracket_count;
+    size_t bracket_capacity;
+    size_t brackets_dropped;  // Pairs whose tokens lexer_release_tokens() freed
+    size_t bracket_mark;      // Last id handed out before the previous release
+    uint32_t* open_brackets;  // Ids of the pairs still open, innermost last
+    size_t open_count;
+    size_t open_capacity;
+    uint32_t last_closed;     // Pair closed by the previous token, or 0
+    Token** lexed;            // Scanned ahead by lexer_lex_parallel(); NULL for failed scans
+    size_t lexed_count;
+    size_t lexed_next;
+    struct LexerDiagnostic* diagnostics;  // Errors raised while scanning ahead, in order
+    size_t diagnostic_count;
+    size_t diagnostic_capacity;
+    size_t diagnostic_next;
+    struct LexerChunk* chunk; // Set on the per-thread lexers of a parallel run
+    Utf8Map utf8;
 } Lexer;
 
 typedef struct LexerStruct Lexer;
@@ -135,11 +219,18 @@ extern const Keyword* keywords;
 
 // Lexer interface
 Lexer* lexer_create(const char* filename);
+Lexer* lexer_create_fd(int fd, const char* name);
+Lexer* lexer_create_streamed(const char* filename);
 void lexer_destroy(Lexer* lexer);
 Token* lexer_next_token(Lexer* lexer);
-void token_destroy(Token* token);
 const char* token_type_to_string(TokenType type);
 void lexer_report_error(Lexer* lexer, const char* message);
 SourceLocation token_clone_location(Token* source_token);
+const BracketInfo* lexer_bracket_info(Lexer* lexer, uint32_t id);
+bool lexer_line_slice(const Lexer* lexer, int line, const char** text, size_t* length);
+size_t lexer_lines_scanned(const Lexer* lexer);
+int lexer_character_column(const Lexer* lexer, int line, int column);
+bool lexer_lex_parallel(Lexer* lexer, int threads);
+bool lexer_release_tokens(Lexer* lexer);
 
 #endif // PLIKE_LEXER_H
\ No newline at end of file
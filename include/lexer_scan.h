@@ -0,0 +1,39 @@
+#ifndef PLIKE_LEXER_SCAN_H
+#define PLIKE_LEXER_SCAN_H
+
+#include <stddef.h>
+
+// Bulk scanning kernels used by the lexer's hot loops. Every kernel takes
+// the source buffer, a start position and the buffer length, never reads
+// at or past length, and returns the position where the run ends.
+
+typedef enum {
+    SCAN_BACKEND_SCALAR,
+    SCAN_BACKEND_SSE2,
+    SCAN_BACKEND_AVX2,
+    SCAN_BACKEND_COUNT
+} ScanBackend;
+
+typedef struct LexerScanOps {
+    const char* name;
+    // End of a run of ' ', '\t' and '\r'
+    size_t (*blank_run)(const char* source, size_t pos, size_t length);
+    // Position of the next '\n', or length
+    size_t (*line_end)(const char* source, size_t pos, size_t length);
+    // Position of the '*' of the next "*/", or length. Counts the newlines
+    // skipped and records the position of the last one.
+    size_t (*block_comment_end)(const char* source, size_t pos, size_t length,
+                                size_t* newlines, size_t* last_newline);
+    // End of a run of [A-Za-z0-9_]
+    size_t (*identifier_end)(const char* source, size_t pos, size_t length);
+    // End of a run of bytes below 0x80
+    size_t (*ascii_run)(const char* source, size_t pos, size_t length);
+} LexerScanOps;
+
+// Best backend for this CPU, picked via cpuid on first use
+const LexerScanOps* lexer_scan_ops(void);
+
+// A specific backend, or NULL if this build/CPU can't run it
+const LexerScanOps* lexer_scan_backend(ScanBackend backend);
+
+#endif // PLIKE_LEXER_SCAN_H
@@ -0,0 +1,46 @@
+#ifndef PLIKE_LEXER_TABLES_H
+#define PLIKE_LEXER_TABLES_H
+
+#include <stdint.h>
+
+// Transition tables for the table-driven scanner. They are generated at
+// build time by tools/lexgen.c from its token spec and the keyword tables,
+// one set per operator style.
+
+// Reserved states. Every other state is a real DFA state.
+#define LEX_STATE_DEAD 0    // No token continues with this character
+#define LEX_STATE_VETO 1    // The character rules out the current state's match
+#define LEX_STATE_START 2
+
+// What the scanner does with a match. Each state's accept entry packs the
+// action in the high byte and a TokenType (or NumberKind for numbers) in
+// the low byte; 0 means the state doesn't accept.
+typedef enum {
+    LEX_ACTION_NONE,
+    LEX_ACTION_TOKEN,       // make_token() with the given type
+    LEX_ACTION_TEXT,        // Token value is the source text (dotted operators)
+    LEX_ACTION_NUMBER,      // Numeric literal of the given NumberKind
+    LEX_ACTION_EQUALS,      // '=' means assign or compare depending on config
+    LEX_ACTION_STAR,        // '*' is multiply or dereference by context
+    LEX_ACTION_AMP,         // '&' is bitwise and or address-of by context
+    LEX_ACTION_STRING       // Opening quote, the rest is scanned by hand
+} LexAction;
+
+#define LEX_ACCEPT(action, value) ((uint16_t)(((action) << 8) | (value)))
+#define LEX_ACCEPT_ACTION(accept) ((LexAction)((accept) >> 8))
+#define LEX_ACCEPT_VALUE(accept) ((accept) & 0xff)
+
+typedef struct LexerTables {
+    const char* name;
+    uint16_t state_count;
+    uint16_t class_count;
+    uint16_t identifier_tail;       // Plain identifier state; the scan kernel takes over
+    const uint8_t* classes;         // Byte -> character class
+    const uint16_t* transitions;    // state_count x class_count
+    const uint16_t* accepts;        // Per state, see LEX_ACCEPT
+} LexerTables;
+
+// Indexed by OperatorStyle
+extern const LexerTables lexer_tables[];
+
+#endif // PLIKE_LEXER_TABLES_H
@@ -7,21 +7,60 @@
 
 //typedef struct ParserStruct Parser;
 
+#define TOKEN_BUFFER_INITIAL_CAPACITY 256
+#define MAX_STATEMENT_DEPTH 10000  // Nesting cap; statements are parsed and generated recursively
+#define MAX_STATEMENT_ERRORS 3    // Syntax errors reported per outermost statement
+
+// Tokens lexed so far, filled on demand. Tokens are owned by the lexer's
+// arena, so the buffer only holds pointers.
+typedef struct {
+    Token** tokens;
+    size_t count;
+    size_t capacity;
+    size_t position;        // Index of the current token
+} TokenBuffer;
+
 typedef struct {
     Token* current;          // Current token
     Token* prev;          // Current token
     Token* peek;            // Look-ahead token
+    TokenBuffer buffer;     // Backing store for current/prev/peek
     Lexer* lexer;          // Lexer instance
     SymbolTable* symbols;   // Symbol table
     char* current_record;
     char* current_function; // Name of function being parsed
     bool is_function;
     bool in_loop;          // Track if we're inside a loop
+    int statement_depth;   // Statements open around the current one
+    int statement_errors;  // Errors in the outermost statement being parsed
+    unsigned sync;         // Token classes the rules being parsed resume at after an error
     int error_count;       // Number of parsing errors
 } ParserContext;
 
+// Time and tokens spent skipping ahead after syntax errors
+typedef struct {
+    size_t recoveries;      // Times the parser skipped ahead
+    size_t skipped;         // Tokens skipped
+    size_t suppressed;      // Cascaded errors that weren't reported
+    double seconds;
+} RecoveryStats;
+
 typedef struct {
     ParserContext ctx;
+    AstArena ast;           // Owns the tree parser_parse() returns
+    AstArena unit_ast;      // Streaming: the function being translated
+    size_t token_mark;      // Streaming: tokens buffered when the lexer last freed some
+    struct ParseUnit* units;    // Functions parsed on other threads, owning their subtrees
+    size_t unit_count;
+    ASTNode** pending_calls;    // Calls to functions not declared yet
+    size_t pending_count;
+    size_t pending_capacity;
+    bool defer_calls;           // Keep every call, for parse_in_parallel()
+    struct LazyBody* lazy;      // Bodies skipped by a signature-only parse
+    size_t lazy_count;
+    bool lazy_bodies;           // Parse signatures only, from --check-signatures
+    RecoveryStats recovery;
+    Token end_of_input;         // Ends the input early once the error limit is reached
     bool had_error;
     bool panic_mode;
 } Parser;
@@ -30,8 +69,30 @@ typedef struct {
 Parser* parser_create(Lexer* lexer);
 void parser_destroy(Parser* parser);
 
-// Main parsing functions
+// Main parsing functions. With --jobs above 1, parser_parse() parses the
+// top-level functions and procedures of a lexed-ahead source on that many
+// threads when it can, giving the same tree and symbols as parsing in order.
 ASTNode* parser_parse(Parser* parser);
+AstStats parser_ast_stats(const Parser* parser);
+RecoveryStats parser_recovery_stats(const Parser* parser);
+
+// Signature-only parsing. With lazy_bodies set, function and procedure
+// declarations parse their signature and the variable declarations that
+// can type its parameters, then skip the statements after 'begin',
+// remembering where they are. parser_expand_body() parses one function's
+// statements into its body, with its parameters and locals in scope;
+// parser_expand_bodies() parses all that are left. Both return false if
+// a body had errors.
+bool parser_expand_body(Parser* parser, ASTNode* function);
+bool parser_expand_bodies(Parser* parser);
+
+// Streaming translation. parser_parse_next() parses the next top-level
+// declaration, or returns NULL at the end of the input. Functions and
+// procedures go into an arena of their own, which parser_release_unit()
+// frees along with their local scopes and the tokens read so far once the
+// caller is done with them; other declarations are kept.
+ASTNode* parser_parse_next(Parser* parser);
+void parser_release_unit(Parser* parser, ASTNode* unit);
 ASTNode* parser_parse_file(const char* filename);
 
 // Individual parsing functions
@@ -40,7 +101,10 @@ ASTNode* parse_procedure(Parser* parser);
 ASTNode* parse_expression(Parser* parser);
 ASTNode* parse_parameter_list(Parser* parser);
 
-// Error handling
+// Error handling. After an error the parser skips to a token where one of
+// the rules being parsed can resume, and reports nothing more until the
+// next statement or declaration starts. Each outermost statement reports
+// at most MAX_STATEMENT_ERRORS syntax errors.
 void parser_error(Parser* parser, const char* message);
 bool parser_sync_to_next_statement(Parser* parser);
 
@@ -49,6 +113,7 @@ bool parser_match(Parser* parser, TokenType type);
 bool parser_check(Parser* parser, TokenType type);
 Token* parser_advance(Parser* parser);
 Token* parser_peek(Parser* parser);
+Token* parser_peek_n(Parser* parser, size_t k);
 bool parser_at_end(Parser* parser);
 
 #endif // PLIKE_PARSER_H
\ No newline at end of file
@@ -2,10 +2,14 @@
 #define PLIKE_SYMTABLE_H
 
 #include "ast.h"
+#include "arena.h"
 #include <stdbool.h>
 
-#define HASH_SIZE 211
-#define MAX_SCOPE_DEPTH 128
+// Scopes with up to this many symbols are searched by scanning them; larger
+// ones also get an open-addressing index, which grows with the scope
+#define SMALL_SCOPE_SIZE 8
+// Most scopes a table keeps for reuse after they are released
+#define MAX_POOLED_SCOPES 256
 
 typedef enum {
     SYMBOL_VARIABLE,
@@ -50,7 +54,7 @@ typedef struct {
 } FunctionInfo;
 
 typedef struct Symbol {
-    char* name;
+    const char* name;       // Interned by the table, so names compare with ==
     SymbolKind kind;
     union {
         VariableInfo var;
@@ -58,37 +62,74 @@ typedef struct Symbol {
         RecordTypeData record;
     } info;
     struct Scope* scope;
-    struct Symbol* next;    // For hash table chaining
     ASTNode* node;
 } Symbol;
 
 typedef struct Scope {
     ScopeType type;
     struct Scope* parent;
-    Symbol** symbols;       // Hash table of symbols
+    Symbol** symbols;       // In the order they were added
     int symbol_count;
+    int symbol_capacity;
+    int* index;             // Positions in symbols plus one, by name hash; NULL while small
+    int index_capacity;     // A power of two
     char* function_name;    // For function scopes
+    struct Scope* children;     // Newest first
+    struct Scope* next_sibling; // Also links the table's free scopes
 } Scope;
 
+// Every name the table has seen, stored once, after its hash
 typedef struct {
+    Arena strings;
+    const char** slots;     // Open addressing, by hash
+    size_t capacity;        // A power of two
+    size_t count;
+} NamePool;
+
+typedef struct SymbolTable {
     Scope* current;
     Scope* global;
     int scope_level;
+    NamePool names;
+    const struct SymbolTable* base; // Forks only: the table they started from
+    int shared_count;       // Forks only: how many of base's globals they see
+    Scope* free_scopes;     // Released scopes, kept for reuse
+    int free_count;
+    size_t lookups;         // Names looked up so far, for --stats
 } SymbolTable;
 
 // Symbol table operations
 SymbolTable* symtable_create(void);
 void symtable_destroy(SymbolTable* table);
 
+// Forks. A fork sees every global its table had when it was made and adds
+// globals of its own without writing to the table, so forks can be filled
+// on other threads while the table is only read. symtable_join() moves a
+// fork's globals into the table and destroys the fork; it returns false,
+// changing neither, if any of them is already declared there.
+SymbolTable* symtable_fork(const SymbolTable* table);
+bool symtable_join(SymbolTable* table, SymbolTable* fork);
+
 void symtable_destroy_bounds(ArrayBoundsData* bounds);
 ArrayBoundsData* symtable_clone_bounds(const ArrayBoundsData* bounds);
 ArrayBoundsData* symtable_create_bounds(int dimensions);
 Symbol* symtable_add_array(SymbolTable* table, const char* name, const char* elem_type, ArrayBoundsData* bounds);
 
-// Scope management
+// Scope management. Every scope entered is linked under its parent, and
+// the table owns the tree. Exiting keeps function scopes, which parameters
+// and lazy bodies refer to, and scopes holding symbols, for code
+// generation; an empty block scope goes back to the table's pool.
 Scope* scope_create(ScopeType type, Scope* parent);
 void symtable_enter_scope(SymbolTable* table, ScopeType type);
 void symtable_exit_scope(SymbolTable* table);
+// Exits scopes until scope, or else the global scope, is current
+void symtable_exit_to_scope(SymbolTable* table, Scope* scope);
+// Makes a kept scope current again
+void symtable_resume_scope(SymbolTable* table, Scope* scope);
+// Releases every scope below the global one to the pool, and the local
+// variables recorded on function name, keeping only its signature. For
+// translating one function at a time; only call it at global scope.
+void symtable_release_function(SymbolTable* table, const char* name);
 Scope* symtable_current_scope(SymbolTable* table);
 
 // Symbol management
@@ -112,8 +153,12 @@ bool symtable_is_type_compatible(const char* type1, const char* type2);
 void symtable_print_current_scope(SymbolTable* table);
 void symtable_report_error(SymbolTable* table, const char* message);
 
-// Debug functions
+// Debug functions. Release builds compile symtable_debug_dump_all() calls out.
+#ifdef PLIKE_RELEASE
+#define symtable_debug_dump_all(table) ((void)sizeof(table))
+#else
 void symtable_debug_dump_all(SymbolTable* table);
+#endif
 void symtable_debug_dump_scope(Scope* scope, int level);
 void symtable_debug_dump_symbol(Symbol* sym, int level);
 
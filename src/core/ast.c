@@ -2,60 +2,265 @@
 #include "symtable.h"
 #include "errors.h"
 #include "debug.h"
+#include <stdalign.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-#define INITIAL_CHILDREN_CAPACITY 4
-
 // Helper function declarations
 static void indent_print(int level);
 static void free_node_data(ASTNode* node);
 static bool ensure_child_capacity(ASTNode* node);
 
+#define AST_MAX_FILES 256
+
+// Arena new nodes are allocated from, per thread so units can be parsed
+// side by side
+static _Thread_local AstArena* current_arena = NULL;
+
+// Side tables and ids for nodes from malloc(). Their payloads live until
+// exit; such nodes are only made outside a parse.
+static AstArena detached;
+
+// Filenames of packed locations, copied so they outlive the lexers. Only
+// ast_register_file() and ast_set_location() on a new filename write it.
+static char* file_table[AST_MAX_FILES];
+static int file_count = 0;
+
+static void side_table_release(AstSideTable* table) {
+    free(table->keys);
+    free(table->values);
+    *table = (AstSideTable){0};
+}
+
+void ast_arena_init(AstArena* arena) {
+    memset(arena, 0, sizeof(*arena));
+    arena_init(&arena->arena, ARENA_DEFAULT_BLOCK_SIZE);
+}
+
+void ast_arena_release(AstArena* arena) {
+    for (size_t i = 0; i < arena->bounds.capacity; i++) {
+        if (arena->bounds.keys[i]) symtable_destroy_bounds(arena->bounds.values[i]);
+    }
+    side_table_release(&arena->records);
+    side_table_release(&arena->bounds);
+    arena_release(&arena->arena);
+    if (current_arena == arena) current_arena = NULL;
+}
+
+// Returns the arena that was in use, so callers can restore it
+AstArena* ast_use_arena(AstArena* arena) {
+    AstArena* previous = current_arena;
+    current_arena = arena;
+    return previous;
+}
+
+// Copy of text for a node field, owned by the arena in use if any
+char* ast_strdup(const char* text) {
+    if (!current_arena) return strdup(text);
+    size_t length = strlen(text);
+    current_arena->string_bytes += length + 1;
+    return arena_strndup(&current_arena->arena, text, length);
+}
+
+// A copy of prefix followed by text, from the same place as ast_strdup()
+char* ast_strcat(const char* prefix, const char* text) {
+    size_t prefix_length = strlen(prefix);
+    size_t length = prefix_length + strlen(text);
+    char* copy = current_arena ? (char*)arena_alloc(&current_arena->arena, length + 1) : (char*)malloc(length + 1);
+    if (!copy) return NULL;
+    if (current_arena) current_arena->string_bytes += length + 1;
+    memcpy(copy, prefix, prefix_length);
+    memcpy(copy + prefix_length, text, length - prefix_length + 1);
+    return copy;
+}
+
+// Heap bytes of one set of bounds, leaving out the names of variable bounds
+static size_t bounds_size(const ArrayBoundsData* bounds) {
+    if (!bounds) return 0;
+    return sizeof(ArrayBoundsData) + (size_t)bounds->dimensions * sizeof(DimensionBounds);
+}
+
+AstStats ast_arena_stats(const AstArena* arena) {
+    AstStats stats;
+    stats.nodes = arena->node_count;
+    stats.node_bytes = arena->node_count * sizeof(ASTNode);
+    stats.child_bytes = arena->child_bytes;
+    stats.side_bytes = arena->payload_bytes +
+        (arena->records.capacity + arena->bounds.capacity) * (sizeof(uint32_t) + sizeof(void*));
+    stats.bounds_bytes = 0;
+    for (size_t i = 0; i < arena->bounds.capacity; i++) {
+        if (arena->bounds.keys[i]) stats.bounds_bytes += bounds_size(arena->bounds.values[i]);
+    }
+    stats.string_bytes = arena->string_bytes;
+    return stats;
+}
+
 ASTNode* ast_create_node(NodeType type) {
     debug_ast_node_create(type, "creating base node");
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
+    AstArena* arena = current_arena;
+    // Packed at their own alignment, as most of the arena is nodes
+    ASTNode* node = arena
+        ? (ASTNode*)arena_alloc_aligned(&arena->arena, sizeof(ASTNode), alignof(ASTNode))
+        : (ASTNode*)malloc(sizeof(ASTNode));
     if (!node) return NULL;
 
+    // Initialize all fields to prevent undefined behavior
+    memset(node, 0, sizeof(*node));
     node->type = type;
-    node->child_count = 0;
-    node->children = (ASTNode**)malloc(INITIAL_CHILDREN_CAPACITY * sizeof(ASTNode*));
-    
-    if (!node->children) {
-        free(node);
-        return NULL;
+    node->children = node->inline_children;
+    node->child_capacity = AST_INLINE_CHILDREN;
+    node->arena = arena;
+
+    if (arena) {
+        node->id = (uint32_t)++arena->node_count;
+    } else {
+        node->id = (uint32_t)++detached.node_count;
     }
 
-    // Initialize all fields to prevent undefined behavior
-    memset(&node->data, 0, sizeof(node->data));
-    memset(&node->loc, 0, sizeof(node->loc));
-    
-
     debug_ast_node_complete(node, "node creation complete");
     return node;
 }
 
-void ast_destroy_node(ASTNode* node) {
-    if (!node) return;
+// Side tables
+// Open addressing on the node id with linear probing
 
-    debug_ast_node_destroy(node, "beginning node destruction");
+static size_t side_slot(const AstSideTable* table, uint32_t id) {
+    size_t mask = table->capacity - 1;
+    size_t slot = (size_t)(id * 2654435761u) & mask;
+    while (table->keys[slot] && table->keys[slot] != id) slot = (slot + 1) & mask;
+    return slot;
+}
 
-    // Free all children first
-    for (int i = 0; i < node->child_count; i++) {
-        ast_destroy_node(node->children[i]);
-        node->children[i] = NULL;
+static void* side_find(const AstSideTable* table, uint32_t id) {
+    if (table->count == 0) return NULL;
+    size_t slot = side_slot(table, id);
+    return table->keys[slot] ? table->values[slot] : NULL;
+}
+
+static bool side_insert(AstSideTable* table, uint32_t id, void* value) {
+    // Keep at most half the slots full
+    if ((table->count + 1) * 2 > table->capacity) {
+        AstSideTable grown;
+        grown.capacity = table->capacity ? table->capacity * 2 : 16;
+        grown.count = table->count;
+        grown.keys = (uint32_t*)calloc(grown.capacity, sizeof(uint32_t));
+        grown.values = (void**)malloc(grown.capacity * sizeof(void*));
+        if (!grown.keys || !grown.values) {
+            free(grown.keys);
+            free(grown.values);
+            return false;
+        }
+        for (size_t i = 0; i < table->capacity; i++) {
+            if (!table->keys[i]) continue;
+            size_t slot = side_slot(&grown, table->keys[i]);
+            grown.keys[slot] = table->keys[i];
+            grown.values[slot] = table->values[i];
+        }
+        free(table->keys);
+        free(table->values);
+        *table = grown;
     }
 
-    free(node->children);
-    node->children = NULL;
-    node->child_count = 0;
-    // Free node-specific data
-    free_node_data(node);
+    size_t slot = side_slot(table, id);
+    if (!table->keys[slot]) table->count++;
+    table->keys[slot] = id;
+    table->values[slot] = value;
+    return true;
+}
+
+static AstArena* side_owner(const ASTNode* node) {
+    return node->arena ? node->arena : &detached;
+}
 
-    free(node);
+RecordTypeData* ast_record_type(ASTNode* node) {
+    AstArena* owner = side_owner(node);
+    RecordTypeData* record = (RecordTypeData*)side_find(&owner->records, node->id);
+    if (record) return record;
+
+    if (!owner->arena.block_size) arena_init(&owner->arena, ARENA_DEFAULT_BLOCK_SIZE);
+    record = (RecordTypeData*)arena_alloc(&owner->arena, sizeof(RecordTypeData));
+    if (!record) return NULL;
+    memset(record, 0, sizeof(*record));
+    if (!side_insert(&owner->records, node->id, record)) return NULL;
+    owner->payload_bytes += sizeof(RecordTypeData);
+    return record;
 }
 
+ArrayBoundsData* ast_array_bounds(const ASTNode* node) {
+    return (ArrayBoundsData*)side_find(&side_owner(node)->bounds, node->id);
+}
+
+bool ast_set_array_bounds(ASTNode* node, ArrayBoundsData* bounds) {
+    AstArena* owner = side_owner(node);
+    ArrayBoundsData* previous = (ArrayBoundsData*)side_find(&owner->bounds, node->id);
+    if (!side_insert(&owner->bounds, node->id, bounds)) return false;
+    if (previous) symtable_destroy_bounds(previous);
+    return true;
+}
+
+Symbol* ast_symbol(const ASTNode* node) {
+    switch (node->type) {
+        case NODE_VARIABLE:
+        case NODE_VAR_DECL:
+        case NODE_ARRAY_DECL:
+            return node->data.variable.symbol;
+        case NODE_PARAMETER:
+            return node->data.parameter.symbol;
+        case NODE_IDENTIFIER:
+        case NODE_CALL:
+            return node->data.name.symbol;
+        case NODE_ARRAY_ACCESS:
+            return node->data.array_access.symbol;
+        default:
+            return NULL;
+    }
+}
+
+// Children wait on an explicit stack rather than in nested calls, so deep
+// trees can't overflow the call stack
+void ast_destroy_node(ASTNode* node) {
+    if (!node) return;
+    // Released with the whole tree
+    if (node->arena) return;
+
+    ASTNode** pending = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    for (;;) {
+        debug_ast_node_destroy(node, "beginning node destruction");
+
+        for (int i = 0; i < node->child_count; i++) {
+            ASTNode* child = node->children[i];
+            node->children[i] = NULL;
+            if (!child || child->arena) continue;
+            if (count == capacity) {
+                size_t new_capacity = capacity ? capacity * 2 : 64;
+                ASTNode** grown = (ASTNode**)realloc(pending, new_capacity * sizeof(ASTNode*));
+                if (!grown) {
+                    ast_destroy_node(child);
+                    continue;
+                }
+                pending = grown;
+                capacity = new_capacity;
+            }
+            pending[count++] = child;
+        }
+
+        if (node->children != node->inline_children) free(node->children);
+        node->children = NULL;
+        node->child_count = 0;
+        // Free node-specific data
+        free_node_data(node);
+
+        free(node);
+        if (count == 0) break;
+        node = pending[--count];
+    }
+    free(pending);
+}
+
+// Strings of a node from malloc(); its bounds belong to the side tables
 static void free_node_data(ASTNode* node) {
     switch (node->type) {
         case NODE_FUNCTION:
@@ -68,9 +273,6 @@ static void free_node_data(ASTNode* node) {
         case NODE_ARRAY_DECL:
             free(node->data.variable.name);
             free(node->data.variable.type);
-            if (node->data.variable.is_array) {
-                symtable_destroy_bounds(node->data.variable.array_info.bounds);
-            }
             break;
 
         case NODE_IDENTIFIER:
@@ -103,20 +305,38 @@ void ast_add_child(ASTNode* parent, ASTNode* child) {
     debug_ast_node_complete(parent, "child addition complete");
 }
 
+// Spills the children out of the node once the inline slots are full.
+// Arena nodes leave the outgrown array behind in the arena.
 static bool ensure_child_capacity(ASTNode* node) {
-    if (node->child_count < INITIAL_CHILDREN_CAPACITY) return true;
+    if (node->child_count < node->child_capacity) return true;
+
+    int new_capacity = node->child_capacity * 2;
+    size_t size = (size_t)new_capacity * sizeof(ASTNode*);
+    ASTNode** new_children;
+    if (node->arena) {
+        new_children = (ASTNode**)arena_alloc(&node->arena->arena, size);
+        if (new_children) {
+            memcpy(new_children, node->children, (size_t)node->child_count * sizeof(ASTNode*));
+            node->arena->spilled++;
+            node->arena->child_bytes += size;
+        }
+    } else if (node->children == node->inline_children) {
+        new_children = (ASTNode**)malloc(size);
+        if (new_children) {
+            memcpy(new_children, node->children, (size_t)node->child_count * sizeof(ASTNode*));
+        }
+    } else {
+        new_children = (ASTNode**)realloc(node->children, size);
+    }
 
-    size_t new_capacity = node->child_count * 2;
-    ASTNode** new_children = (ASTNode**)realloc(node->children, 
-                                               new_capacity * sizeof(ASTNode*));
-    
     if (!new_children) {
-        error_report(ERROR_INTERNAL, SEVERITY_ERROR, node->loc,
+        error_report(ERROR_INTERNAL, SEVERITY_ERROR, ast_location(node),
                     "Failed to allocate memory for AST node children");
         return false;
     }
 
     node->children = new_children;
+    node->child_capacity = new_capacity;
     return true;
 }
 
@@ -125,7 +345,7 @@ ASTNode* ast_create_string(const char* value) {
     if (!node) return NULL;
 
     if (value) {
-        node->data.value = strdup(value);
+        node->data.value = ast_strdup(value);
         if (!node->data.value) {
             ast_destroy_node(node);
             return NULL;
@@ -139,8 +359,8 @@ ASTNode* ast_create_function(const char* name, const char* return_type, bool is_
     ASTNode* node = ast_create_node(is_procedure ? NODE_PROCEDURE : NODE_FUNCTION);
     if (!node) return NULL;
 
-    node->data.function.name = strdup(name);
-    node->data.function.return_type = return_type ? strdup(return_type) : NULL;
+    node->data.function.name = ast_strdup(name);
+    node->data.function.return_type = return_type ? ast_strdup(return_type) : NULL;
     node->data.function.is_procedure = is_procedure;
     node->data.function.type_before_name = false; // Default to type after name
     
@@ -176,8 +396,8 @@ ASTNode* ast_create_variable(const char* name, const char* type, NodeType node_t
         return NULL;
     }
 
-    node->data.variable.name = strdup(name);
-    node->data.variable.type = type ? strdup(type) : NULL;
+    node->data.variable.name = ast_strdup(name);
+    node->data.variable.type = type ? ast_strdup(type) : NULL;
     node->data.variable.is_array = (node_type == NODE_ARRAY_DECL);
     node->data.variable.array_info.dimensions = 0;
     node->data.variable.is_param = false;
@@ -203,9 +423,36 @@ ASTNode* ast_create_binary_op(TokenType op, ASTNode* left, ASTNode* right) {
     return node;
 }
 
+static uint16_t file_id(const char* filename) {
+    if (!filename) return 0;
+    for (int i = 0; i < file_count; i++) {
+        if (strcmp(file_table[i], filename) == 0) return (uint16_t)(i + 1);
+    }
+    if (file_count == AST_MAX_FILES) return 0;
+    char* copy = strdup(filename);
+    if (!copy) return 0;
+    file_table[file_count++] = copy;
+    return (uint16_t)file_count;
+}
+
+void ast_register_file(const char* filename) {
+    file_id(filename);
+}
+
 void ast_set_location(ASTNode* node, SourceLocation loc) {
     if (!node) return;
-    node->loc = loc;
+    node->loc.line = loc.line > 0 ? (uint32_t)loc.line : 0;
+    node->loc.column = loc.column <= 0 ? 0 : loc.column > UINT16_MAX ? UINT16_MAX : (uint16_t)loc.column;
+    node->loc.file = file_id(loc.filename);
+}
+
+SourceLocation ast_location(const ASTNode* node) {
+    SourceLocation loc = {0, 0, NULL};
+    if (!node) return loc;
+    loc.line = (int)node->loc.line;
+    loc.column = node->loc.column;
+    loc.filename = node->loc.file ? file_table[node->loc.file - 1] : NULL;
+    return loc;
 }
 
 const char* ast_node_type_to_string(ASTNode* node) {
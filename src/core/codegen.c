@@ -3,6 +3,7 @@
 #include "config.h"
 #include "debug.h"
 #include "utils.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,20 @@
 
 static void generate_call(CodeGenerator* gen, ASTNode* node);
 
+typedef struct CallSite {
+    char* name;
+    SourceLocation loc;
+    int arg_count;
+} CallSite;
+
+// Whether a call passes the argument for param by address
+static bool passes_by_reference(const Symbol* param) {
+    return param && param->info.var.needs_deref && !param->info.var.is_array && param->info.var.param_mode &&
+        (strcasecmp(param->info.var.param_mode, "out") == 0 ||
+        strcasecmp(param->info.var.param_mode, "inout") == 0||
+        strcasecmp(param->info.var.param_mode, "in/out") == 0);
+}
+
 static void debug_print_token_type(TokenType type) {
     switch (type) {
         case TOK_PLUS: verbose_print("PLUS"); break;
@@ -55,17 +70,64 @@ CodeGenerator* codegen_create(FILE* output, SymbolTable* symbols) {
     gen->in_expression = false;
     gen->array_context.array_adjustment_needed = false;
     gen->array_context.in_array_access = false;
+    gen->array_context.in_array_declaration = false;
+    gen->array_context.dimensions = 0;
     gen->array_context.current_dim = 0;
+    gen->forward_calls = NULL;
+    gen->forward_call_count = 0;
 
     return gen;
 }
 
 void codegen_destroy(CodeGenerator* gen) {
     if (!gen) return;
+    for (size_t i = 0; i < gen->forward_call_count; i++) {
+        free(gen->forward_calls[i].name);
+    }
+    free(gen->forward_calls);
     free(gen->current_function);
     free(gen);
 }
 
+// The call with the most arguments to each function that isn't declared yet
+static void note_forward_call(CodeGenerator* gen, ASTNode* node) {
+    for (size_t i = 0; i < gen->forward_call_count; i++) {
+        CallSite* site = &gen->forward_calls[i];
+        if (strcmp(site->name, node->data.value) != 0) continue;
+        if (node->child_count > site->arg_count) {
+            site->loc = ast_location(node);
+            site->arg_count = node->child_count;
+        }
+        return;
+    }
+    CallSite* grown = (CallSite*)realloc(gen->forward_calls, (gen->forward_call_count + 1) * sizeof(CallSite));
+    if (!grown) return;
+    gen->forward_calls = grown;
+    gen->forward_calls[gen->forward_call_count++] = (CallSite){
+        strdup(node->data.value), ast_location(node), node->child_count
+    };
+}
+
+bool codegen_check_forward_calls(CodeGenerator* gen) {
+    bool ok = true;
+    for (size_t i = 0; i < gen->forward_call_count; i++) {
+        CallSite* site = &gen->forward_calls[i];
+        Symbol* func = symtable_lookup_global(gen->symbols, site->name);
+        if (!func || (func->kind != SYMBOL_FUNCTION && func->kind != SYMBOL_PROCEDURE)) continue;
+        bool by_reference = false;
+        for (int p = 0; p < site->arg_count && p < func->info.func.param_count; p++) {
+            by_reference = by_reference || passes_by_reference(func->info.func.parameters[p]);
+        }
+        if (by_reference) {
+            error_report(ERROR_SEMANTIC, SEVERITY_ERROR, site->loc,
+                        "Call to '%s' comes before its declaration, which --stream can't translate",
+                        site->name);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
 static const char* get_format_specifier(const char* type) {
     if (!type) return "%s";
     
@@ -78,6 +140,21 @@ static const char* get_format_specifier(const char* type) {
     return "%s"; // default
 }
 
+// The parser stores what each name resolved to on its node. Names it
+// couldn't resolve yet, such as globals declared after their first use,
+// are looked up again here.
+static Symbol* resolve_variable(CodeGenerator* gen, ASTNode* var) {
+    Symbol* symbol = ast_symbol(var);
+    if (symbol) return symbol;
+    return symtable_lookup(gen->symbols, var->data.variable.name);
+}
+
+static Symbol* resolve_parameter(CodeGenerator* gen, ASTNode* function, ASTNode* param) {
+    if (param->data.parameter.symbol) return param->data.parameter.symbol;
+    return symtable_lookup_parameter(gen->symbols, function->data.function.name,
+                                     param->data.parameter.name);
+}
+
 static void generate_print_statement(CodeGenerator* gen, ASTNode* node) {
     if (!node || node->child_count == 0) {
         error_report(ERROR_INTERNAL, SEVERITY_ERROR, 
@@ -97,7 +174,7 @@ static void generate_print_statement(CodeGenerator* gen, ASTNode* node) {
         // Get the type of the expression
         const char* type = "integer"; // Default to integer
         if (arg->type == NODE_VARIABLE) {
-            Symbol* sym = symtable_lookup(gen->symbols, arg->data.variable.name);
+            Symbol* sym = resolve_variable(gen, arg);
             if (sym) {
                 type = sym->info.var.type;
             }
@@ -128,9 +205,9 @@ static void generate_read_statement(CodeGenerator* gen, ASTNode* node) {
     fprintf(gen->output, "scanf(");
 
     ASTNode* var = node->children[0];
-    Symbol* sym = symtable_lookup(gen->symbols, var->data.variable.name);
+    Symbol* sym = resolve_variable(gen, var);
     if (!sym) {
-        error_report(ERROR_SEMANTIC, SEVERITY_ERROR, var->loc,
+        error_report(ERROR_SEMANTIC, SEVERITY_ERROR, ast_location(var),
                     "Undefined variable in read statement: %s",
                     var->data.variable.name);
         return;
@@ -198,14 +275,8 @@ static void generate_type(CodeGenerator* gen, const char* type) {
 }
 
 
-static void generate_function_declaration(CodeGenerator* gen, ASTNode* node) {
-    verbose_print("Generating function declaration for: %s\n", node->data.function.name);
-    
-    // Store function name for implicit return
-    free(gen->current_function);
-    gen->current_function = strdup(node->data.function.name);
-    gen->needs_return = true;
-    
+// Return type, name and parameter list, up to the closing parenthesis
+static void generate_function_signature(CodeGenerator* gen, ASTNode* node) {
     // Generate return type
     if (node->type == NODE_PROCEDURE) {
         fprintf(gen->output, "void");
@@ -233,10 +304,8 @@ static void generate_function_declaration(CodeGenerator* gen, ASTNode* node) {
             if (!first) fprintf(gen->output, ", ");
             first = false;
             
-            // Look up parameter symbol for bounds information
-            Symbol* sym = symtable_lookup_parameter(gen->symbols, 
-                                                  node->data.function.name, 
-                                                  param->data.parameter.name);
+            // The parameter's symbol, for bounds information
+            Symbol* sym = resolve_parameter(gen, node, param);
             verbose_print("Looking up parameter %s in function %s: %s\n", 
                          param->data.parameter.name,
                          node->data.function.name,
@@ -312,7 +381,19 @@ static void generate_function_declaration(CodeGenerator* gen, ASTNode* node) {
         }
     }
     
-    fprintf(gen->output, ") {\n");
+    fprintf(gen->output, ")");
+}
+
+static void generate_function_declaration(CodeGenerator* gen, ASTNode* node) {
+    verbose_print("Generating function declaration for: %s\n", node->data.function.name);
+    
+    // Store function name for implicit return
+    free(gen->current_function);
+    gen->current_function = strdup(node->data.function.name);
+    gen->needs_return = true;
+    
+    generate_function_signature(gen, node);
+    fprintf(gen->output, " {\n");
     gen->indent_level++;
 
     // Add implicit declaration of function-named variable if it has a return type and not explicitly declared
@@ -333,9 +414,7 @@ static void generate_function_declaration(CodeGenerator* gen, ASTNode* node) {
     if (node->data.function.params) {
         for (int i = 0; i < node->data.function.params->child_count; i++) {
             ASTNode* param = node->data.function.params->children[i];
-            Symbol* sym = symtable_lookup_parameter(gen->symbols,
-                                                  node->data.function.name,
-                                                  param->data.parameter.name);
+            Symbol* sym = resolve_parameter(gen, node, param);
             if (sym && sym->info.var.is_array && sym->info.var.bounds) {
                 for (int dim = 0; dim < sym->info.var.dimensions; dim++) {
                     DimensionBounds* bound = &sym->info.var.bounds->bounds[dim];
@@ -379,7 +458,7 @@ static void generate_function_declaration(CodeGenerator* gen, ASTNode* node) {
 
 
 static void generate_record_type(CodeGenerator* gen, ASTNode* node) {
-    RecordTypeData* record = &node->record_type;
+    RecordTypeData* record = ast_record_type(node);
     
     if (record->is_typedef && !record->is_nested) {
         fprintf(gen->output, "typedef ");
@@ -397,7 +476,7 @@ static void generate_record_type(CodeGenerator* gen, ASTNode* node) {
         if (field->type == NODE_RECORD_FIELD) {
             if (field->children[0] && field->children[0]->type == NODE_RECORD_TYPE) {
                 // Mark as nested record before generating
-                field->children[0]->record_type.is_nested = true;
+                ast_record_type(field->children[0])->is_nested = true;
                 // Nested record
                 generate_record_type(gen, field->children[0]);
                 fprintf(gen->output, " %s", field->data.variable.name);
@@ -410,9 +489,10 @@ static void generate_record_type(CodeGenerator* gen, ASTNode* node) {
                 fprintf(gen->output, " %s", field->data.variable.name);
                 
                 // Handle array fields
-                if (field->data.variable.is_array && field->data.variable.array_info.bounds) {
+                ArrayBoundsData* field_bounds = ast_array_bounds(field);
+                if (field->data.variable.is_array && field_bounds) {
                     for (int j = 0; j < field->data.variable.array_info.dimensions; j++) {
-                        DimensionBounds* bound = &field->data.variable.array_info.bounds->bounds[j];
+                        DimensionBounds* bound = &field_bounds->bounds[j];
                         fprintf(gen->output, "[");
                         if (bound->using_range) {
                             if (bound->end.is_constant && bound->start.is_constant) {
@@ -471,13 +551,6 @@ static void generate_record_type(CodeGenerator* gen, ASTNode* node) {
 
 static void generate_field_access(CodeGenerator* gen, ASTNode* node) {
     codegen_generate(gen, node->children[0]); // Generate record expression
-    
-    // Check if arrow (->) or dot (.) should be used
-    Symbol* sym = NULL;
-    if (node->children[0]->type == NODE_IDENTIFIER) {
-        sym = symtable_lookup(gen->symbols, node->children[0]->data.value);
-    }
-    
     fprintf(gen->output, "%s", node->data.value);
 }
 
@@ -499,7 +572,7 @@ static void generate_variable_declaration(CodeGenerator* gen, ASTNode* node) {
         fprintf(gen->output, " %s",
                 node->data.variable.name);
 
-        ArrayBoundsData* bounds = node->data.variable.array_info.bounds;
+        ArrayBoundsData* bounds = ast_array_bounds(node);
         if (bounds) {
             for (int dim = 0; dim < bounds->dimensions; dim++) {
                 fprintf(gen->output, "[");
@@ -603,7 +676,7 @@ static void generate_variable_declaration(CodeGenerator* gen, ASTNode* node) {
 
     // Handle array dimensions
     if (node->data.variable.is_array) {
-        ArrayBoundsData* bounds = node->data.variable.array_info.bounds;
+        ArrayBoundsData* bounds = ast_array_bounds(node);
         if (bounds) {
             // Generate size expressions for each dimension
             for (int dim = 0; dim < bounds->dimensions; dim++) {
@@ -651,7 +724,7 @@ static void generate_variable_declaration(CodeGenerator* gen, ASTNode* node) {
 
     // Generate offset variables for each dimension using ranges
     if (node->data.variable.is_array) {
-        ArrayBoundsData* bounds = node->data.variable.array_info.bounds;
+        ArrayBoundsData* bounds = ast_array_bounds(node);
         if (bounds) {
             for (int dim = 0; dim < bounds->dimensions; dim++) {
                 if (bounds->bounds[dim].using_range) {
@@ -702,7 +775,7 @@ static void generate_array_declaration(CodeGenerator* gen, ASTNode* node) {
     fprintf(gen->output, " %s", node->data.variable.name);
 
     // Handle array dimensions
-    ArrayBoundsData* bounds = node->data.variable.array_info.bounds;
+    ArrayBoundsData* bounds = ast_array_bounds(node);
     if (bounds) {
         verbose_print("Processing array with %d dimensions\n", bounds->dimensions);
         
@@ -821,26 +894,52 @@ static void generate_array_declaration(CodeGenerator* gen, ASTNode* node) {
     gen->array_context.in_array_declaration = false;
 }
 
-static void generate_number_literal(CodeGenerator* gen, const char* number) {
-    if (!number) return;
-    
-    // Handle trailing decimal point (e.g., "123." -> "123.0")
-    char* decimal_point = strrchr(number, '.');
-    if (decimal_point && *(decimal_point + 1) == '\0') {
-        // If it ends with a decimal point, append "0"
-        fprintf(gen->output, "%s0", number);
-        return;
+// Emits a literal from its decoded value. Octal is respelled for C and
+// reals get the shortest spelling that reads back as the same double.
+static void generate_number_literal(CodeGenerator* gen, const NumberLiteral* number, const char* text) {
+    // A negated for-loop step is stored negative; prefixed forms get the
+    // sign in front and print the magnitude
+    uint64_t magnitude = (uint64_t)number->integer;
+    if (number->kind != NUMBER_DECIMAL && number->kind != NUMBER_REAL && number->integer < 0) {
+        fputc('-', gen->output);
+        magnitude = 0 - magnitude;
     }
-    
-    // Handle octal notation (e.g., "0o777" -> "0777")
-    if (strlen(number) >= 2 && number[0] == '0' && (number[1] == 'o' || number[1] == 'O')) {
-        // Print '0' followed by the rest of the number after 'o'
-        fprintf(gen->output, "0%s", number + 2);
-        return;
+    switch (number->kind) {
+        case NUMBER_DECIMAL:
+            fprintf(gen->output, "%" PRId64, number->integer);
+            return;
+        case NUMBER_HEX:
+            fprintf(gen->output, "0x%" PRIX64, magnitude);
+            return;
+        case NUMBER_OCTAL:
+            fprintf(gen->output, "0%" PRIo64, magnitude);
+            return;
+        case NUMBER_BINARY: {
+            uint64_t value = magnitude;
+            int bit = 63;
+            while (bit > 0 && !(value >> bit)) bit--;
+            fprintf(gen->output, "0b");
+            for (; bit >= 0; bit--) {
+                fputc((value >> bit) & 1 ? '1' : '0', gen->output);
+            }
+            return;
+        }
+        case NUMBER_REAL: {
+            char buffer[32];
+            for (int precision = 1; precision <= 17; precision++) {
+                snprintf(buffer, sizeof(buffer), "%.*g", precision, number->real);
+                if (strtod(buffer, NULL) == number->real) break;
+            }
+            bool has_point = strpbrk(buffer, ".eEn") != NULL;  // n covers inf/nan
+            fprintf(gen->output, "%s%s%s", buffer, has_point ? "" : ".0", number->single ? "f" : "");
+            return;
+        }
+        case NUMBER_NONE:
+            break;
     }
-    
-    // All other numbers can be written as-is (hex, binary, regular decimals)
-    fprintf(gen->output, "%s", number);
+
+    // Not a literal the lexer decoded; emit the text as written
+    if (text) fprintf(gen->output, "%s", text);
 }
 
 static void generate_bounds_check(CodeGenerator* gen, ASTNode* node, Symbol* sym) {
@@ -890,6 +989,32 @@ static void generate_bounds_check(CodeGenerator* gen, ASTNode* node, Symbol* sym
 }
 
 
+// An array the parser couldn't resolve: the current scope first, then
+// the current function's parameters and locals
+static Symbol* find_array_symbol(CodeGenerator* gen, const char* array_name) {
+    verbose_print("Looking up symbol for array: %s\n", array_name);
+    verbose_print("\nDumping symbol table state before lookups:\n");
+    symtable_debug_dump_all(gen->symbols);
+
+    Symbol* sym = symtable_lookup_current_scope(gen->symbols, array_name);
+    verbose_print("Current scope lookup result: %s\n", sym ? "found" : "not found");
+    if (sym || !gen->current_function) return sym;
+
+    Symbol* func = symtable_lookup(gen->symbols, gen->current_function);
+    if (!func || (func->kind != SYMBOL_FUNCTION && func->kind != SYMBOL_PROCEDURE)) return NULL;
+    for (int i = 0; i < func->info.func.param_count; i++) {
+        if (strcmp(func->info.func.parameters[i]->name, array_name) == 0) {
+            return func->info.func.parameters[i];
+        }
+    }
+    for (int i = 0; i < func->info.func.local_var_count; i++) {
+        if (strcmp(func->info.func.local_variables[i]->name, array_name) == 0) {
+            return func->info.func.local_variables[i];
+        }
+    }
+    return NULL;
+}
+
 static void generate_array_access(CodeGenerator* gen, ASTNode* node) {
     verbose_print("\n=== STARTING ARRAY ACCESS GENERATION ===\n");
     
@@ -909,36 +1034,7 @@ static void generate_array_access(CodeGenerator* gen, ASTNode* node) {
     }
     
     if (array_name) {
-        verbose_print("Looking up symbol for array: %s\n", array_name);
-        verbose_print("\nDumping symbol table state before lookups:\n");
-        symtable_debug_dump_all(gen->symbols);
-        
-        // Try current scope first (includes local variables)
-        sym = symtable_lookup_current_scope(gen->symbols, array_name);
-        verbose_print("Current scope lookup result: %s\n", sym ? "found" : "not found");
-        
-        if (!sym && gen->current_function) {
-            // Look up in function's parameters and locals in global scope
-            Symbol* func = symtable_lookup(gen->symbols, gen->current_function);
-            if (func && (func->kind == SYMBOL_FUNCTION || func->kind == SYMBOL_PROCEDURE)) {
-                // Check parameters
-                for (int i = 0; i < func->info.func.param_count; i++) {
-                    if (strcmp(func->info.func.parameters[i]->name, array_name) == 0) {
-                        sym = func->info.func.parameters[i];
-                        break;
-                    }
-                }
-                // Check locals if not found in parameters
-                if (!sym) {
-                    for (int i = 0; i < func->info.func.local_var_count; i++) {
-                        if (strcmp(func->info.func.local_variables[i]->name, array_name) == 0) {
-                            sym = func->info.func.local_variables[i];
-                            break;
-                        }
-                    }
-                }
-            }
-        }
+        sym = node->data.array_access.symbol ? node->data.array_access.symbol : find_array_symbol(gen, array_name);
 
         debug_codegen_symbol_resolution(gen, 
             node->children[0]->type == NODE_IDENTIFIER ? 
@@ -1162,101 +1258,158 @@ static void generate_while_statement(CodeGenerator* gen, ASTNode* node) {
     fprintf(gen->output, "}\n");
 }
 
-static void generate_binary_op(CodeGenerator* gen, ASTNode* node) {
-    verbose_print("Generating binary operation:\n");
-    verbose_print("  Operator: ");
-    debug_print_token_type(node->data.binary_op.op);
-    verbose_print("\n  Left operand type: ");
-    if (node->children[0]) debug_print_node_type(node->children[0]->type);
-    verbose_print("\n  Right operand type: ");
-    if (node->children[1]) debug_print_node_type(node->children[1]->type);
-    verbose_print("\n");
-
-    bool needs_parens = !gen->in_expression;
-    if (needs_parens) fprintf(gen->output, "(");
-    
-    bool old_in_expr = gen->in_expression;
-    gen->in_expression = true;
-    
-    fprintf(gen->output, "(");
-    codegen_generate(gen, node->children[0]);
-    
-    // Output operator
-    const char* op_str = NULL;
-    switch (node->data.binary_op.op) {
+static const char* binary_op_text(TokenType op) {
+    switch (op) {
         // Arithmetic operators
-        case TOK_PLUS: op_str = " + "; break;
-        case TOK_MINUS: op_str = " - "; break;
-        case TOK_MULTIPLY: op_str = " * "; break;
-        case TOK_DIVIDE: op_str = " / "; break;
-        case TOK_MOD: op_str = " % "; break;
+        case TOK_PLUS: return " + ";
+        case TOK_MINUS: return " - ";
+        case TOK_MULTIPLY: return " * ";
+        case TOK_DIVIDE: return " / ";
+        case TOK_MOD: return " % ";
 
         // Bitwise operators
-        case TOK_RSHIFT: op_str = " >> "; break;
-        case TOK_LSHIFT: op_str = " << "; break;
-        case TOK_BITAND: op_str = " & "; break;
-        case TOK_BITOR: op_str = " | "; break;
-        case TOK_BITXOR: op_str = " ^ "; break;
+        case TOK_RSHIFT: return " >> ";
+        case TOK_LSHIFT: return " << ";
+        case TOK_BITAND: return " & ";
+        case TOK_BITOR: return " | ";
+        case TOK_BITXOR: return " ^ ";
 
         // Logical operators
-        case TOK_AND: op_str = " && "; break;
-        case TOK_OR: op_str = " || "; break;
-        
+        case TOK_AND: return " && ";
+        case TOK_OR: return " || ";
+
         // Comparison operators
-        case TOK_EQ: op_str = " == "; break;
-        case TOK_NE: op_str = " != "; break;
-        case TOK_LT: op_str = " < "; break;
-        case TOK_LE: op_str = " <= "; break;
-        case TOK_GT: op_str = " > "; break;
-        case TOK_GE: op_str = " >= "; break;
+        case TOK_EQ: return " == ";
+        case TOK_NE: return " != ";
+        case TOK_LT: return " < ";
+        case TOK_LE: return " <= ";
+        case TOK_GT: return " > ";
+        case TOK_GE: return " >= ";
         default:
-            op_str = " /* unknown op */ ";
-            verbose_print("  WARNING: Unknown operator type: %d\n", node->data.binary_op.op);
+            verbose_print("  WARNING: Unknown operator type: %d\n", op);
+            return " /* unknown op */ ";
     }
-    fprintf(gen->output, "%s", op_str);
-    verbose_print("  Writing operator: %s\n", op_str);
-    
-    codegen_generate(gen, node->children[1]);
-    fprintf(gen->output, ")");
-    
-    gen->in_expression = old_in_expr;
-    if (needs_parens) fprintf(gen->output, ")");
 }
 
-// Also update the unary operation generation for consistency
-static void generate_unary(CodeGenerator* gen, ASTNode* node) {
-    if (!node) return;
+// An operator node part way through generation
+typedef struct {
+    ASTNode* node;
+    int stage;              // Operands written so far
+    bool needs_parens;
+    bool old_in_expr;
+} OperatorFrame;
+
+static bool push_operator(OperatorFrame** frames, size_t* count, size_t* capacity, ASTNode* node) {
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 32;
+        OperatorFrame* grown = (OperatorFrame*)realloc(*frames, new_capacity * sizeof(OperatorFrame));
+        if (!grown) {
+            error_report(ERROR_INTERNAL, SEVERITY_ERROR, ast_location(node),
+                        "Failed to allocate memory for expression generation");
+            return false;
+        }
+        *frames = grown;
+        *capacity = new_capacity;
+    }
+    (*frames)[(*count)++] = (OperatorFrame){.node = node};
+    return true;
+}
 
-    bool needs_parens = !gen->in_expression;
-    if (needs_parens) fprintf(gen->output, "(");
+// Writes a tree of binary and unary operators. The operators wait on an
+// explicit stack, so deeply nested expressions can't overflow the call
+// stack; their other operands go through codegen_generate.
+static void generate_operators(CodeGenerator* gen, ASTNode* root) {
+    OperatorFrame* frames = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    if (!push_operator(&frames, &count, &capacity, root)) return;
+
+    while (count > 0) {
+        OperatorFrame* frame = &frames[count - 1];
+        ASTNode* node = frame->node;
+        if (!node || (node->type != NODE_BINARY_OP && node->type != NODE_UNARY_OP)) {
+            count--;
+            codegen_generate(gen, node);
+            continue;
+        }
 
-    switch (node->data.unary_op.op) {
-        case TOK_MINUS: fprintf(gen->output, "-"); break;
-        case TOK_NOT: fprintf(gen->output, "!"); break;
-        case TOK_BITNOT: fprintf(gen->output, "~"); break;
-        case TOK_DEREF:
-            for (int i = 0; i < node->data.unary_op.deref_count; i++) {
-                fprintf(gen->output, "*");
+        if (frame->stage == 0) {
+            // codegen_generate has already announced the root
+            if (node != root) {
+                verbose_print("Generating code for node type: %d\n", node->type);
+                debug_codegen_state(gen, "starting node generation");
             }
-            fprintf(gen->output, "("); 
-            break;
-        case TOK_ADDR_OF: fprintf(gen->output, "&("); break;
-        default: fprintf(gen->output, "/* unknown unary op */");
-    }
+            debug_codegen_expression(gen, node, "operator expression");
+        }
 
-    bool old_in_expr = gen->in_expression;
-    gen->in_expression = true;
-    
-    codegen_generate(gen, node->children[0]);
-    
-    // Close parenthesis for pointer operations
-    if (node->data.unary_op.op == TOK_DEREF || 
-        node->data.unary_op.op == TOK_ADDR_OF) {
-        fprintf(gen->output, ")");
+        ASTNode* next = NULL;
+        if (node->type == NODE_BINARY_OP) {
+            switch (frame->stage) {
+                case 0:
+                    verbose_print("Generating binary operation:\n");
+                    verbose_print("  Operator: ");
+                    debug_print_token_type(node->data.binary_op.op);
+                    verbose_print("\n  Left operand type: ");
+                    if (node->children[0]) debug_print_node_type(node->children[0]->type);
+                    verbose_print("\n  Right operand type: ");
+                    if (node->children[1]) debug_print_node_type(node->children[1]->type);
+                    verbose_print("\n");
+                    frame->needs_parens = !gen->in_expression;
+                    if (frame->needs_parens) fprintf(gen->output, "(");
+                    frame->old_in_expr = gen->in_expression;
+                    gen->in_expression = true;
+                    fprintf(gen->output, "(");
+                    next = node->children[0];
+                    break;
+                case 1: {
+                    const char* op_str = binary_op_text(node->data.binary_op.op);
+                    fprintf(gen->output, "%s", op_str);
+                    verbose_print("  Writing operator: %s\n", op_str);
+                    next = node->children[1];
+                    break;
+                }
+                default:
+                    fprintf(gen->output, ")");
+                    gen->in_expression = frame->old_in_expr;
+                    if (frame->needs_parens) fprintf(gen->output, ")");
+                    count--;
+                    continue;
+            }
+        } else if (node->data.unary_op.op == TOK_AT || node->data.unary_op.op == TOK_DEREF) {
+            if (frame->stage > 0) {
+                count--;
+                continue;
+            }
+            verbose_print("Generating unary operation\n");
+            if (node->data.unary_op.op == TOK_DEREF) fprintf(gen->output, "*");
+            next = node->children[0];
+        } else if (frame->stage == 0) {
+            verbose_print("Generating unary operation\n");
+            frame->needs_parens = !gen->in_expression;
+            if (frame->needs_parens) fprintf(gen->output, "(");
+            switch (node->data.unary_op.op) {
+                case TOK_MINUS: fprintf(gen->output, "-"); break;
+                case TOK_NOT: fprintf(gen->output, "!"); break;
+                case TOK_BITNOT: fprintf(gen->output, "~"); break;
+                case TOK_ADDR_OF: fprintf(gen->output, "&("); break;
+                default: fprintf(gen->output, "/* unknown unary op */");
+            }
+            frame->old_in_expr = gen->in_expression;
+            gen->in_expression = true;
+            next = node->children[0];
+        } else {
+            // Close parenthesis for pointer operations
+            if (node->data.unary_op.op == TOK_ADDR_OF) fprintf(gen->output, ")");
+            gen->in_expression = frame->old_in_expr;
+            if (frame->needs_parens) fprintf(gen->output, ")");
+            count--;
+            continue;
+        }
+
+        frame->stage++;
+        if (!push_operator(&frames, &count, &capacity, next)) break;
     }
-    
-    gen->in_expression = old_in_expr;
-    if (needs_parens) fprintf(gen->output, ")");
+    free(frames);
 }
 
 static void generate_repeat_statement(CodeGenerator* gen, ASTNode* node) {
@@ -1310,8 +1463,15 @@ static void generate_for_statement(CodeGenerator* gen, ASTNode* node) {
     
     if (has_step && node->children[3]->type == NODE_NUMBER) {
         // Check if the step is a negative number
-        const char* step_value = node->children[3]->data.value;
-        step_is_negative = (step_value && step_value[0] == '-');
+        const NumberLiteral* step = &node->children[3]->data.number.literal;
+        if (step->kind == NUMBER_REAL) {
+            step_is_negative = step->real < 0;
+        } else if (step->kind != NUMBER_NONE) {
+            step_is_negative = step->integer < 0;
+        } else {
+            const char* step_value = node->children[3]->data.value;
+            step_is_negative = (step_value && step_value[0] == '-');
+        }
     }
     
     // Generate appropriate comparison operator based on step direction
@@ -1321,7 +1481,7 @@ static void generate_for_statement(CodeGenerator* gen, ASTNode* node) {
     // Increment or decrement
     fprintf(gen->output, "; %s += ", var_name);
     if (has_step) {
-        fprintf(gen->output, "%s", node->children[3]->data.value);
+        generate_number_literal(gen, &node->children[3]->data.number.literal, node->children[3]->data.value);
     } else {
         fprintf(gen->output, "1");
     }
@@ -1342,8 +1502,11 @@ static void generate_call(CodeGenerator* gen, ASTNode* node) {
     verbose_print("\n=== ENTERING GENERATE_FUNCTION_CALL ===\n");
     verbose_print("Function name: %s\n", node->data.value);
 
-    // Look up function/procedure symbol to get parameter information
-    Symbol* func_sym = symtable_lookup(gen->symbols, node->data.value);
+    // The function/procedure symbol, for parameter information
+    Symbol* func_sym = node->data.name.symbol ? node->data.name.symbol : symtable_lookup(gen->symbols, node->data.value);
+    if (!func_sym && g_config.stream && node->child_count > 0) {
+        note_forward_call(gen, node);
+    }
     //if (!func_sym || (func_sym->kind != SYMBOL_FUNCTION && func_sym->kind != SYMBOL_PROCEDURE)) {
     //    verbose_print("Function symbol not found or invalid\n");
     //    return;
@@ -1355,16 +1518,8 @@ static void generate_call(CodeGenerator* gen, ASTNode* node) {
     for (int i = 0; i < node->child_count; i++) {
         if (i > 0) fprintf(gen->output, ", ");
         bool needs_address_of = false;
-        if (func_sym) {
-            if (i < func_sym->info.func.param_count) {
-                Symbol* param = func_sym->info.func.parameters[i];
-                if (param && param->info.var.needs_deref && !param->info.var.is_array && param->info.var.param_mode &&
-                    (strcasecmp(param->info.var.param_mode, "out") == 0 || 
-                    strcasecmp(param->info.var.param_mode, "inout") == 0|| 
-                    strcasecmp(param->info.var.param_mode, "in/out") == 0)) {
-                    needs_address_of = true;
-                }
-            }
+        if (func_sym && i < func_sym->info.func.param_count) {
+            needs_address_of = passes_by_reference(func_sym->info.func.parameters[i]);
         }
 
         // Add address-of operator if needed
@@ -1392,6 +1547,18 @@ static void generate_call(CodeGenerator* gen, ASTNode* node) {
     verbose_print("=== EXITING GENERATE_FUNCTION_CALL ===\n");
 }
 
+// Standard includes, written ahead of the declarations
+void codegen_write_headers(CodeGenerator* gen) {
+    fprintf(gen->output, "#include <stdbool.h>\n");
+    fprintf(gen->output, "#include <stdio.h>\n\n");
+    fprintf(gen->output, "#include <memory.h>\n\n");
+}
+
+void codegen_generate_declaration(CodeGenerator* gen, ASTNode* node) {
+    codegen_generate(gen, node);
+    fprintf(gen->output, "\n");
+}
+
 void codegen_generate(CodeGenerator* gen, ASTNode* node) {
     if (!node) return;
     
@@ -1400,15 +1567,11 @@ void codegen_generate(CodeGenerator* gen, ASTNode* node) {
 
     switch (node->type) {
         case NODE_PROGRAM:
-            // Generate standard includes
-            fprintf(gen->output, "#include <stdbool.h>\n");
-            fprintf(gen->output, "#include <stdio.h>\n\n");
-            fprintf(gen->output, "#include <memory.h>\n\n");
+            codegen_write_headers(gen);
             
             // Generate all declarations and definitions
             for (int i = 0; i < node->child_count; i++) {
-                codegen_generate(gen, node->children[i]);
-                fprintf(gen->output, "\n");
+                codegen_generate_declaration(gen, node->children[i]);
             }
             break;
             
@@ -1471,8 +1634,8 @@ void codegen_generate(CodeGenerator* gen, ASTNode* node) {
             break;
             
         case NODE_BINARY_OP:
-            debug_codegen_expression(gen, node, "operator expression");
-            generate_binary_op(gen, node);
+        case NODE_UNARY_OP:
+            generate_operators(gen, node);
             break;
             
         case NODE_IDENTIFIER:
@@ -1495,7 +1658,7 @@ void codegen_generate(CodeGenerator* gen, ASTNode* node) {
             break;
             
         case NODE_NUMBER:
-            generate_number_literal(gen, node->data.value);
+            generate_number_literal(gen, &node->data.number.literal, node->data.value);
             //fprintf(gen->output, "%s", node->data.value);
             break;
 
@@ -1536,18 +1699,6 @@ void codegen_generate(CodeGenerator* gen, ASTNode* node) {
             generate_read_statement(gen, node);
             break;
 
-        case NODE_UNARY_OP:
-            debug_codegen_expression(gen, node, "operator expression");
-            verbose_print("Generating unary operation\n");
-            if (node->data.unary_op.op == TOK_AT) {
-                codegen_generate(gen, node->children[0]);
-            } else if (node->data.unary_op.op == TOK_DEREF) {
-                fprintf(gen->output, "*");
-                codegen_generate(gen, node->children[0]);
-            } else {
-                generate_unary(gen, node);
-            }
-            break;
         case NODE_TYPE_DECLARATION:
             generate_record_type(gen, node->children[0]);
             break;
@@ -1559,9 +1710,25 @@ void codegen_generate(CodeGenerator* gen, ASTNode* node) {
             break;
         default:
             error_report(ERROR_INTERNAL, SEVERITY_ERROR,
-                        node->loc,
+                        ast_location(node),
                         "Unsupported node type %d in code generation", node->type);
             break;
     }
     debug_codegen_state(gen, "completed node generation");
-}
\ No newline at end of file
+}
+void codegen_generate_prototypes(CodeGenerator* gen, ASTNode* ast) {
+    if (!ast) return;
+
+    fprintf(gen->output, "#include <stdbool.h>\n\n");
+    for (int i = 0; i < ast->child_count; i++) {
+        ASTNode* node = ast->children[i];
+        if (node->type == NODE_TYPE_DECLARATION) {
+            // Parameters can have record types
+            codegen_generate(gen, node);
+            fprintf(gen->output, "\n");
+        } else if (node->type == NODE_FUNCTION || node->type == NODE_PROCEDURE) {
+            generate_function_signature(gen, node);
+            fprintf(gen->output, ";\n");
+        }
+    }
+}
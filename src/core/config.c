@@ -19,7 +19,11 @@ static const TranslatorConfig DEFAULT_CONFIG = {
     .allow_mixed_array_access = true,
     .input_filename = NULL,
     .output_filename = NULL,
-    .enable_verbose = false
+    .enable_verbose = false,
+    .jobs = 1,
+    .print_stats = false,
+    .check_signatures = false,
+    .stream = false
 };
 
 void config_init(void) {
@@ -41,6 +45,7 @@ void config_cleanup(void) {
 
 static void print_usage(const char* program_name) {
     fprintf(stderr, "Usage: %s [options] input_file [output_file]\n", program_name);
+    fprintf(stderr, "An input_file of - reads standard input.\n");
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -a, --assignment=STYLE    Set assignment style (colon-equals|equals)\n");
     fprintf(stderr, "  -i, --indexing=STYLE      Set array indexing style (zero|one)\n");
@@ -48,6 +53,13 @@ static void print_usage(const char* program_name) {
     fprintf(stderr, "  -o, --operators=STYLE     Set operator style (standard|dotted|mixed)\n");
     fprintf(stderr, "  -m, --mixed-arrays=STYLE  Allow mixed array access ([] and ()) (true|false)\n");
     fprintf(stderr, "  -d, --debug=FLAGS         Set debug flags (lexer,parser,ast,symbols,codegen,all)\n");
+    fprintf(stderr, "  -j, --jobs=N              Lex and parse large inputs on N threads\n");
+    fprintf(stderr, "      --stats               Report AST memory use, error recovery time and\n");
+    fprintf(stderr, "                            symbol lookups\n");
+    fprintf(stderr, "      --check-signatures    Check function signatures, skipping their bodies,\n");
+    fprintf(stderr, "                            and write C prototypes for them\n");
+    fprintf(stderr, "      --stream              Translate and free each function before reading\n");
+    fprintf(stderr, "                            the next, keeping only globals and signatures\n");
     fprintf(stderr, "  -h, --help                Display this help message\n");
 }
 
@@ -135,6 +147,10 @@ bool config_parse_args(int argc, char** argv) {
         {"operators", required_argument, 0, 'o'},
         {"mixed-arrays", required_argument, 0, 'm'},
         {"debug", required_argument, 0, 'd'},
+        {"jobs", required_argument, 0, 'j'},
+        {"stats", no_argument, 0, 's'},
+        {"check-signatures", no_argument, 0, 'c'},
+        {"stream", no_argument, 0, 'S'},
         {"verbose", no_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
@@ -143,7 +159,7 @@ bool config_parse_args(int argc, char** argv) {
     int opt;
     int option_index = 0;
 
-    while ((opt = getopt_long(argc, argv, "a:i:p:o:d:mh", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "a:i:p:o:d:j:mh", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'a':
                 if (!parse_assignment_style(optarg)) {
@@ -180,6 +196,29 @@ bool config_parse_args(int argc, char** argv) {
                 }
                 break;
 
+            case 'j': {
+                char* end;
+                long jobs = strtol(optarg, &end, 10);
+                if (*end != '\0' || jobs < 1 || jobs > 256) {
+                    fprintf(stderr, "Invalid job count: %s\n", optarg);
+                    return false;
+                }
+                g_config.jobs = (int)jobs;
+                break;
+            }
+
+            case 's':
+                g_config.print_stats = true;
+                break;
+
+            case 'c':
+                g_config.check_signatures = true;
+                break;
+
+            case 'S':
+                g_config.stream = true;
+                break;
+
             case 'm':
                 g_config.allow_mixed_array_access = true;
                 break;
@@ -211,5 +250,11 @@ bool config_parse_args(int argc, char** argv) {
         g_config.output_filename = strdup(argv[optind]);
     }
 
+    if (g_config.stream && (g_config.check_signatures || !g_config.output_filename)) {
+        fprintf(stderr, "Error: --stream needs an output file and can't check signatures only\n");
+        print_usage(argv[0]);
+        return false;
+    }
+
     return true;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
+#define PLIKE_DEBUG_IMPL
 #include "debug.h"
 #include "config.h"
+#include "errors.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -193,7 +195,7 @@ void debug_print_ast_to(ASTNode* node, int indent, bool force, FILE* dest) {
             if (node->data.variable.is_array) {
                 print_indent_to(indent, dest);
                 fprintf(dest, "Dimensions: %d\n", node->data.variable.array_info.dimensions);
-                if (node->data.variable.array_info.bounds) {
+                if (ast_array_bounds(node)) {
                     print_indent_to(indent, dest);
                     fprintf(dest, "Has Bounds Information: yes\n");
                 }
@@ -227,7 +229,7 @@ void debug_print_ast_to(ASTNode* node, int indent, bool force, FILE* dest) {
             break;
     }
     print_indent_to(indent, dest);
-    fprintf(dest, "Location: %d:%d\n", node->loc.line, node->loc.column);
+    fprintf(dest, "Location: %u:%u\n", node->loc.line, (unsigned)node->loc.column);
 
     // Print children count and recursively print children
     if (node->child_count > 0) {
@@ -278,7 +280,7 @@ void debug_print_ast(ASTNode* node, int indent, bool force) {
             if (node->data.variable.is_array) {
                 print_indent(indent);
                 fprintf(debug_file, "Dimensions: %d\n", node->data.variable.array_info.dimensions);
-                if (node->data.variable.array_info.bounds) {
+                if (ast_array_bounds(node)) {
                     print_indent(indent);
                     fprintf(debug_file, "Has Bounds Information: yes\n");
                 }
@@ -312,7 +314,7 @@ void debug_print_ast(ASTNode* node, int indent, bool force) {
             break;
     }
     print_indent(indent);
-    fprintf(debug_file, "Location: %d:%d\n", node->loc.line, node->loc.column);
+    fprintf(debug_file, "Location: %u:%u\n", node->loc.line, (unsigned)node->loc.column);
 
     // Print children count and recursively print children
     if (node->child_count > 0) {
@@ -347,6 +349,25 @@ void debug_trace_exit(const char* function_name, ASTNode* result) {
 }*/
 
 void debug_print_error_context(SourceLocation loc) {
+    // Slice the lines from the lexer's index when it covers them
+    const char* text;
+    size_t length;
+    if (error_source_line(loc.line, &text, &length)) {
+        int first = loc.line > 2 ? loc.line - 2 : 1;
+        for (int line = first; line <= loc.line; line++) {
+            if (error_source_line(line, &text, &length)) {
+                fprintf(debug_file, "%4d | %.*s\n", line, (int)length, text);
+            }
+        }
+        fprintf(debug_file, "     | ");
+        int column = error_source_column(loc.line, loc.column);
+        for (int i = 1; i < column; i++) {
+            fprintf(debug_file, " ");
+        }
+        fprintf(debug_file, "^\n");
+        return;
+    }
+
     FILE* source = fopen(loc.filename, "r");
     if (!source) return;
 
@@ -394,10 +415,8 @@ void debug_print_symbol_scope(Scope* scope, int indent) {
             scope->type == SCOPE_FUNCTION ? "Function" : "Block");
     
     // Print all symbols in this scope
-    for (int i = 0; i < HASH_SIZE; i++) {
-        for (Symbol* sym = scope->symbols[i]; sym; sym = sym->next) {
-            debug_print_symbol(sym, indent + 1);
-        }
+    for (int i = 0; i < scope->symbol_count; i++) {
+        debug_print_symbol(scope->symbols[i], indent + 1);
     }
 }
 
@@ -914,10 +933,8 @@ static void generate_scope_dot(FILE* dot, Scope* scope, int parent_id) {
     }
     
     // Generate symbols in this scope
-    for (int i = 0; i < HASH_SIZE; i++) {
-        for (Symbol* sym = scope->symbols[i]; sym; sym = sym->next) {
-            generate_symbol_dot(dot, sym, scope_id);
-        }
+    for (int i = 0; i < scope->symbol_count; i++) {
+        generate_symbol_dot(dot, scope->symbols[i], scope_id);
     }
 }
 
@@ -1018,7 +1035,7 @@ static void generate_dot_node(FILE* dot, ASTNode* node, int parent_id) {
 
     // Add location information if available
     if (node->loc.line > 0) {
-        fprintf(dot, "\\nLine: %d, Col: %d", node->loc.line, node->loc.column);
+        fprintf(dot, "\\nLine: %u, Col: %u", node->loc.line, (unsigned)node->loc.column);
     }
     
     // Close label and add style attributes
@@ -9,24 +9,23 @@
 
 static struct {
     int count;
+    int dropped;            // Reported past MAX_ERRORS
     bool panic_mode;
     Error errors[MAX_ERRORS];
     char* current_file;
-    char** source_lines;
-    int source_line_count;
+    const Lexer* source;
 } error_state = {0};
 
+// Errors reported by a thread that has muted them are only counted there
+static _Thread_local bool muting = false;
+static _Thread_local int muted_count = 0;
+
 void error_init(void) {
     memset(&error_state, 0, sizeof(error_state));
 }
 
 static void store_error(ErrorType type, ErrorSeverity severity, 
                        SourceLocation location, const char* message) {
-    if (error_state.count >= MAX_ERRORS) {
-        log_error("Too many errors. Aborting.\n");
-        exit(1);
-    }
-
     Error* error = &error_state.errors[error_state.count++];
     error->type = type;
     error->severity = severity;
@@ -35,22 +34,59 @@ static void store_error(ErrorType type, ErrorSeverity severity,
     error->error_code = error_state.count;
 
     // Store source line if available
-    if (error_state.source_lines && location.line > 0 && 
-        location.line <= error_state.source_line_count) {
-        error->source_line = strdup(error_state.source_lines[location.line - 1]);
-    } else {
+    if (!error_source_line(location.line, &error->source_line, &error->source_line_length)) {
         error->source_line = NULL;
+        error->source_line_length = 0;
+    }
+}
+
+void error_set_source(const Lexer* lexer) {
+    error_state.source = lexer;
+}
+
+void error_clear_source(const Lexer* lexer) {
+    if (error_state.source == lexer) {
+        error_state.source = NULL;
     }
 }
 
+bool error_source_line(int line, const char** text, size_t* length) {
+    if (!error_state.source) return false;
+    return lexer_line_slice(error_state.source, line, text, length);
+}
+
+int error_source_column(int line, int column) {
+    if (!error_state.source) return column;
+    return lexer_character_column(error_state.source, line, column);
+}
+
 void error_report(ErrorType type, ErrorSeverity severity, 
                  SourceLocation location, const char* format, ...) {
+    if (muting) {
+        muted_count++;
+        return;
+    }
+
+    // Past the limit errors are dropped, and the parser stops at the next one
+    if (error_state.count >= MAX_ERRORS) {
+        if (error_state.dropped++ == 0) {
+            log_error("Too many errors. Aborting.\n");
+        }
+        if (severity == SEVERITY_FATAL) {
+            error_print_summary();
+            exit(1);
+        }
+        return;
+    }
+
     char message[MAX_ERROR_MESSAGE];
     va_list args;
     va_start(args, format);
     vsnprintf(message, sizeof(message), format, args);
     va_end(args);
 
+    // Locations count bytes; report characters
+    location.column = error_source_column(location.line, location.column);
     store_error(type, severity, location, message);
 
     // Print error immediately
@@ -62,9 +98,9 @@ void error_report(ErrorType type, ErrorSeverity severity,
             message);
 
     // Print source line and error indicator if available
-    if (error_state.source_lines && location.line > 0 && 
-        location.line <= error_state.source_line_count) {
-        log_error("%s\n", error_state.source_lines[location.line - 1]);
+    Error* error = &error_state.errors[error_state.count - 1];
+    if (error->source_line) {
+        log_error("%.*s\n", (int)error->source_line_length, error->source_line);
         for (int i = 0; i < location.column - 1; i++) {
             log_error(" ");
         }
@@ -97,6 +133,10 @@ void error_at_current(const char* format, ...) {
     log_error("Error: %s\n", message);
 }
 
+bool error_limit_reached(void) {
+    return error_state.count >= MAX_ERRORS;
+}
+
 bool error_occurred(void) {
     return error_state.count > 0;
 }
@@ -108,9 +148,9 @@ int error_count(void) {
 void error_clear(void) {
     for (int i = 0; i < error_state.count; i++) {
         free(error_state.errors[i].message);
-        free(error_state.errors[i].source_line);
     }
     error_state.count = 0;
+    error_state.dropped = 0;
     error_state.panic_mode = false;
 }
 
@@ -157,6 +197,20 @@ const char* error_severity_string(ErrorSeverity severity) {
     }
 }
 
+void error_mute(void) {
+    muting = true;
+    muted_count = 0;
+}
+
+int error_unmute(void) {
+    muting = false;
+    return muted_count;
+}
+
+bool error_muted(void) {
+    return muting;
+}
+
 void error_begin_panic_mode(void) {
     error_state.panic_mode = true;
 }
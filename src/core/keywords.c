@@ -0,0 +1,175 @@
+#include "lexer.h"
+
+// Keyword tables, one per operator style. Shared by the lexer's keyword
+// lookup and the table generator in tools/lexgen.c, so they must not pull
+// in anything beyond lexer.h.
+
+const Keyword keywords_mixed[] = {
+    {"function", TOK_FUNCTION},
+    {"procedure", TOK_PROCEDURE},
+    {"endfunction", TOK_ENDFUNCTION},
+    {"endprocedure", TOK_ENDPROCEDURE},
+    {"var", TOK_VAR},
+    {"begin", TOK_BEGIN},
+    {"end", TOK_END},
+    {"if", TOK_IF},
+    {"then", TOK_THEN},
+    {"else", TOK_ELSE},
+    {"elseif", TOK_ELSEIF},
+    {"endif", TOK_ENDIF},
+    {"while", TOK_WHILE},
+    {"do", TOK_DO},
+    {"endwhile", TOK_ENDWHILE},
+    {"for", TOK_FOR},
+    {"to", TOK_TO},
+    {"step", TOK_STEP},
+    {"endfor", TOK_ENDFOR},
+    {"return", TOK_RETURN},
+    {"repeat", TOK_REPEAT},
+    {"until", TOK_UNTIL},
+    {"in", TOK_IN},
+    {"out", TOK_OUT},
+    {"inout", TOK_INOUT},
+    {"in/out", TOK_INOUT},
+    {"print", TOK_PRINT},
+    {"read", TOK_READ},
+    {"integer", TOK_INTEGER},
+    {"real", TOK_REAL},
+    {"logical", TOK_LOGICAL},
+    {"character", TOK_CHARACTER},
+    {"array", TOK_ARRAY},
+    {"of", TOK_OF},
+    {"type", TOK_TYPE},
+    {"record", TOK_RECORD},
+    {"and", TOK_AND},
+    {".and.", TOK_AND},
+    {"or", TOK_OR},
+    {".or.", TOK_OR},
+    {"not", TOK_NOT},
+    {".not.", TOK_NOT},
+    {"eq", TOK_EQ},
+    {".eq.", TOK_EQ},
+    {"equal", TOK_EQ},
+    {".equal.", TOK_EQ},
+    {"equals", TOK_EQ},
+    {".equals.", TOK_EQ},
+    {"ne", TOK_NE},
+    {".ne.", TOK_NE},
+    {"notequal", TOK_NE},
+    {".notequal.", TOK_NE},
+    {"notequals", TOK_NE},
+    {".notequals.", TOK_NE},
+    {"true", TOK_TRUE},
+    {".true.", TOK_TRUE},
+    {"false", TOK_FALSE},
+    {".false.", TOK_FALSE},
+    {"mod", TOK_MOD},
+    {".mod.", TOK_MOD},
+    {NULL, TOK_EOF}
+};
+
+const Keyword keywords_standard[] = {
+    {"function", TOK_FUNCTION},
+    {"procedure", TOK_PROCEDURE},
+    {"endfunction", TOK_ENDFUNCTION},
+    {"endprocedure", TOK_ENDPROCEDURE},
+    {"var", TOK_VAR},
+    {"begin", TOK_BEGIN},
+    {"end", TOK_END},
+    {"if", TOK_IF},
+    {"then", TOK_THEN},
+    {"else", TOK_ELSE},
+    {"elseif", TOK_ELSEIF},
+    {"endif", TOK_ENDIF},
+    {"while", TOK_WHILE},
+    {"do", TOK_DO},
+    {"endwhile", TOK_ENDWHILE},
+    {"for", TOK_FOR},
+    {"to", TOK_TO},
+    {"step", TOK_STEP},
+    {"endfor", TOK_ENDFOR},
+    {"return", TOK_RETURN},
+    {"repeat", TOK_REPEAT},
+    {"until", TOK_UNTIL},
+    {"in", TOK_IN},
+    {"out", TOK_OUT},
+    {"inout", TOK_INOUT},
+    {"in/out", TOK_INOUT},
+    {"print", TOK_PRINT},
+    {"read", TOK_READ},
+    {"integer", TOK_INTEGER},
+    {"real", TOK_REAL},
+    {"logical", TOK_LOGICAL},
+    {"character", TOK_CHARACTER},
+    {"array", TOK_ARRAY},
+    {"of", TOK_OF},
+    {"type", TOK_TYPE},
+    {"record", TOK_RECORD},
+    {"and", TOK_AND},
+    {"or", TOK_OR},
+    {"not", TOK_NOT},
+    {"eq", TOK_EQ},
+    {"equal", TOK_EQ},
+    {"equals", TOK_EQ},
+    {"ne", TOK_NE},
+    {"notequal", TOK_NE},
+    {"notequals", TOK_NE},
+    {"true", TOK_TRUE},
+    {"false", TOK_FALSE},
+    {"mod", TOK_MOD},
+    {NULL, TOK_EOF}
+};
+
+const Keyword keywords_dotted[] = {
+    {"function", TOK_FUNCTION},
+    {"procedure", TOK_PROCEDURE},
+    {"endfunction", TOK_ENDFUNCTION},
+    {"endprocedure", TOK_ENDPROCEDURE},
+    {"var", TOK_VAR},
+    {"begin", TOK_BEGIN},
+    {"end", TOK_END},
+    {"if", TOK_IF},
+    {"then", TOK_THEN},
+    {"else", TOK_ELSE},
+    {"elseif", TOK_ELSEIF},
+    {"endif", TOK_ENDIF},
+    {"while", TOK_WHILE},
+    {"do", TOK_DO},
+    {"endwhile", TOK_ENDWHILE},
+    {"for", TOK_FOR},
+    {"to", TOK_TO},
+    {"step", TOK_STEP},
+    {"endfor", TOK_ENDFOR},
+    {"return", TOK_RETURN},
+    {"repeat", TOK_REPEAT},
+    {"until", TOK_UNTIL},
+    {"in", TOK_IN},
+    {"out", TOK_OUT},
+    {"inout", TOK_INOUT},
+    {"in/out", TOK_INOUT},
+    {"print", TOK_PRINT},
+    {"read", TOK_READ},
+    {"integer", TOK_INTEGER},
+    {"real", TOK_REAL},
+    {"logical", TOK_LOGICAL},
+    {"character", TOK_CHARACTER},
+    {"array", TOK_ARRAY},
+    {"of", TOK_OF},
+    {"type", TOK_TYPE},
+    {"record", TOK_RECORD},
+    {".and.", TOK_AND},
+    {".or.", TOK_OR},
+    {".not.", TOK_NOT},
+    {".eq.", TOK_EQ},
+    {".equal.", TOK_EQ},
+    {".equals.", TOK_EQ},
+    {".ne.", TOK_NE},
+    {".notequal.", TOK_NE},
+    {".notequals.", TOK_NE},
+    {".true.", TOK_TRUE},
+    {".false.", TOK_FALSE},
+    {".mod.", TOK_MOD},
+    {NULL, TOK_EOF}
+};
+
+const Keyword* keywords = keywords_mixed;
@@ -1,253 +1,435 @@
+#define _DEFAULT_SOURCE
+
 #include "lexer.h"
 #include "errors.h"
 #include "config.h"
 #include "utils.h"
 #include "debug.h"
+#include "lexer_scan.h"
+#include "lexer_tables.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PLIKE_HAVE_MMAP
+#define PLIKE_HAVE_THREADS
+#define PLIKE_HAVE_FD_STREAMS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#endif
 
 #define INITIAL_BUFFER_SIZE 128
 #define MAX_IDENTIFIER_LENGTH 255
 #define MAX_NUMBER_LENGTH 64
+#define MAX_LEXER_MESSAGE 1024  // Same as error_report(), so queued messages truncate alike
 
-const Keyword keywords_mixed[] = {
-    {"function", TOK_FUNCTION},
-    {"procedure", TOK_PROCEDURE},
-    {"endfunction", TOK_ENDFUNCTION},
-    {"endprocedure", TOK_ENDPROCEDURE},
-    {"var", TOK_VAR},
-    {"begin", TOK_BEGIN},
-    {"end", TOK_END},
-    {"if", TOK_IF},
-    {"then", TOK_THEN},
-    {"else", TOK_ELSE},
-    {"elseif", TOK_ELSEIF},
-    {"endif", TOK_ENDIF},
-    {"while", TOK_WHILE},
-    {"do", TOK_DO},
-    {"endwhile", TOK_ENDWHILE},
-    {"for", TOK_FOR},
-    {"to", TOK_TO},
-    {"step", TOK_STEP},
-    {"endfor", TOK_ENDFOR},
-    {"return", TOK_RETURN},
-    {"repeat", TOK_REPEAT},
-    {"until", TOK_UNTIL},
-    {"in", TOK_IN},
-    {"out", TOK_OUT},
-    {"inout", TOK_INOUT},
-    {"in/out", TOK_INOUT},
-    {"print", TOK_PRINT},
-    {"read", TOK_READ},
-    {"integer", TOK_INTEGER},
-    {"real", TOK_REAL},
-    {"logical", TOK_LOGICAL},
-    {"character", TOK_CHARACTER},
-    {"array", TOK_ARRAY},
-    {"of", TOK_OF},
-    {"type", TOK_TYPE},
-    {"record", TOK_RECORD},
-    {"and", TOK_AND},
-    {".and.", TOK_AND},
-    {"or", TOK_OR},
-    {".or.", TOK_OR},
-    {"not", TOK_NOT},
-    {".not.", TOK_NOT},
-    {"eq", TOK_EQ},
-    {".eq.", TOK_EQ},
-    {"equal", TOK_EQ},
-    {".equal.", TOK_EQ},
-    {"equals", TOK_EQ},
-    {".equals.", TOK_EQ},
-    {"ne", TOK_NE},
-    {".ne.", TOK_NE},
-    {"notequal", TOK_NE},
-    {".notequal.", TOK_NE},
-    {"notequals", TOK_NE},
-    {".notequals.", TOK_NE},
-    {"true", TOK_TRUE},
-    {".true.", TOK_TRUE},
-    {"false", TOK_FALSE},
-    {".false.", TOK_FALSE},
-    {"mod", TOK_MOD},
-    {".mod.", TOK_MOD},
-    {NULL, TOK_EOF}
-};
-
-const Keyword keywords_standard[] = {
-    {"function", TOK_FUNCTION},
-    {"procedure", TOK_PROCEDURE},
-    {"endfunction", TOK_ENDFUNCTION},
-    {"endprocedure", TOK_ENDPROCEDURE},
-    {"var", TOK_VAR},
-    {"begin", TOK_BEGIN},
-    {"end", TOK_END},
-    {"if", TOK_IF},
-    {"then", TOK_THEN},
-    {"else", TOK_ELSE},
-    {"elseif", TOK_ELSEIF},
-    {"endif", TOK_ENDIF},
-    {"while", TOK_WHILE},
-    {"do", TOK_DO},
-    {"endwhile", TOK_ENDWHILE},
-    {"for", TOK_FOR},
-    {"to", TOK_TO},
-    {"step", TOK_STEP},
-    {"endfor", TOK_ENDFOR},
-    {"return", TOK_RETURN},
-    {"repeat", TOK_REPEAT},
-    {"until", TOK_UNTIL},
-    {"in", TOK_IN},
-    {"out", TOK_OUT},
-    {"inout", TOK_INOUT},
-    {"in/out", TOK_INOUT},
-    {"print", TOK_PRINT},
-    {"read", TOK_READ},
-    {"integer", TOK_INTEGER},
-    {"real", TOK_REAL},
-    {"logical", TOK_LOGICAL},
-    {"character", TOK_CHARACTER},
-    {"array", TOK_ARRAY},
-    {"of", TOK_OF},
-    {"type", TOK_TYPE},
-    {"record", TOK_RECORD},
-    {"and", TOK_AND},
-    {"or", TOK_OR},
-    {"not", TOK_NOT},
-    {"eq", TOK_EQ},
-    {"equal", TOK_EQ},
-    {"equals", TOK_EQ},
-    {"ne", TOK_NE},
-    {"notequal", TOK_NE},
-    {"notequals", TOK_NE},
-    {"true", TOK_TRUE},
-    {"false", TOK_FALSE},
-    {"mod", TOK_MOD},
-    {NULL, TOK_EOF}
-};
-
-const Keyword keywords_dotted[] = {
-    {"function", TOK_FUNCTION},
-    {"procedure", TOK_PROCEDURE},
-    {"endfunction", TOK_ENDFUNCTION},
-    {"endprocedure", TOK_ENDPROCEDURE},
-    {"var", TOK_VAR},
-    {"begin", TOK_BEGIN},
-    {"end", TOK_END},
-    {"if", TOK_IF},
-    {"then", TOK_THEN},
-    {"else", TOK_ELSE},
-    {"elseif", TOK_ELSEIF},
-    {"endif", TOK_ENDIF},
-    {"while", TOK_WHILE},
-    {"do", TOK_DO},
-    {"endwhile", TOK_ENDWHILE},
-    {"for", TOK_FOR},
-    {"to", TOK_TO},
-    {"step", TOK_STEP},
-    {"endfor", TOK_ENDFOR},
-    {"return", TOK_RETURN},
-    {"repeat", TOK_REPEAT},
-    {"until", TOK_UNTIL},
-    {"in", TOK_IN},
-    {"out", TOK_OUT},
-    {"inout", TOK_INOUT},
-    {"in/out", TOK_INOUT},
-    {"print", TOK_PRINT},
-    {"read", TOK_READ},
-    {"integer", TOK_INTEGER},
-    {"real", TOK_REAL},
-    {"logical", TOK_LOGICAL},
-    {"character", TOK_CHARACTER},
-    {"array", TOK_ARRAY},
-    {"of", TOK_OF},
-    {"type", TOK_TYPE},
-    {"record", TOK_RECORD},
-    {".and.", TOK_AND},
-    {".or.", TOK_OR},
-    {".not.", TOK_NOT},
-    {".eq.", TOK_EQ},
-    {".equal.", TOK_EQ},
-    {".equals.", TOK_EQ},
-    {".ne.", TOK_NE},
-    {".notequal.", TOK_NE},
-    {".notequals.", TOK_NE},
-    {".true.", TOK_TRUE},
-    {".false.", TOK_FALSE},
-    {".mod.", TOK_MOD},
-    {NULL, TOK_EOF}
-};
+// Initial window for streamed input. It only grows to hold a line that
+// doesn't fit.
+#ifndef LEX_STREAM_BUFFER
+#define LEX_STREAM_BUFFER (64 * 1024)
+#endif
 
-const Keyword* keywords = keywords_mixed;
+// Parallel lexing doesn't split inputs into chunks smaller than this
+#ifndef LEX_PARALLEL_MIN_CHUNK
+#define LEX_PARALLEL_MIN_CHUNK (256 * 1024)
+#endif
 
 // Helper function declarations
 static bool is_at_end(Lexer* lexer);
 static char advance(Lexer* lexer);
 static char peek(Lexer* lexer);
 static char peek_next(Lexer* lexer);
-static bool match(Lexer* lexer, char expected);
 static Token* make_token(Lexer* lexer, TokenType type);
 static Token* error_token(Lexer* lexer, const char* message);
 static bool is_alpha(char c);
-static bool is_digit(char c);
 static void skip_whitespace(Lexer* lexer);
 static TokenType check_keyword(Lexer* lexer, int start, int length, const char* rest, TokenType type);
-static TokenType identifier_type(Lexer* lexer);
 static Token* scan_token(Lexer* lexer);
+static Token* scan_with_tables(Lexer* lexer, const LexerTables* tables);
+
+// A lexical error queued by a chunk lexer until its token is handed out
+typedef struct LexerDiagnostic {
+    size_t token;           // Index of the scan result that raised it
+    SourceLocation loc;
+    const char* message;    // In the arena of the lexer that raised it
+} LexerDiagnostic;
+
+// One slice of the source lexed on its own thread. Scanning stops at the
+// first scan that would start at or past end, so results never overlap
+// the next chunk's.
+typedef struct LexerChunk {
+    Lexer lexer;            // Private scanner state over the shared source
+    size_t begin;           // Always the start of a line
+    size_t end;
+    size_t resume;          // Where the scan after the last result starts
+    int line;               // Line number of begin
+    size_t newlines;        // '\n' bytes in [begin, end)
+    Token** results;        // One per scan_token() call
+    size_t* starts;         // Offset each scan started at, after whitespace
+    size_t count;
+    size_t capacity;
+    LexerDiagnostic* diagnostics;
+    size_t diagnostic_count;
+    size_t diagnostic_capacity;
+    bool failed;            // Ran out of memory
+} LexerChunk;
+
+// Input read from a descriptor through a window that holds the current
+// line and whatever has been read past it. Whole lines are visible to
+// the scanners: lexer->source_length stops after the last newline read,
+// so no token is ever cut by a refill.
+typedef struct LexerStream {
+    int fd;
+    bool owns_fd;
+    bool eof;
+    size_t fill;                // Bytes read into the window
+    size_t capacity;
+    char dropped_significant;   // Last non-space byte dropped from the window, past offset 0
+} LexerStream;
+
+static bool push_diagnostic(LexerDiagnostic** diagnostics, size_t* count, size_t* capacity,
+                            LexerDiagnostic diagnostic) {
+    if (*count == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 16;
+        LexerDiagnostic* resized = (LexerDiagnostic*)realloc(*diagnostics, grown * sizeof(LexerDiagnostic));
+        if (!resized) return false;
+        *diagnostics = resized;
+        *capacity = grown;
+    }
+    (*diagnostics)[(*count)++] = diagnostic;
+    return true;
+}
 
-// Initialize lexer with source file
-Lexer* lexer_create(const char* filename) {
-    if (current_flags & DEBUG_LEXER) {
-        fprintf(debug_file, "=== Creating Lexer ===\n");
-        fprintf(debug_file, "Input file: %s\n", filename);
+// Lexical errors go straight to error_report(), except on chunk lexers,
+// which queue them against the scan in progress
+static void lexer_error(Lexer* lexer, SourceLocation loc, const char* format, ...) {
+    char message[MAX_LEXER_MESSAGE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    LexerChunk* chunk = lexer->chunk;
+    if (!chunk) {
+        error_report(ERROR_LEXICAL, SEVERITY_ERROR, loc, "%s", message);
+        return;
     }
-    
-    verbose_print("Opening file: %s\n", filename);
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        error_report(ERROR_INTERNAL, SEVERITY_FATAL, 
-                    (SourceLocation){0, 0, filename},
-                    "Could not open file '%s'", filename);
-        return NULL;
+    LexerDiagnostic diagnostic = {chunk->count, loc, arena_strndup(&lexer->arena, message, strlen(message))};
+    if (!diagnostic.message || !push_diagnostic(&chunk->diagnostics, &chunk->diagnostic_count,
+                                                &chunk->diagnostic_capacity, diagnostic)) {
+        chunk->failed = true;
+    }
+}
+
+static void release_source(char* source, size_t length, bool mapped) {
+#ifdef PLIKE_HAVE_MMAP
+    if (mapped) {
+        munmap(source, length);
+        return;
     }
+#endif
+    (void)length;
+    (void)mapped;
+    free(source);
+}
 
-    verbose_print("Getting file size...\n");
-    // Get file size
-    fseek(file, 0L, SEEK_END);
-    size_t size = ftell(file);
-    rewind(file);
+// Map a regular file straight into memory. The mapping has no trailing
+// NUL, so every scan must stay within source_length.
+static bool load_source_mapped(int fd, const char* filename, char** source, size_t* length) {
+#ifdef PLIKE_HAVE_MMAP
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return false;
+    }
 
-    verbose_print("Allocating buffer of size %zu\n", size);
-    // Allocate buffer and read file
-    char* source = (char*)malloc(size + 1);
-    if (!source) {
-        fclose(file);
-        error_report(ERROR_INTERNAL, SEVERITY_FATAL,
-                    (SourceLocation){0, 0, filename},
-                    "Out of memory");
-        return NULL;
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    verbose_print("Mapping %lld bytes of %s\n", (long long)st.st_size, filename);
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, flags, fd, 0);
+    if (data == MAP_FAILED) {
+        return false;
     }
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
 
-    verbose_print("Reading file content...\n");
-    size_t bytes_read = fread(source, 1, size, file);
-    fclose(file);
+    *source = (char*)data;
+    *length = (size_t)st.st_size;
+    return true;
+#else
+    (void)fd;
+    (void)filename;
+    (void)source;
+    (void)length;
+    return false;
+#endif
+}
 
-    if (bytes_read < size) {
-        free(source);
-        error_report(ERROR_INTERNAL, SEVERITY_FATAL,
-                    (SourceLocation){0, 0, filename},
-                    "Could not read file '%s'", filename);
-        return NULL;
+#ifndef PLIKE_HAVE_MMAP
+// Read the whole stream into a heap buffer. Used where files can't be
+// mapped, so it doesn't rely on seeking.
+static bool load_source_stream(FILE* file, char** source, size_t* length) {
+    size_t capacity = 64 * 1024;
+    size_t size = 0;
+    char* buffer = (char*)malloc(capacity + 1);
+    if (!buffer) return false;
+
+    for (;;) {
+        size_t bytes_read = fread(buffer + size, 1, capacity - size, file);
+        size += bytes_read;
+        if (size < capacity) {
+            if (ferror(file)) {
+                free(buffer);
+                return false;
+            }
+            break;
+        }
+        capacity *= 2;
+        char* grown = (char*)realloc(buffer, capacity + 1);
+        if (!grown) {
+            free(buffer);
+            return false;
+        }
+        buffer = grown;
     }
 
-    source[bytes_read] = '\0';
+    buffer[size] = '\0';
+    *source = buffer;
+    *length = size;
+    return true;
+}
+#endif
+
+// UTF-8
+// Input is validated once, as it becomes visible: ASCII runs by the scan
+// kernel, anything else by decoding it. Multi-byte characters are noted
+// in lexer->utf8 so diagnostics can turn byte columns into character
+// columns; scanning itself only ever looks at bytes.
+
+// Length of the well-formed UTF-8 character at pos, or 0. Overlong forms,
+// surrogates and values past U+10FFFF are malformed.
+static size_t utf8_character_length(const char* source, size_t pos, size_t length) {
+    const unsigned char* s = (const unsigned char*)source + pos;
+    size_t n;
+    if (s[0] >= 0xC2 && s[0] <= 0xDF) n = 2;
+    else if (s[0] >= 0xE0 && s[0] <= 0xEF) n = 3;
+    else if (s[0] >= 0xF0 && s[0] <= 0xF4) n = 4;
+    else return 0;
+    if (n > length - pos) return 0;
+    for (size_t i = 1; i < n; i++) {
+        if ((s[i] & 0xC0) != 0x80) return 0;
+    }
+    if ((s[0] == 0xE0 && s[1] < 0xA0) || (s[0] == 0xED && s[1] > 0x9F) ||
+        (s[0] == 0xF0 && s[1] < 0x90) || (s[0] == 0xF4 && s[1] > 0x8F)) {
+        return 0;
+    }
+    return n;
+}
+
+static void utf8_record(Utf8Map* map, size_t end, size_t extra) {
+    if (map->count == map->capacity) {
+        size_t capacity = map->capacity ? map->capacity * 2 : 256;
+        size_t* ends = (size_t*)realloc(map->ends, capacity * sizeof(size_t));
+        if (!ends) return;
+        map->ends = ends;
+        size_t* extras = (size_t*)realloc(map->extra, capacity * sizeof(size_t));
+        if (!extras) return;
+        map->extra = extras;
+        map->capacity = capacity;
+    }
+    size_t before = map->count ? map->extra[map->count - 1] : map->dropped_extra;
+    map->ends[map->count] = end;
+    map->extra[map->count] = before + extra;
+    map->count++;
+}
+
+// Continuation bytes before input offset
+static size_t utf8_extra_before(const Utf8Map* map, size_t offset) {
+    size_t low = 0, high = map->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (map->ends[mid] <= offset) low = mid + 1;
+        else high = mid;
+    }
+    return low ? map->extra[low - 1] : map->dropped_extra;
+}
+
+// Move the validator's line forward to the one holding pos
+static void utf8_advance_line(Lexer* lexer, size_t pos) {
+    Utf8Map* map = &lexer->utf8;
+    size_t at = map->line_start - lexer->source_base;
+    for (;;) {
+        size_t end = lexer->scan->line_end(lexer->source, at, pos);
+        if (end >= pos) break;
+        at = end + 1;
+        map->line++;
+    }
+    map->line_start = lexer->source_base + at;
+}
+
+// Validate what became visible since the last call. A line with malformed
+// UTF-8 is reported once, at its first bad byte.
+static void validate_utf8(Lexer* lexer) {
+    Utf8Map* map = &lexer->utf8;
+    const char* source = lexer->source;
+    size_t length = lexer->source_length;
+    size_t base = lexer->source_base;
+    size_t pos = map->validated - base;
+
+    for (;;) {
+        pos = lexer->scan->ascii_run(source, pos, length);
+        if (pos >= length) break;
+        size_t n = utf8_character_length(source, pos, length);
+        if (n) {
+            utf8_record(map, base + pos + n, n - 1);
+            pos += n;
+            continue;
+        }
+        utf8_advance_line(lexer, pos);
+        int column = (int)(base + pos - map->line_start) + (map->line == 1 ? 1 : 2);
+        error_report(ERROR_LEXICAL, SEVERITY_ERROR, (SourceLocation){map->line, column, lexer->filename},
+                    "Invalid UTF-8 byte 0x%02X", (unsigned char)source[pos]);
+        pos = lexer->scan->line_end(source, pos, length);
+    }
+    map->validated = base + length;
+    // The stream window may drop the validator's line before the next call
+    if (lexer->stream) utf8_advance_line(lexer, length);
+}
+
+// Append the offset of the line that starts at offset, relative to the
+// source window. Offsets past 4GB aren't indexed; lexer_line_slice() then
+// reports the line as unknown.
+static void record_line_start(Lexer* lexer, size_t offset) {
+    if (offset > UINT32_MAX) return;
+    if (lexer->line_count == lexer->line_capacity) {
+        size_t capacity = lexer->line_capacity ? lexer->line_capacity * 2 : 1024;
+        uint32_t* offsets = (uint32_t*)realloc(lexer->line_offsets, capacity * sizeof(uint32_t));
+        if (!offsets) return;
+        lexer->line_offsets = offsets;
+        lexer->line_capacity = capacity;
+    }
+    lexer->line_offsets[lexer->line_count++] = (uint32_t)offset;
+}
+
+#ifdef PLIKE_HAVE_FD_STREAMS
+// Drop the part of the stream window before the current line, shifting
+// positions and the line index to match
+static void stream_compact(Lexer* lexer) {
+    LexerStream* stream = lexer->stream;
+    size_t keep = (size_t)(lexer->line_start - lexer->source);
+    if (keep == 0) return;
+
+    // is_prefix_operator() may need to look back past the window
+    for (size_t i = keep; i-- > 0 && lexer->source_base + i > 0;) {
+        if (!isspace((unsigned char)lexer->source[i])) {
+            stream->dropped_significant = lexer->source[i];
+            break;
+        }
+    }
+
+    memmove(lexer->source, lexer->source + keep, stream->fill - keep);
+    stream->fill -= keep;
+    lexer->source_base += keep;
+    lexer->source_length -= keep;
+    lexer->current -= keep;
+    lexer->start = lexer->start > keep ? lexer->start - keep : 0;
+    lexer->line_start = lexer->source;
+
+    size_t dropped = 0;
+    while (dropped < lexer->line_count && lexer->line_offsets[dropped] < keep) dropped++;
+    lexer->line_count -= dropped;
+    lexer->lines_dropped += dropped;
+    for (size_t i = 0; i < lexer->line_count; i++) {
+        lexer->line_offsets[i] = lexer->line_offsets[i + dropped] - (uint32_t)keep;
+    }
+
+    Utf8Map* map = &lexer->utf8;
+    size_t stale = 0;
+    while (stale < map->count && map->ends[stale] <= lexer->source_base) stale++;
+    if (stale) {
+        map->dropped_extra = map->extra[stale - 1];
+        map->count -= stale;
+        memmove(map->ends, map->ends + stale, map->count * sizeof(size_t));
+        memmove(map->extra, map->extra + stale, map->count * sizeof(size_t));
+    }
+}
+#endif
+
+// Read more of a streamed input, until at least one more whole line is
+// visible or the input ends. Returns false when nothing more became
+// visible, which is also the answer for sources held in memory.
+static bool stream_refill(Lexer* lexer) {
+    LexerStream* stream = lexer->stream;
+    if (!stream || stream->eof) return false;
+#ifdef PLIKE_HAVE_FD_STREAMS
+    stream_compact(lexer);
+    size_t visible = lexer->source_length;
+
+    while (lexer->source_length == visible && !stream->eof) {
+        if (stream->fill == stream->capacity) {
+            // The current line doesn't fit; grow the window to hold it
+            size_t line_start = (size_t)(lexer->line_start - lexer->source);
+            char* grown = (char*)realloc(lexer->source, stream->capacity * 2);
+            if (!grown) {
+                error_report(ERROR_INTERNAL, SEVERITY_FATAL,
+                            (SourceLocation){lexer->line, 0, lexer->filename},
+                            "Out of memory");
+                return false;
+            }
+            lexer->source = grown;
+            lexer->line_start = grown + line_start;
+            stream->capacity *= 2;
+        }
+
+        ssize_t bytes_read = read(stream->fd, lexer->source + stream->fill, stream->capacity - stream->fill);
+        if (bytes_read < 0 && errno == EINTR) continue;
+        if (bytes_read < 0) {
+            error_report(ERROR_INTERNAL, SEVERITY_FATAL,
+                        (SourceLocation){lexer->line, 0, lexer->filename},
+                        "Could not read '%s'", lexer->filename);
+            return false;
+        }
+        if (bytes_read == 0) {
+            stream->eof = true;
+            lexer->source_length = stream->fill;
+            break;
+        }
+
+        size_t end = stream->fill + (size_t)bytes_read;
+        for (size_t pos = end; pos > stream->fill; pos--) {
+            if (lexer->source[pos - 1] == '\n') {
+                lexer->source_length = pos;
+                break;
+            }
+        }
+        stream->fill = end;
+    }
+    validate_utf8(lexer);
+    return lexer->source_length > visible;
+#else
+    return false;
+#endif
+}
+
+// Tables generated for the active keyword table
+static const LexerTables* active_tables(void) {
+    if (keywords == keywords_standard) return &lexer_tables[OP_STYLE_STANDARD];
+    if (keywords == keywords_dotted) return &lexer_tables[OP_STYLE_DOTTED];
+    return &lexer_tables[OP_STYLE_MIXED];
+}
 
+static Lexer* lexer_new(const char* filename, char* source, size_t source_length, bool mapped) {
     verbose_print("Creating lexer structure...\n");
     Lexer* lexer = (Lexer*)malloc(sizeof(Lexer));
     if (!lexer) {
-        free(source);
         error_report(ERROR_INTERNAL, SEVERITY_FATAL,
                     (SourceLocation){0, 0, filename},
                     "Out of memory");
@@ -257,61 +439,247 @@ Lexer* lexer_create(const char* filename) {
     verbose_print("Initializing lexer fields...\n");
     lexer->filename = filename;
     lexer->source = source;
-    lexer->source_length = bytes_read;
+    lexer->source_length = source_length;
+    lexer->source_mapped = mapped;
+    lexer->source_base = 0;
+    lexer->stream = NULL;
     lexer->current = 0;
     lexer->start = 0;
     lexer->line = 1;
     lexer->column = 1;
     lexer->line_start = source;
+    lexer->line_offsets = NULL;
+    lexer->line_count = 0;
+    lexer->line_capacity = 0;
+    lexer->lines_dropped = 0;
+    record_line_start(lexer, 0);
+    lexer->token_count = 0;
+    lexer->brackets = NULL;
+    lexer->bracket_count = 0;
+    lexer->bracket_capacity = 0;
+    lexer->brackets_dropped = 0;
+    lexer->bracket_mark = 0;
+    lexer->open_brackets = NULL;
+    lexer->open_count = 0;
+    lexer->open_capacity = 0;
+    lexer->last_closed = 0;
+    lexer->lexed = NULL;
+    lexer->lexed_count = 0;
+    lexer->lexed_next = 0;
+    lexer->diagnostics = NULL;
+    lexer->diagnostic_count = 0;
+    lexer->diagnostic_capacity = 0;
+    lexer->diagnostic_next = 0;
+    lexer->chunk = NULL;
+    lexer->utf8 = (Utf8Map){0};
+    lexer->utf8.line = 1;
+    lexer->scan = lexer_scan_ops();
+    lexer->tables = active_tables();
+    arena_init(&lexer->arena, ARENA_DEFAULT_BLOCK_SIZE);
+    arena_init(&lexer->retired, ARENA_DEFAULT_BLOCK_SIZE);
+    return lexer;
+}
 
+static void lexer_created(Lexer* lexer) {
     verbose_print("Lexer creation completed\n");
-    if (current_flags & DEBUG_LEXER) {
+    if (DEBUG_ENABLED(DEBUG_LEXER)) {
         fprintf(debug_file, "Lexer created successfully\n");
-        fprintf(debug_file, "Source length: %zu bytes\n", lexer->source_length);
+        if (lexer->stream) {
+            fprintf(debug_file, "Streaming input through a %zu byte window\n", lexer->stream->capacity);
+        } else {
+            fprintf(debug_file, "Source length: %zu bytes\n", lexer->source_length);
+        }
+        fprintf(debug_file, "Scan kernels: %s\n", lexer->scan->name);
+        fprintf(debug_file, "Token tables: %s\n", lexer->tables->name);
         fprintf(debug_file, "\n");
     }
+}
+
+#ifdef PLIKE_HAVE_FD_STREAMS
+static Lexer* create_stream_lexer(int fd, const char* name, bool owns_fd) {
+    LexerStream* stream = (LexerStream*)malloc(sizeof(LexerStream));
+    char* buffer = (char*)malloc(LEX_STREAM_BUFFER);
+    Lexer* lexer = stream && buffer ? lexer_new(name, buffer, 0, false) : NULL;
+    if (!lexer) {
+        free(stream);
+        free(buffer);
+        if (owns_fd) close(fd);
+        error_report(ERROR_INTERNAL, SEVERITY_FATAL,
+                    (SourceLocation){0, 0, name},
+                    "Out of memory");
+        return NULL;
+    }
+
+    *stream = (LexerStream){
+        .fd = fd,
+        .owns_fd = owns_fd,
+        .eof = false,
+        .fill = 0,
+        .capacity = LEX_STREAM_BUFFER,
+        .dropped_significant = '\0',
+    };
+    lexer->stream = stream;
+    lexer_created(lexer);
+    return lexer;
+}
+#endif
+
+// Lex whatever is read from fd, which may be a pipe or terminal, in
+// memory bounded by the longest line rather than the whole input. The
+// caller keeps ownership of fd.
+Lexer* lexer_create_fd(int fd, const char* name) {
+    if (DEBUG_ENABLED(DEBUG_LEXER)) {
+        fprintf(debug_file, "=== Creating Lexer ===\n");
+        fprintf(debug_file, "Input stream: %s\n", name);
+    }
+#ifdef PLIKE_HAVE_FD_STREAMS
+    return create_stream_lexer(fd, name, false);
+#else
+    (void)fd;
+    error_report(ERROR_INTERNAL, SEVERITY_FATAL,
+                (SourceLocation){0, 0, name},
+                "Streaming input is not supported on this platform");
+    return NULL;
+#endif
+}
+
+// Like lexer_create(), but reads a regular file through the stream window
+// too, so only the lines around the current token are kept in memory
+Lexer* lexer_create_streamed(const char* filename) {
+#ifdef PLIKE_HAVE_FD_STREAMS
+    if (strcmp(filename, "-") == 0) {
+        return lexer_create_fd(STDIN_FILENO, "<stdin>");
+    }
+    if (DEBUG_ENABLED(DEBUG_LEXER)) {
+        fprintf(debug_file, "=== Creating Lexer ===\n");
+        fprintf(debug_file, "Input stream: %s\n", filename);
+    }
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        error_report(ERROR_INTERNAL, SEVERITY_FATAL,
+                    (SourceLocation){0, 0, filename},
+                    "Could not open file '%s'", filename);
+        return NULL;
+    }
+    return create_stream_lexer(fd, filename, true);
+#else
+    return lexer_create(filename);
+#endif
+}
+
+// Initialize lexer with source file. "-" reads standard input.
+Lexer* lexer_create(const char* filename) {
+#ifdef PLIKE_HAVE_FD_STREAMS
+    if (strcmp(filename, "-") == 0) {
+        return lexer_create_fd(STDIN_FILENO, "<stdin>");
+    }
+#endif
+
+    if (DEBUG_ENABLED(DEBUG_LEXER)) {
+        fprintf(debug_file, "=== Creating Lexer ===\n");
+        fprintf(debug_file, "Input file: %s\n", filename);
+    }
+    
+    verbose_print("Opening file: %s\n", filename);
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        error_report(ERROR_INTERNAL, SEVERITY_FATAL, 
+                    (SourceLocation){0, 0, filename},
+                    "Could not open file '%s'", filename);
+        return NULL;
+    }
+
+    char* source = NULL;
+    size_t source_length = 0;
+    bool mapped = false;
+#ifdef PLIKE_HAVE_MMAP
+    mapped = load_source_mapped(fileno(file), filename, &source, &source_length);
+    if (!mapped) {
+        // Pipes, FIFOs and empty files are streamed rather than read whole
+        int fd = dup(fileno(file));
+        fclose(file);
+        if (fd < 0) {
+            error_report(ERROR_INTERNAL, SEVERITY_FATAL,
+                        (SourceLocation){0, 0, filename},
+                        "Could not read file '%s'", filename);
+            return NULL;
+        }
+        return create_stream_lexer(fd, filename, true);
+    }
+#else
+    verbose_print("Reading file content...\n");
+    if (!load_source_stream(file, &source, &source_length)) {
+        fclose(file);
+        error_report(ERROR_INTERNAL, SEVERITY_FATAL,
+                    (SourceLocation){0, 0, filename},
+                    "Could not read file '%s'", filename);
+        return NULL;
+    }
+#endif
+    fclose(file);
+
+    Lexer* lexer = lexer_new(filename, source, source_length, mapped);
+    if (!lexer) {
+        release_source(source, source_length, mapped);
+        return NULL;
+    }
+    lexer_created(lexer);
     return lexer;
 }
 
 void lexer_destroy(Lexer* lexer) {
-    if (current_flags & DEBUG_LEXER) {
+    if (DEBUG_ENABLED(DEBUG_LEXER)) {
         fprintf(debug_file, "=== Destroying Lexer ===\n");
         fprintf(debug_file, "Total lines processed: %d\n", lexer->line);
+        fprintf(debug_file, "Tokens scanned: %zu (%zu arena bytes in %zu blocks)\n",
+                lexer->token_count, lexer->arena.bytes_used, lexer->arena.block_count);
     }
     
     if (lexer) {
-        free(lexer->source);
+        arena_release(&lexer->arena);
+        arena_release(&lexer->retired);
+        error_clear_source(lexer);
+        free(lexer->line_offsets);
+        free(lexer->brackets);
+        free(lexer->open_brackets);
+        free(lexer->lexed);
+        free(lexer->diagnostics);
+        free(lexer->utf8.ends);
+        free(lexer->utf8.extra);
+        if (lexer->stream) {
+#ifdef PLIKE_HAVE_FD_STREAMS
+            if (lexer->stream->owns_fd) close(lexer->stream->fd);
+#endif
+            free(lexer->stream);
+            free(lexer->source);
+        } else {
+            release_source(lexer->source, lexer->source_length, lexer->source_mapped);
+        }
         free(lexer);
     }
 
-    if (current_flags & DEBUG_LEXER) {
+    if (DEBUG_ENABLED(DEBUG_LEXER)) {
         fprintf(debug_file, "Lexer destroyed successfully\n\n");
     }
 }
 
-void token_destroy(Token* token) {
-    if (token) {
-        free(token->value);
-        free(token);
-    }
-}
-
 // Lexer helper functions
 static bool is_at_end(Lexer* lexer) {
     return lexer->current >= lexer->source_length;
 }
 
-static void lexer_rewind(Lexer* lexer, int current, int column) {
-    lexer->current = current;
-    lexer->column = column;
-}
-
 static char advance(Lexer* lexer) {
     lexer->current++;
     lexer->column++;
     return lexer->source[lexer->current - 1];
 }
 
+// Skip to position on the current line
+static void advance_to(Lexer* lexer, size_t position) {
+    lexer->column += (int)(position - lexer->current);
+    lexer->current = position;
+}
+
 static char peek(Lexer* lexer) {
     if (is_at_end(lexer)) return '\0';
     return lexer->source[lexer->current];
@@ -322,14 +690,6 @@ static char peek_next(Lexer* lexer) {
     return lexer->source[lexer->current + 1];
 }
 
-static bool match(Lexer* lexer, char expected) {
-    if (is_at_end(lexer)) return false;
-    if (lexer->source[lexer->current] != expected) return false;
-    lexer->current++;
-    lexer->column++;
-    return true;
-}
-
 SourceLocation token_clone_location(Token* source_token) {
     SourceLocation clone;
     clone.column = source_token->loc.column;
@@ -338,105 +698,163 @@ SourceLocation token_clone_location(Token* source_token) {
     return clone;
 }
 
-static Token* make_token(Lexer* lexer, TokenType type) {
-    Token* token = (Token*)malloc(sizeof(Token));
+// Spellings for tokens whose text never varies, so make_token() can skip
+// copying the source slice
+static const char* const fixed_spellings[TOK_COUNT] = {
+    [TOK_LT] = "<",
+    [TOK_GT] = ">",
+    [TOK_LE] = "<=",
+    [TOK_GE] = ">=",
+    [TOK_EQ] = "==",
+    [TOK_NE] = "!=",
+    [TOK_PLUS] = "+",
+    [TOK_MINUS] = "-",
+    [TOK_MULTIPLY] = "*",
+    [TOK_DIVIDE] = "/",
+    [TOK_DEREF] = "*",
+    [TOK_ADDR_OF] = "&",
+    [TOK_AT] = "@",
+    [TOK_ARROW] = "->",
+    [TOK_RSHIFT] = ">>",
+    [TOK_LSHIFT] = "<<",
+    [TOK_BITAND] = "&",
+    [TOK_BITOR] = "|",
+    [TOK_BITXOR] = "^",
+    [TOK_BITNOT] = "~",
+    [TOK_LPAREN] = "(",
+    [TOK_RPAREN] = ")",
+    [TOK_LBRACKET] = "[",
+    [TOK_RBRACKET] = "]",
+    [TOK_COMMA] = ",",
+    [TOK_COLON] = ":",
+    [TOK_SEMICOLON] = ";",
+    [TOK_DOT] = ".",
+    [TOK_DOTDOT] = "..",
+    [TOK_DOTDOTDOT] = "...",
+};
+
+static Token* alloc_token(Lexer* lexer, TokenType type) {
+    Token* token = (Token*)arena_alloc(&lexer->arena, sizeof(Token));
     if (!token) return NULL;
 
     size_t length = lexer->current - lexer->start;
-    token->value = (char*)malloc(length + 1);
-    if (!token->value) {
-        free(token);
-        return NULL;
-    }
-
-    memcpy(token->value, &lexer->source[lexer->start], length);
-    token->value[length] = '\0';
     token->type = type;
+    token->bracket = 0;
+    token->value = NULL;
+    token->number = (NumberLiteral){0};
+    token->offset = lexer->source_base + lexer->start;
+    token->length = length;
     token->loc.line = lexer->line;
     token->loc.column = lexer->column - length;
     token->loc.filename = lexer->filename;
+    lexer->token_count++;
+    return token;
+}
 
-    // Map operator symbols to their token types
-    if (type == TOK_LT) token->value = strdup("<");
-    else if (type == TOK_GT) token->value = strdup(">");
-    else if (type == TOK_LE) token->value = strdup("<=");
-    else if (type == TOK_GE) token->value = strdup(">=");
-    else if (type == TOK_EQ) token->value = strdup("==");
-    else if (type == TOK_NE) token->value = strdup("!=");
+// Token whose value is the exact source text
+static Token* make_text_token(Lexer* lexer, TokenType type) {
+    Token* token = alloc_token(lexer, type);
+    if (!token) return NULL;
 
+    token->value = arena_strndup(&lexer->arena, &lexer->source[lexer->start], token->length);
+    if (!token->value) return NULL;
     return token;
 }
 
+static Token* make_token(Lexer* lexer, TokenType type) {
+    if (type == TOK_EOF) {
+        Token* token = alloc_token(lexer, type);
+        if (token) token->value = "";
+        return token;
+    }
+
+    // Operators and punctuation share one static spelling
+    if (fixed_spellings[type]) {
+        Token* token = alloc_token(lexer, type);
+        if (token) token->value = fixed_spellings[type];
+        return token;
+    }
+
+    return make_text_token(lexer, type);
+}
+
 static Token* error_token(Lexer* lexer, const char* message) {
-    Token* token = (Token*)malloc(sizeof(Token));
+    Token* token = alloc_token(lexer, TOK_EOF);  // Use EOF for error tokens
     if (!token) return NULL;
 
-    token->value = strdup(message);
-    token->type = TOK_EOF;  // Use EOF for error tokens
-    token->loc.line = lexer->line;
+    token->value = message;
     token->loc.column = lexer->column;
-    token->loc.filename = lexer->filename;
-
     return token;
 }
 
+// No token starts with the character at lexer->start, which has been
+// consumed. A multi-byte UTF-8 character is one error, not one per byte.
+static Token* unexpected_character(Lexer* lexer) {
+    unsigned char lead = (unsigned char)lexer->source[lexer->start];
+    size_t length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    while (lexer->current - lexer->start < length && !is_at_end(lexer) &&
+           ((unsigned char)peek(lexer) & 0xC0) == 0x80) {
+        advance(lexer);
+    }
+    return error_token(lexer, "Unexpected character");
+}
+
 static bool is_alpha(char c) {
     return (c >= 'a' && c <= 'z') ||
            (c >= 'A' && c <= 'Z') ||
            c == '_';
 }
 
-static bool is_digit(char c) {
-    return c >= '0' && c <= '9';
-}
-
-static bool is_dimension_specifier(const char* text) {
-    // Check if the text matches the pattern of a number followed by 'd' or 'D'
-    char* endptr;
-    long num = strtol(text, &endptr, 10);
-    
-    // Valid if we found a number > 0 and it's followed by 'd' or 'D' with nothing after
-    return num > 0 && (*endptr == 'd' || *endptr == 'D') && *(endptr + 1) == '\0';
-}
-
 static void skip_whitespace(Lexer* lexer) {
     for (;;) {
+        if (lexer->current >= lexer->source_length && !stream_refill(lexer)) return;
         char c = peek(lexer);
         switch (c) {
             case ' ':
             case '\r':
             case '\t':
-                advance(lexer);
+                advance_to(lexer, lexer->scan->blank_run(lexer->source, lexer->current,
+                                                        lexer->source_length));
                 break;
             case '\n':
                 lexer->line++;
                 lexer->column = 1;
                 lexer->line_start = &lexer->source[lexer->current + 1];
+                record_line_start(lexer, lexer->current + 1);
                 advance(lexer);
                 break;
             case '/':
-                // Check if this is part of "in/out"
-                if (lexer->current >= 2 && 
-                    strncmp(&lexer->source[lexer->current - 2], "in", 2) == 0 &&
-                    lexer->current + 3 < lexer->source_length &&
-                    strncmp(&lexer->source[lexer->current + 1], "out", 3) == 0) {
-                    return;  // Don't skip - this is part of "in/out"
-                }
-                
                 // Handle comments
                 if (peek_next(lexer) == '/') {
-                    while (peek(lexer) != '\n' && !is_at_end(lexer)) advance(lexer);
+                    advance_to(lexer, lexer->scan->line_end(lexer->source, lexer->current,
+                                                           lexer->source_length));
                 } else if (peek_next(lexer) == '*') {
                     advance(lexer);
                     advance(lexer);
-                    while (!is_at_end(lexer) && 
-                           !(peek(lexer) == '*' && peek_next(lexer) == '/')) {
-                        if (peek(lexer) == '\n') {
-                            lexer->line++;
+                    for (;;) {
+                        size_t newlines = 0;
+                        size_t last_newline = 0;
+                        size_t end = lexer->scan->block_comment_end(lexer->source, lexer->current,
+                                                                    lexer->source_length,
+                                                                    &newlines, &last_newline);
+                        if (newlines > 0) {
+                            // Only the last newline is reported, so find the others
+                            for (size_t pos = lexer->current; pos < last_newline; pos++) {
+                                pos = lexer->scan->line_end(lexer->source, pos, last_newline);
+                                if (pos < last_newline) record_line_start(lexer, pos + 1);
+                            }
+                            record_line_start(lexer, last_newline + 1);
+                            // Same bookkeeping as a '\n' consumed by advance()
+                            lexer->line += (int)newlines;
+                            lexer->line_start = &lexer->source[last_newline + 1];
+                            lexer->current = last_newline;
                             lexer->column = 1;
-                            lexer->line_start = &lexer->source[lexer->current + 1];
+                            advance(lexer);
                         }
-                        advance(lexer);
+                        advance_to(lexer, end);
+                        // A streamed window ends after a newline, so "*/" is
+                        // never split; an open comment just carries on
+                        if (end < lexer->source_length || !stream_refill(lexer)) break;
                     }
                     if (!is_at_end(lexer)) {
                         advance(lexer);
@@ -452,134 +870,76 @@ static void skip_whitespace(Lexer* lexer) {
     }
 }
 
-static TokenType identifier_type(Lexer* lexer) {
-    size_t length = lexer->current - lexer->start;
-    if (length == 6 && strncmp(&lexer->source[lexer->start], "in/out", 6) == 0) {
-        return TOK_INOUT;
-    }
-    char identifier[MAX_IDENTIFIER_LENGTH + 1];
-    if (length > MAX_IDENTIFIER_LENGTH) length = MAX_IDENTIFIER_LENGTH;
-    strncpy(identifier, &lexer->source[lexer->start], length);
-    identifier[length] = '\0';
-
-    // First check for dimension specifiers
-    if (is_dimension_specifier(identifier)) {
-        verbose_print("Found dimension specifier: %s\n", identifier);
-        return TOK_IDENTIFIER;  // Treat dimension specifiers as identifiers
-    }
-    
-    // Check for keywords
-    /*for (const Keyword* k = keywords; k->text != NULL; k++) {
-        size_t len = strlen(k->text);
-        if (lexer->current - lexer->start == len &&
-            strncmp(&lexer->source[lexer->start], k->text, len) == 0) {
-            verbose_print("Matched keyword: %s -> token type: %d\n", k->text, k->type);
-            return k->type;
-        }
-    }*/
-    for (const Keyword* k = keywords; k->text != NULL; k++) {
-        if (strcasecmp(identifier, k->text) == 0) {
-            return k->type;
-        }
+// Integer value of digits in the given base, reporting literals that
+// don't fit in 64 bits
+static bool decode_integer(const char* digits, size_t length, int base, int64_t* value) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < length; i++) {
+        char c = (char)tolower((unsigned char)digits[i]);
+        int digit = c >= 'a' ? c - 'a' + 10 : c - '0';
+        if (result > (UINT64_MAX - (uint64_t)digit) / (uint64_t)base) return false;
+        result = result * (uint64_t)base + (uint64_t)digit;
     }
-
-    //char identifier[MAX_IDENTIFIER_LENGTH + 1];
-    size_t len = lexer->current - lexer->start;
-    if (len > MAX_IDENTIFIER_LENGTH) len = MAX_IDENTIFIER_LENGTH;
-    strncpy(identifier, &lexer->source[lexer->start], len);
-    identifier[len] = '\0';
-
-    /*if (strcasecmp(identifier, "eq") == 0 ||
-        strcasecmp(identifier, ".eq.") == 0 ||
-        strcasecmp(identifier, "equal") == 0 ||
-        strcasecmp(identifier, ".equal.") == 0 ||
-        strcasecmp(identifier, "equals") == 0 ||
-        strcasecmp(identifier, ".equals.") == 0) {
-        return TOK_EQ;
-    }*/
-
-    verbose_print("No keyword match, treating as identifier: %s\n", identifier);
-
-    return TOK_IDENTIFIER;
-}
-
-static bool is_hex_digit(char c) {
-    return (c >= '0' && c <= '9') ||
-           (c >= 'a' && c <= 'f') ||
-           (c >= 'A' && c <= 'F');
-}
-
-static bool is_binary_digit(char c) {
-    return c == '0' || c == '1';
-}
-
-static bool is_octal_digit(char c) {
-    return c >= '0' && c <= '7';
+    if (result > INT64_MAX) return false;
+    *value = (int64_t)result;
+    return true;
 }
 
-static Token* scan_number(Lexer* lexer) {
-    bool is_float = false;
-    const char* start = &lexer->source[lexer->start];
+static Token* make_number_token(Lexer* lexer, NumberKind kind) {
+    Token* token = make_token(lexer, TOK_NUMBER);
+    if (!token) return NULL;
 
-    // Check for hex, octal, or binary prefix
-    if (start[0] == '0' && lexer->start + 1 < lexer->source_length) {
-        char prefix = tolower(start[1]);
-        if (prefix == 'x') {  // Hexadecimal
-            lexer->current += 2;  // Skip '0x'
-            while (is_hex_digit(peek(lexer))) {
-                advance(lexer);
-            }
-            return make_token(lexer, TOK_NUMBER);
-        }
-        else if (prefix == 'o') {  // Octal
-            lexer->current += 2;  // Skip '0o'
-            while (is_octal_digit(peek(lexer))) {
-                advance(lexer);
-            }
-            return make_token(lexer, TOK_NUMBER);
-        }
-        else if (prefix == 'b') {  // Binary
-            lexer->current += 2;  // Skip '0b'
-            while (is_binary_digit(peek(lexer))) {
-                advance(lexer);
-            }
-            return make_token(lexer, TOK_NUMBER);
-        }
+    token->number.kind = kind;
+    if (kind == NUMBER_REAL) {
+        token->number.real = strtod(token->value, NULL);
+        token->number.single = tolower((unsigned char)token->value[token->length - 1]) == 'f';
+        return token;
     }
 
-    // Regular decimal number or float
-    while (is_digit(peek(lexer))) {
-        advance(lexer);
+    int base = 10;
+    size_t prefix = 0;
+    switch (kind) {
+        case NUMBER_HEX: base = 16; prefix = 2; break;
+        case NUMBER_OCTAL: base = 8; prefix = 2; break;
+        case NUMBER_BINARY: base = 2; prefix = 2; break;
+        default: break;
     }
+    if (!decode_integer(token->value + prefix, token->length - prefix, base,
+                        &token->number.integer)) {
+        lexer_error(lexer, token->loc, "Integer literal '%s' does not fit in 64 bits", token->value);
+        token->number.integer = INT64_MAX;
+    }
+    return token;
+}
 
-    int current = lexer->current;
-    int column = lexer->column;
-    // Look for fractional part
-    if (peek(lexer) == '.') {
-        is_float = true;
-        advance(lexer);  // Consume the '.'
-        
-        // Handle the case of just a trailing dot (e.g., "123.")
-        if (!is_digit(peek(lexer))) {
-            if (is_alpha(peek(lexer)) || peek(lexer) == '.') {
-                lexer_rewind(lexer, current, column);
-                return make_token(lexer, TOK_NUMBER);
-            }
-        } else {
-            // Consume fractional digits
-            while (is_digit(peek(lexer))) {
-                advance(lexer);
-            }
+// Whether the '*' or '&' just scanned is a prefix operator: an identifier
+// or '(' follows, and an operator or opening delimiter comes before it
+static bool is_prefix_operator(Lexer* lexer) {
+    size_t pos = lexer->current;
+    for (;;) {
+        while (pos < lexer->source_length && isspace((unsigned char)lexer->source[pos])) {
+            pos++;
         }
+        size_t base = lexer->source_base;
+        if (pos < lexer->source_length || !stream_refill(lexer)) break;
+        pos -= lexer->source_base - base;
     }
-
-    // Look for float suffix 'f'
-    if (peek(lexer) == 'f' || peek(lexer) == 'F') {
-        is_float = true;
-        advance(lexer);
+    char next = pos < lexer->source_length ? lexer->source[pos] : '\0';
+    if (!is_alpha(next) && next != '(') return false;
+
+    // The byte at offset 0 is never looked at
+    char prev = lexer->stream ? lexer->stream->dropped_significant : '\0';
+    for (size_t i = lexer->start; i-- > 0 && lexer->source_base + i > 0;) {
+        if (!isspace((unsigned char)lexer->source[i])) {
+            prev = lexer->source[i];
+            break;
+        }
     }
-
-    return make_token(lexer, TOK_NUMBER);
+    return prev == '=' || prev == '(' || prev == ',' ||
+           prev == '+' || prev == '-' || prev == '*' ||
+           prev == '/' || prev == '&' || prev == '|' ||
+           prev == '^' || prev == '<' || prev == '>' ||
+           prev == '!';
 }
 
 // Add string literal support in lexer.c
@@ -587,8 +947,7 @@ static Token* scan_string(Lexer* lexer) {
     lexer->start = lexer->current;
     while (peek(lexer) != '"' && !is_at_end(lexer)) {
         if (peek(lexer) == '\n') {
-            error_report(ERROR_LEXICAL, SEVERITY_ERROR,
-                        (SourceLocation){lexer->line, lexer->column, lexer->filename},
+            lexer_error(lexer, (SourceLocation){lexer->line, lexer->column, lexer->filename},
                         "Unterminated string");
             return NULL;
         }
@@ -596,8 +955,7 @@ static Token* scan_string(Lexer* lexer) {
     }
 
     if (is_at_end(lexer)) {
-        error_report(ERROR_LEXICAL, SEVERITY_ERROR,
-                    (SourceLocation){lexer->line, lexer->column, lexer->filename},
+        lexer_error(lexer, (SourceLocation){lexer->line, lexer->column, lexer->filename},
                     "Unterminated string");
         return NULL;
     }
@@ -610,8 +968,10 @@ static Token* scan_string(Lexer* lexer) {
     return token;
 }
 
-Token* lexer_next_token(Lexer* lexer) {
-    if (current_flags & DEBUG_LEXER) {
+static Token* scan_token(Lexer* lexer) {
+    // Chunk lexers run on worker threads; their tokens are traced when handed out
+    bool trace = DEBUG_ENABLED(DEBUG_LEXER) && !lexer->chunk;
+    if (trace) {
         fprintf(debug_file, "=== Starting Token Scan ===\n");
         debug_lexer_state(lexer);
     }
@@ -622,268 +982,521 @@ Token* lexer_next_token(Lexer* lexer) {
     lexer->start = lexer->current;
 
     if (is_at_end(lexer)) {
-        if (current_flags & DEBUG_LEXER) {
+        if (trace) {
             fprintf(debug_file, "Reached end of file\n");
         }
         token = make_token(lexer, TOK_EOF);
-        goto scanned;
+    } else {
+        token = scan_with_tables(lexer, lexer->tables);
     }
 
-    char c = advance(lexer);
-    //printf("next c %c\n", c);
-    if (c == '"') {
-        return scan_string(lexer);
+    if (token && trace) {
+        fprintf(debug_file, "=== Token Scanned ===\n");
+        debug_token_details(token);
+        fprintf(debug_file, "\n");
     }
+    return token;
+}
 
-    if (is_digit(c)) {
-        if (!is_at_end(lexer) && (peek(lexer) == 'd' || peek(lexer) == 'D')) {
-            advance(lexer); // Consume the 'd' or 'D'
-            token = make_token(lexer, TOK_IDENTIFIER);
-            goto scanned;
-        }
-        token = scan_number(lexer);
-        goto scanned;
-    }
+// Longest match through the generated DFA. Plain identifiers are finished
+// by the scan kernel once no keyword can match any more.
+static Token* scan_with_tables(Lexer* lexer, const LexerTables* tables) {
+    const char* source = lexer->source;
+    size_t length = lexer->source_length;
+    size_t pos = lexer->start;
+    size_t accept_end = pos;
+    uint16_t accept = 0;
+    uint16_t state = LEX_STATE_START;
 
-    /*
-    // Check for dimensional array specifier (e.g., "2D", "3d")
-    if (is_digit(c)) {
-        // Look ahead for 'd' or 'D'
-        if (!is_at_end(lexer) && (peek(lexer) == 'd' || peek(lexer) == 'D')) {
-            advance(lexer); // Consume the 'd' or 'D'
-            return make_token(lexer, TOK_IDENTIFIER);
+    for (;;) {
+        if (state == tables->identifier_tail) {
+            accept = tables->accepts[state];
+            accept_end = lexer->scan->identifier_end(source, pos, length);
+            break;
         }
-        
-        // Handle regular numbers
-        while (is_digit(peek(lexer))) advance(lexer);
-        if (peek(lexer) == '.' && is_digit(peek_next(lexer))) {
-            advance(lexer); // Consume the "."
-            while (is_digit(peek(lexer))) advance(lexer);
+        uint16_t next = LEX_STATE_DEAD;
+        if (pos < length) {
+            uint8_t class = tables->classes[(unsigned char)source[pos]];
+            next = tables->transitions[state * tables->class_count + class];
         }
-        return make_token(lexer, TOK_NUMBER);
-    }*/
-
-    // Identifiers
-    if (is_alpha(c)) {
-        size_t word_start = lexer->start;
-        while (is_alpha(peek(lexer)) || is_digit(peek(lexer))) {
-            advance(lexer);
+        if (next == LEX_STATE_VETO) break;
+        if (tables->accepts[state]) {
+            accept = tables->accepts[state];
+            accept_end = pos;
         }
+        if (next == LEX_STATE_DEAD) break;
+        state = next;
+        pos++;
+    }
 
-         // Get the full identifier
-        size_t length = lexer->current - word_start;
-        
-        // Check for "in" explicitly
-        if (length == 2 && strncmp(&lexer->source[word_start], "in", 2) == 0) {
-            // Peek ahead for "/out"
-            char next = peek(lexer);
-            if (next == '/') {
-                advance(lexer);  // consume '/'
-                if (lexer->current + 2 < lexer->source_length &&
-                    strncmp(&lexer->source[lexer->current], "out", 3) == 0) {
-                    lexer->current += 3;  // consume 'out'
-                    token = make_token(lexer, TOK_INOUT);
-                    goto scanned;
-                }
-                // If not followed by "out", back up
-                lexer->current--;
+    if (!accept) {
+        advance(lexer);
+        return unexpected_character(lexer);
+    }
+    advance_to(lexer, accept_end);
+
+    int value = LEX_ACCEPT_VALUE(accept);
+    switch (LEX_ACCEPT_ACTION(accept)) {
+        case LEX_ACTION_TOKEN:
+            return make_token(lexer, (TokenType)value);
+        case LEX_ACTION_TEXT:
+            return make_text_token(lexer, (TokenType)value);
+        case LEX_ACTION_NUMBER:
+            return make_number_token(lexer, (NumberKind)value);
+        case LEX_ACTION_EQUALS:
+            return make_token(lexer, g_config.assignment_style == ASSIGNMENT_EQUALS ? TOK_ASSIGN : TOK_EQ);
+        case LEX_ACTION_STAR:
+            return make_token(lexer, is_prefix_operator(lexer) ? TOK_DEREF : TOK_MULTIPLY);
+        case LEX_ACTION_AMP:
+            return make_token(lexer, is_prefix_operator(lexer) ? TOK_ADDR_OF : TOK_BITAND);
+        case LEX_ACTION_STRING:
+            return scan_string(lexer);
+        case LEX_ACTION_NONE:
+            break;
+    }
+    return error_token(lexer, "Unexpected character");
+}
+
+static uint32_t open_bracket(Lexer* lexer, Token* token) {
+    if (lexer->bracket_count == lexer->bracket_capacity) {
+        size_t capacity = lexer->bracket_capacity ? lexer->bracket_capacity * 2 : 64;
+        BracketInfo* brackets = (BracketInfo*)realloc(lexer->brackets, capacity * sizeof(BracketInfo));
+        if (!brackets) return 0;
+        lexer->brackets = brackets;
+        lexer->bracket_capacity = capacity;
+    }
+    if (lexer->open_count == lexer->open_capacity) {
+        size_t capacity = lexer->open_capacity ? lexer->open_capacity * 2 : 16;
+        uint32_t* open = (uint32_t*)realloc(lexer->open_brackets, capacity * sizeof(uint32_t));
+        if (!open) return 0;
+        lexer->open_brackets = open;
+        lexer->open_capacity = capacity;
+    }
+
+    lexer->brackets[lexer->bracket_count++] = (BracketInfo){token, NULL, 0, 0, false};
+    uint32_t id = (uint32_t)(lexer->brackets_dropped + lexer->bracket_count);
+    lexer->open_brackets[lexer->open_count++] = id;
+    return id;
+}
+
+static BracketInfo* bracket_at(Lexer* lexer, uint32_t id) {
+    return &lexer->brackets[id - 1 - lexer->brackets_dropped];
+}
+
+// Record bracket pairs and their comma counts as tokens go by. A closing
+// bracket that doesn't match the innermost open one is left unpaired.
+static void track_brackets(Lexer* lexer, Token* token) {
+    uint32_t closed = lexer->last_closed;
+    lexer->last_closed = 0;
+
+    switch (token->type) {
+        case TOK_LPAREN:
+        case TOK_LBRACKET:
+            token->bracket = open_bracket(lexer, token);
+            break;
+        case TOK_RPAREN:
+        case TOK_RBRACKET: {
+            if (lexer->open_count == 0) break;
+            uint32_t id = lexer->open_brackets[lexer->open_count - 1];
+            BracketInfo* info = bracket_at(lexer, id);
+            TokenType expected = info->open->type == TOK_LPAREN ? TOK_RPAREN : TOK_RBRACKET;
+            if (token->type != expected) break;
+            lexer->open_count--;
+            info->close = token;
+            token->bracket = id;
+            lexer->last_closed = id;
+            break;
+        }
+        case TOK_COMMA:
+            if (lexer->open_count > 0) {
+                bracket_at(lexer, lexer->open_brackets[lexer->open_count - 1])->commas++;
             }
+            break;
+        default:
+            break;
+    }
+
+    if (closed) {
+        BracketInfo* info = bracket_at(lexer, closed);
+        info->next_known = true;
+        if (token->bracket && token->type == info->open->type) {
+            info->next = token->bracket;
         }
-        token = make_token(lexer, identifier_type(lexer));
-        goto scanned;
     }
+}
 
-    // Special handling for assignment and equality based on config
-    if (c == ':' && peek(lexer) == '=') {
-        advance(lexer);
-        token = make_token(lexer, TOK_ASSIGN);
-        goto scanned;
+// Hand out the next token scanned ahead by lexer_lex_parallel(), reporting
+// the errors its scan raised first, as scan_token() would have
+static Token* next_lexed_token(Lexer* lexer) {
+    size_t index = lexer->lexed_next++;
+    while (lexer->diagnostic_next < lexer->diagnostic_count &&
+           lexer->diagnostics[lexer->diagnostic_next].token == index) {
+        LexerDiagnostic* diagnostic = &lexer->diagnostics[lexer->diagnostic_next++];
+        error_report(ERROR_LEXICAL, SEVERITY_ERROR, diagnostic->loc, "%s", diagnostic->message);
     }
 
-    if (c == '=') {
-        if (peek(lexer) == '=') {
-            advance(lexer);
-            token = make_token(lexer, TOK_EQ);
-            goto scanned;
-        } else {
-            if (g_config.assignment_style == ASSIGNMENT_EQUALS) {
-                token = make_token(lexer, TOK_ASSIGN);
-                goto scanned;
-            } else {
-                token = make_token(lexer, TOK_EQ);
-                goto scanned;
+    Token* token = lexer->lexed[index];
+    if (token && DEBUG_ENABLED(DEBUG_LEXER)) {
+        fprintf(debug_file, "=== Token Scanned ===\n");
+        debug_token_details(token);
+        fprintf(debug_file, "\n");
+    }
+    return token;
+}
+
+Token* lexer_next_token(Lexer* lexer) {
+    // Sources held in memory are validated before the first token, once
+    // errors can be reported against them
+    if (lexer->utf8.validated < lexer->source_base + lexer->source_length) validate_utf8(lexer);
+    Token* token = lexer->lexed_next < lexer->lexed_count
+        ? next_lexed_token(lexer)
+        : scan_token(lexer);
+    if (token) track_brackets(lexer, token);
+    return token;
+}
+
+// Parallel lexing
+// The source is cut just after newlines into one chunk per thread, and
+// each chunk is lexed as if it started outside any comment. Tokens never
+// contain a newline and strings end at one, so that guess only fails when
+// a block comment runs across the cut. The merge walks the chunks in
+// order: where a chunk's first scan doesn't start where the previous
+// chunk's scanning actually stopped, the start of the chunk is lexed again
+// from there until a scan lands on a start the chunk already has.
+
+static void chunk_init(LexerChunk* chunk, const Lexer* parent, size_t begin, size_t end) {
+    memset(chunk, 0, sizeof(*chunk));
+    Lexer* lexer = &chunk->lexer;
+    lexer->filename = parent->filename;
+    lexer->source = parent->source;
+    lexer->source_length = parent->source_length;
+    lexer->current = begin;
+    lexer->start = begin;
+    lexer->line = 1;
+    lexer->column = begin == 0 ? 1 : 2;     // The column after a newline
+    lexer->line_start = &parent->source[begin];
+    lexer->scan = parent->scan;
+    lexer->tables = parent->tables;
+    lexer->chunk = chunk;
+    arena_init(&lexer->arena, ARENA_DEFAULT_BLOCK_SIZE);
+    arena_init(&lexer->retired, ARENA_DEFAULT_BLOCK_SIZE);
+    chunk->begin = begin;
+    chunk->end = end;
+    chunk->resume = begin;
+}
+
+// Frees everything but the arena, which the parent lexer takes over
+static void chunk_release(LexerChunk* chunk, Lexer* parent) {
+    arena_merge(&parent->arena, &chunk->lexer.arena);
+    free(chunk->lexer.line_offsets);
+    free(chunk->results);
+    free(chunk->starts);
+    free(chunk->diagnostics);
+}
+
+static bool chunk_push(LexerChunk* chunk, size_t start, Token* token) {
+    if (chunk->count == chunk->capacity) {
+        size_t capacity = chunk->capacity ? chunk->capacity * 2 : 1024;
+        Token** results = (Token**)realloc(chunk->results, capacity * sizeof(Token*));
+        if (!results) return false;
+        chunk->results = results;
+        size_t* starts = (size_t*)realloc(chunk->starts, capacity * sizeof(size_t));
+        if (!starts) return false;
+        chunk->starts = starts;
+        chunk->capacity = capacity;
+    }
+    chunk->results[chunk->count] = token;
+    chunk->starts[chunk->count] = start;
+    chunk->count++;
+    return true;
+}
+
+// Scan until a scan would start at or past chunk->end. With sync, stop as
+// soon as a scan would start where one of sync's did and return the index
+// of that result (sync->count when it is sync's resume point); otherwise
+// return SIZE_MAX.
+static size_t lex_chunk_range(LexerChunk* chunk, const LexerChunk* sync) {
+    Lexer* lexer = &chunk->lexer;
+    size_t next = 0;
+    for (;;) {
+        skip_whitespace(lexer);
+        size_t start = lexer->current;
+        chunk->resume = start;
+        if (sync) {
+            while (next < sync->count && sync->starts[next] < start) next++;
+            if (next < sync->count ? sync->starts[next] == start : start == sync->resume) {
+                return next;
             }
         }
+        if (start >= chunk->end || chunk->failed) return SIZE_MAX;
+
+        Token* token = scan_token(lexer);
+        if (!chunk_push(chunk, start, token)) {
+            chunk->failed = true;
+            return SIZE_MAX;
+        }
+    }
+}
+
+static void* lex_chunk_worker(void* arg) {
+    LexerChunk* chunk = (LexerChunk*)arg;
+    lex_chunk_range(chunk, NULL);
+
+    const LexerScanOps* scan = chunk->lexer.scan;
+    for (size_t pos = chunk->begin;; pos++) {
+        pos = scan->line_end(chunk->lexer.source, pos, chunk->end);
+        if (pos >= chunk->end) break;
+        chunk->newlines++;
+    }
+    return NULL;
+}
+
+// Line, column and line start of offset, counted from the chunk it falls in
+static void chunk_position(const LexerChunk* chunks, size_t chunk_count, size_t offset,
+                           int* line, int* column, size_t* line_start) {
+    size_t index = chunk_count - 1;
+    while (index > 0 && chunks[index].begin > offset) index--;
+
+    const LexerChunk* chunk = &chunks[index];
+    const LexerScanOps* scan = chunk->lexer.scan;
+    *line = chunk->line;
+    *line_start = chunk->begin;
+    for (size_t pos = chunk->begin;; pos++) {
+        pos = scan->line_end(chunk->lexer.source, pos, offset);
+        if (pos >= offset) break;
+        (*line)++;
+        *line_start = pos + 1;
+    }
+    *column = (int)(offset - *line_start) + (*line == 1 ? 1 : 2);
+}
+
+// Append from's results starting at first, moving their lines by line_shift
+static bool append_results(Lexer* lexer, const LexerChunk* from, size_t first, int line_shift) {
+    size_t count = from->count - first;
+    Token** lexed = (Token**)realloc(lexer->lexed, (lexer->lexed_count + count + 1) * sizeof(Token*));
+    if (!lexed) return false;
+    lexer->lexed = lexed;
+
+    for (size_t i = 0; i < count; i++) {
+        Token* token = from->results[first + i];
+        if (token) token->loc.line += line_shift;
+        lexer->lexed[lexer->lexed_count + i] = token;
     }
 
-    if (c == '*') {
-        // Save current position to peek ahead
-        size_t saved_pos = lexer->current;
-        int saved_col = lexer->column;
-        
-        // Skip any whitespace
-        char next = peek(lexer);
-        while (isspace(next)) {
-            advance(lexer);
-            next = peek(lexer);
+    for (size_t i = 0; i < from->diagnostic_count; i++) {
+        LexerDiagnostic diagnostic = from->diagnostics[i];
+        if (diagnostic.token < first) continue;
+        diagnostic.token = lexer->lexed_count + diagnostic.token - first;
+        diagnostic.loc.line += line_shift;
+        if (!push_diagnostic(&lexer->diagnostics, &lexer->diagnostic_count,
+                             &lexer->diagnostic_capacity, diagnostic)) {
+            return false;
         }
+    }
+    lexer->lexed_count += count;
+    return true;
+}
 
-        // If followed immediately by identifier or opening paren, it's likely dereference
-        if (is_alpha(next) || next == '(') {
-            // Look behind for operators or opening delimiters
-            bool preceded_by_op = false;
-            for (size_t i = lexer->start - 1; i > 0; i--) {
-                char prev = lexer->source[i];
-                if (!isspace(prev)) {
-                    preceded_by_op = (prev == '=' || prev == '(' || prev == ',' ||
-                                    prev == '+' || prev == '-' || prev == '*' ||
-                                    prev == '/' || prev == '&' || prev == '|' ||
-                                    prev == '^' || prev == '<' || prev == '>' ||
-                                    prev == '!');
-                    break;
-                }
-            }
-            
-            if (preceded_by_op) {
-                token = make_token(lexer, TOK_DEREF);
-                goto scanned;
-            }
+static bool merge_chunks(Lexer* lexer, LexerChunk* chunks, size_t chunk_count, size_t* resynced) {
+    // Every chunk lexer records each newline it passes, whatever it took
+    // the text around it to be, so each chunk's own range is exact
+    int line = 1;
+    for (size_t i = 0; i < chunk_count; i++) {
+        LexerChunk* chunk = &chunks[i];
+        if (chunk->failed) return false;
+        chunk->line = line;
+        line += (int)chunk->newlines;
+        for (size_t j = 0; j < chunk->lexer.line_count; j++) {
+            size_t offset = chunk->lexer.line_offsets[j];
+            if (offset > chunk->begin && offset <= chunk->end) record_line_start(lexer, offset);
         }
-        
-        // Restore position if we didn't find a clear dereference case
-        lexer->current = saved_pos;
-        lexer->column = saved_col;
-        token = make_token(lexer, TOK_MULTIPLY);
-        goto scanned;
-    }
-
-    if (c == '&') {
-        if (match(lexer, '&')) return make_token(lexer, TOK_AND);
-        // Save current position to peek ahead
-        size_t saved_pos = lexer->current;
-        int saved_col = lexer->column;
-        
-        // Skip any whitespace
-        char next = peek(lexer);
-        while (isspace(next)) {
-            advance(lexer);
-            next = peek(lexer);
+    }
+
+    size_t resume = 0;
+    for (size_t i = 0; i < chunk_count; i++) {
+        LexerChunk* chunk = &chunks[i];
+        size_t first = 0;
+        if (i > 0 && (chunk->count ? chunk->starts[0] : chunk->resume) != resume) {
+            // A comment ran into this chunk; relex from where it ended
+            LexerChunk fixup;
+            int column;
+            size_t line_start;
+            chunk_init(&fixup, lexer, resume, chunk->end);
+            chunk_position(chunks, chunk_count, resume, &fixup.lexer.line, &column, &line_start);
+            fixup.lexer.column = column;
+            fixup.lexer.line_start = &lexer->source[line_start];
+
+            first = lex_chunk_range(&fixup, chunk);
+            bool appended = !fixup.failed && append_results(lexer, &fixup, 0, 0);
+            if (first == SIZE_MAX) resume = fixup.resume;
+            chunk_release(&fixup, lexer);
+            if (!appended) return false;
+            (*resynced)++;
+        }
+        if (first != SIZE_MAX) {
+            if (!append_results(lexer, chunk, first, chunk->line - 1)) return false;
+            resume = chunk->resume;
         }
+    }
+    return true;
+}
 
-        // If followed immediately by identifier or opening paren, it's likely dereference
-        if (is_alpha(next) || next == '(') {
-            // Look behind for operators or opening delimiters
-            bool preceded_by_op = false;
-            for (size_t i = lexer->start - 1; i > 0; i--) {
-                char prev = lexer->source[i];
-                if (!isspace(prev)) {
-                    preceded_by_op = (prev == '=' || prev == '(' || prev == ',' ||
-                                    prev == '+' || prev == '-' || prev == '*' ||
-                                    prev == '/' || prev == '&' || prev == '|' ||
-                                    prev == '^' || prev == '<' || prev == '>' ||
-                                    prev == '!');
-                    break;
-                }
-            }
-            
-            if (preceded_by_op) {
-                token = make_token(lexer, TOK_ADDR_OF);
-                goto scanned;
-            }
+// Scan the whole source ahead on up to threads threads. lexer_next_token()
+// then hands out the same tokens, line numbers and errors, in the same
+// order, as scanning on demand would. Returns false, leaving the lexer to
+// scan on demand, when the source is too small to split, the lexer has
+// already started or streams its input, or memory runs out.
+bool lexer_lex_parallel(Lexer* lexer, int threads) {
+    if (lexer->current != 0 || lexer->lexed || lexer->stream) return false;
+
+    size_t chunk_count = threads > 1 ? (size_t)threads : 1;
+    if (chunk_count > lexer->source_length / LEX_PARALLEL_MIN_CHUNK) {
+        chunk_count = lexer->source_length / LEX_PARALLEL_MIN_CHUNK;
+    }
+    if (chunk_count < 2) return false;
+
+    if (lexer->utf8.validated < lexer->source_length) validate_utf8(lexer);
+    LexerChunk* chunks = (LexerChunk*)calloc(chunk_count, sizeof(LexerChunk));
+    if (!chunks) return false;
+
+    // Cut just after the first newline past each even split point
+    size_t length = lexer->source_length;
+    size_t begin = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < chunk_count && begin < length; i++) {
+        size_t end = length;
+        if (i + 1 < chunk_count) {
+            size_t target = length / chunk_count * (i + 1);
+            end = lexer->scan->line_end(lexer->source, target > begin ? target : begin, length);
+            if (end < length) end++;
         }
-        
-        // Restore position if we didn't find a clear dereference case
-        //lexer->current = saved_pos;
-        //lexer->column = saved_col;
-        lexer_rewind(lexer, saved_pos, saved_col);
-        token = make_token(lexer, TOK_BITAND);
-        goto scanned;
-    }
-
-
-    // Multi-character operators
-    switch (c) {
-        case '(': token = make_token(lexer, TOK_LPAREN); goto scanned;
-        case ')': token = make_token(lexer, TOK_RPAREN); goto scanned;
-        case '[': token = make_token(lexer, TOK_LBRACKET); goto scanned;
-        case ']': token = make_token(lexer, TOK_RBRACKET); goto scanned;
-        case ',': token = make_token(lexer, TOK_COMMA); goto scanned;
-        case ':': token = make_token(lexer, TOK_COLON); goto scanned;
-        case ';': token = make_token(lexer, TOK_SEMICOLON); goto scanned;
-        case '.':
-            // Look ahead to check if this might be a dotted operator
-            size_t pos = lexer->current;
-            char buffer[32] = ".";  // Start with the dot
-            int buf_pos = 1;
-            
-            // Read characters until we find another dot or space
-            while (pos < lexer->source_length && 
-                buf_pos < sizeof(buffer) - 1 && 
-                (isalpha(lexer->source[pos]) || lexer->source[pos] == '.')) {
-                buffer[buf_pos++] = lexer->source[pos++];
-            }
-            buffer[buf_pos] = '\0';
-            
-            // Check if we found a dotted operator
-            for (const Keyword* k = keywords; k->text != NULL; k++) {
-                if (strcasecmp(buffer, k->text) == 0) {
-                    // Found a dotted operator, consume all the characters
-                    lexer->current = pos;
-                    lexer->column += (buf_pos - 1);
-                    token = make_token(lexer, k->type);
-                    if (token) {
-                        token->value = strdup(buffer);
-                    }
-                    goto scanned;
-                }
-            }
-            
-            // Not a dotted operator, handle as normal dot
-            if (match(lexer, '.')) {
-                if (match(lexer, '.')) {
-                    token = make_token(lexer, TOK_DOTDOTDOT);
-                    goto scanned;
-                }
-                token = make_token(lexer, TOK_DOTDOT);
-                goto scanned;
-            }
-            token = make_token(lexer, TOK_DOT);
-            goto scanned;
-        case '+': token = make_token(lexer, TOK_PLUS); goto scanned;
-        case '-': if (match(lexer, '>')) { token = make_token(lexer, TOK_ARROW); goto scanned; }
-            token = make_token(lexer, TOK_MINUS); goto scanned;
-        //case '*': return make_token(lexer, TOK_MULTIPLY);
-        case '/': token = make_token(lexer, TOK_DIVIDE); goto scanned;
-        case '<':
-            if (match(lexer, '=')) { token = make_token(lexer, TOK_LE); goto scanned; }
-            if (match(lexer, '<')) { token = make_token(lexer, TOK_LSHIFT); goto scanned; }
-            token = make_token(lexer, TOK_LT); goto scanned;
-        case '>':
-            if (match(lexer, '=')) { token = make_token(lexer, TOK_GE); goto scanned; }
-            if (match(lexer, '>')) { token = make_token(lexer, TOK_RSHIFT); goto scanned; }
-            token = make_token(lexer, TOK_GT); goto scanned;
-        case '!':
-            if (match(lexer, '=')) { token = make_token(lexer, TOK_NE); goto scanned; }
-            token = make_token(lexer, TOK_NOT); goto scanned;
-        //case '&':
-        //    if (match(lexer, '&')) return make_token(lexer, TOK_AND);
-        //    return make_token(lexer, TOK_BITAND);
-        case '|':
-            if (match(lexer, '|')) { token = make_token(lexer, TOK_OR); goto scanned; }
-            token = make_token(lexer, TOK_BITOR); goto scanned;
-        case '^': token = make_token(lexer, TOK_BITXOR); goto scanned;
-        case '~': token = make_token(lexer, TOK_BITNOT); goto scanned;
-        case '@': token = make_token(lexer, TOK_AT); goto scanned;
-        case '%': token = make_token(lexer, TOK_MOD); goto scanned;
+        chunk_init(&chunks[count++], lexer, begin, end);
+        begin = end;
     }
 
-    return error_token(lexer, "Unexpected character");
-scanned:
-    if (current_flags & DEBUG_LEXER) {
-        fprintf(debug_file, "=== Token Scanned ===\n");
-        debug_token_details(token);
-        fprintf(debug_file, "\n");
+#ifdef PLIKE_HAVE_THREADS
+    pthread_t* workers = (pthread_t*)malloc(count * sizeof(pthread_t));
+    bool* started = (bool*)calloc(count, sizeof(bool));
+    for (size_t i = 1; workers && started && i < count; i++) {
+        started[i] = pthread_create(&workers[i], NULL, lex_chunk_worker, &chunks[i]) == 0;
     }
-    return token;
+    lex_chunk_worker(&chunks[0]);
+    for (size_t i = 1; i < count; i++) {
+        if (started && started[i]) {
+            pthread_join(workers[i], NULL);
+        } else {
+            lex_chunk_worker(&chunks[i]);
+        }
+    }
+    free(workers);
+    free(started);
+#else
+    for (size_t i = 0; i < count; i++) lex_chunk_worker(&chunks[i]);
+#endif
+
+    size_t resynced = 0;
+    bool merged = merge_chunks(lexer, chunks, count, &resynced);
+    if (merged) {
+        int column;
+        size_t line_start;
+        chunk_position(chunks, count, length, &lexer->line, &column, &line_start);
+        lexer->column = column;
+        lexer->line_start = &lexer->source[line_start];
+        lexer->current = length;
+        lexer->start = length;
+        for (size_t i = 0; i < lexer->lexed_count; i++) {
+            if (lexer->lexed[i]) lexer->token_count++;
+        }
+    }
+    for (size_t i = 0; i < count; i++) chunk_release(&chunks[i], lexer);
+    free(chunks);
+
+    if (!merged) {
+        free(lexer->lexed);
+        free(lexer->diagnostics);
+        lexer->lexed = NULL;
+        lexer->lexed_count = 0;
+        lexer->diagnostics = NULL;
+        lexer->diagnostic_count = 0;
+        lexer->diagnostic_capacity = 0;
+        lexer->line_count = 1;
+        return false;
+    }
+
+    if (DEBUG_ENABLED(DEBUG_LEXER)) {
+        fprintf(debug_file, "Lexed %zu tokens ahead in %zu chunks (%zu resynchronized)\n",
+                lexer->token_count, count, resynced);
+    }
+    return true;
+}
+
+// Text of a line already scanned, without its newline. Points into the
+// source buffer, so it is only valid until lexer_destroy().
+// Streamed input only keeps the lines still in its window.
+bool lexer_line_slice(const Lexer* lexer, int line, const char** text, size_t* length) {
+    if (line < 1 || (size_t)line <= lexer->lines_dropped) return false;
+    size_t index = (size_t)line - 1 - lexer->lines_dropped;
+    if (index >= lexer->line_count) return false;
+
+    size_t start = lexer->line_offsets[index];
+    size_t end = index + 1 < lexer->line_count
+        ? lexer->line_offsets[index + 1] - 1
+        : lexer->scan->line_end(lexer->source, start, lexer->source_length);
+    if (end > start && lexer->source[end - 1] == '\r') end--;
+
+    *text = &lexer->source[start];
+    *length = end - start;
+    return true;
+}
+
+// Lines scanned so far, including those streamed out of the window
+size_t lexer_lines_scanned(const Lexer* lexer) {
+    return lexer->lines_dropped + lexer->line_count;
+}
+
+// Character column of a byte column on line, as the lexer counts columns.
+// Only diagnostics ask, and ASCII input has nothing to look up.
+int lexer_character_column(const Lexer* lexer, int line, int column) {
+    const Utf8Map* map = &lexer->utf8;
+    int first = line == 1 ? 1 : 2;
+    if (map->count == 0 || line < 1 || column <= first) return column;
+
+    size_t start;
+    size_t index = (size_t)line - 1 - lexer->lines_dropped;
+    if ((size_t)line > lexer->lines_dropped && index < lexer->line_count) {
+        start = lexer->source_base + lexer->line_offsets[index];
+    } else if (line == map->line) {
+        start = map->line_start;
+    } else {
+        return column;
+    }
+    size_t offset = start + (size_t)(column - first);
+    return column - (int)(utf8_extra_before(map, offset) - utf8_extra_before(map, start));
+}
+
+// Frees the tokens handed out before the previous call, keeping the ones
+// handed out since, so a caller that calls this once it is done with the
+// tokens before each point holds at most two generations. A bracket left
+// open still needs its opening token, so nothing is freed then. The pairs
+// scanned before the previous call go with their tokens, so the bracket
+// table holds two generations too.
+bool lexer_release_tokens(Lexer* lexer) {
+    if (lexer->open_count > 0 || lexer->last_closed || lexer->lexed) return false;
+    arena_release(&lexer->retired);
+    lexer->retired = lexer->arena;
+    arena_init(&lexer->arena, ARENA_DEFAULT_BLOCK_SIZE);
+
+    size_t drop = lexer->bracket_mark - lexer->brackets_dropped;
+    memmove(lexer->brackets, lexer->brackets + drop, (lexer->bracket_count - drop) * sizeof(BracketInfo));
+    lexer->bracket_count -= drop;
+    lexer->brackets_dropped += drop;
+    lexer->bracket_mark = lexer->brackets_dropped + lexer->bracket_count;
+    return true;
+}
+
+// NULL for pairs released with their tokens
+const BracketInfo* lexer_bracket_info(Lexer* lexer, uint32_t id) {
+    if (id <= lexer->brackets_dropped || id > lexer->brackets_dropped + lexer->bracket_count) return NULL;
+    return bracket_at(lexer, id);
 }
 
@@ -0,0 +1,327 @@
+#include "lexer_scan.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PLIKE_SCAN_X86
+#include <immintrin.h>
+#endif
+
+// Scalar kernels
+// These also finish the last partial block for the vector kernels.
+
+static inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool is_identifier_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+static size_t scalar_blank_run(const char* source, size_t pos, size_t length) {
+    while (pos < length && is_blank(source[pos])) pos++;
+    return pos;
+}
+
+static size_t scalar_line_end(const char* source, size_t pos, size_t length) {
+    while (pos < length && source[pos] != '\n') pos++;
+    return pos;
+}
+
+static size_t scalar_block_comment_end(const char* source, size_t pos, size_t length,
+                                       size_t* newlines, size_t* last_newline) {
+    while (pos < length) {
+        if (source[pos] == '*' && pos + 1 < length && source[pos + 1] == '/') {
+            return pos;
+        }
+        if (source[pos] == '\n') {
+            (*newlines)++;
+            *last_newline = pos;
+        }
+        pos++;
+    }
+    return length;
+}
+
+static size_t scalar_identifier_end(const char* source, size_t pos, size_t length) {
+    while (pos < length && is_identifier_char(source[pos])) pos++;
+    return pos;
+}
+
+static size_t scalar_ascii_run(const char* source, size_t pos, size_t length) {
+    while (pos < length && (unsigned char)source[pos] < 0x80) pos++;
+    return pos;
+}
+
+static const LexerScanOps scalar_ops = {
+    "scalar",
+    scalar_blank_run,
+    scalar_line_end,
+    scalar_block_comment_end,
+    scalar_identifier_end,
+    scalar_ascii_run,
+};
+
+#ifdef PLIKE_SCAN_X86
+
+// Most identifiers and blank runs are short, so the vector kernels check
+// this many bytes one at a time before paying for a vector load
+#define SCAN_SHORT_RUN 8
+
+// Record the newlines in bits of mask, where bit i is source[base + i]
+static inline void note_newlines(uint32_t mask, size_t base, size_t* newlines, size_t* last_newline) {
+    if (mask) {
+        *newlines += (size_t)__builtin_popcount(mask);
+        *last_newline = base + 31 - (size_t)__builtin_clz(mask);
+    }
+}
+
+// SSE2 kernels, 16 bytes per step
+
+__attribute__((target("sse2")))
+static inline uint32_t sse2_blank_mask(__m128i v) {
+    __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+    return (uint32_t)_mm_movemask_epi8(blank);
+}
+
+// Bytes >= 0x80 compare as negative, so they never land in a range
+__attribute__((target("sse2")))
+static inline uint32_t sse2_identifier_mask(__m128i v) {
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                  _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under));
+}
+
+__attribute__((target("sse2")))
+static size_t sse2_blank_run(const char* source, size_t pos, size_t length) {
+    size_t limit = pos + SCAN_SHORT_RUN < length ? pos + SCAN_SHORT_RUN : length;
+    while (pos < limit) {
+        if (!is_blank(source[pos])) return pos;
+        pos++;
+    }
+    while (pos + 16 <= length) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(source + pos));
+        uint32_t stop = ~sse2_blank_mask(v) & 0xFFFF;
+        if (stop) return pos + (size_t)__builtin_ctz(stop);
+        pos += 16;
+    }
+    return scalar_blank_run(source, pos, length);
+}
+
+__attribute__((target("sse2")))
+static size_t sse2_line_end(const char* source, size_t pos, size_t length) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (pos + 16 <= length) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(source + pos));
+        uint32_t hit = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        if (hit) return pos + (size_t)__builtin_ctz(hit);
+        pos += 16;
+    }
+    return scalar_line_end(source, pos, length);
+}
+
+__attribute__((target("sse2")))
+static size_t sse2_block_comment_end(const char* source, size_t pos, size_t length,
+                                     size_t* newlines, size_t* last_newline) {
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i newline = _mm_set1_epi8('\n');
+    // The shifted load reads one byte further
+    while (pos + 17 <= length) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(source + pos));
+        __m128i b = _mm_loadu_si128((const __m128i*)(source + pos + 1));
+        uint32_t nl = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, newline));
+        uint32_t end = (uint32_t)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, star), _mm_cmpeq_epi8(b, slash)));
+        if (end) {
+            uint32_t index = (uint32_t)__builtin_ctz(end);
+            note_newlines(nl & ((1u << index) - 1), pos, newlines, last_newline);
+            return pos + index;
+        }
+        note_newlines(nl, pos, newlines, last_newline);
+        pos += 16;
+    }
+    return scalar_block_comment_end(source, pos, length, newlines, last_newline);
+}
+
+__attribute__((target("sse2")))
+static size_t sse2_identifier_end(const char* source, size_t pos, size_t length) {
+    size_t limit = pos + SCAN_SHORT_RUN < length ? pos + SCAN_SHORT_RUN : length;
+    while (pos < limit) {
+        if (!is_identifier_char(source[pos])) return pos;
+        pos++;
+    }
+    while (pos + 16 <= length) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(source + pos));
+        uint32_t stop = ~sse2_identifier_mask(v) & 0xFFFF;
+        if (stop) return pos + (size_t)__builtin_ctz(stop);
+        pos += 16;
+    }
+    return scalar_identifier_end(source, pos, length);
+}
+
+// The movemask of the raw bytes is their high bits
+__attribute__((target("sse2")))
+static size_t sse2_ascii_run(const char* source, size_t pos, size_t length) {
+    while (pos + 16 <= length) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(source + pos));
+        uint32_t high = (uint32_t)_mm_movemask_epi8(v);
+        if (high) return pos + (size_t)__builtin_ctz(high);
+        pos += 16;
+    }
+    return scalar_ascii_run(source, pos, length);
+}
+
+static const LexerScanOps sse2_ops = {
+    "sse2",
+    sse2_blank_run,
+    sse2_line_end,
+    sse2_block_comment_end,
+    sse2_identifier_end,
+    sse2_ascii_run,
+};
+
+// AVX2 kernels, 32 bytes per step
+
+__attribute__((target("avx2")))
+static inline uint32_t avx2_blank_mask(__m256i v) {
+    __m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+    return (uint32_t)_mm256_movemask_epi8(blank);
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t avx2_identifier_mask(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), under));
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_blank_run(const char* source, size_t pos, size_t length) {
+    size_t limit = pos + SCAN_SHORT_RUN < length ? pos + SCAN_SHORT_RUN : length;
+    while (pos < limit) {
+        if (!is_blank(source[pos])) return pos;
+        pos++;
+    }
+    while (pos + 32 <= length) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(source + pos));
+        uint32_t stop = ~avx2_blank_mask(v);
+        if (stop) return pos + (size_t)__builtin_ctz(stop);
+        pos += 32;
+    }
+    return sse2_blank_run(source, pos, length);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_line_end(const char* source, size_t pos, size_t length) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    while (pos + 32 <= length) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(source + pos));
+        uint32_t hit = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+        if (hit) return pos + (size_t)__builtin_ctz(hit);
+        pos += 32;
+    }
+    return sse2_line_end(source, pos, length);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_block_comment_end(const char* source, size_t pos, size_t length,
+                                     size_t* newlines, size_t* last_newline) {
+    const __m256i star = _mm256_set1_epi8('*');
+    const __m256i slash = _mm256_set1_epi8('/');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    while (pos + 33 <= length) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(source + pos));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(source + pos + 1));
+        uint32_t nl = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, newline));
+        uint32_t end = (uint32_t)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, star), _mm256_cmpeq_epi8(b, slash)));
+        if (end) {
+            uint32_t index = (uint32_t)__builtin_ctz(end);
+            uint32_t before = index ? (nl & (0xFFFFFFFFu >> (32 - index))) : 0;
+            note_newlines(before, pos, newlines, last_newline);
+            return pos + index;
+        }
+        note_newlines(nl, pos, newlines, last_newline);
+        pos += 32;
+    }
+    return sse2_block_comment_end(source, pos, length, newlines, last_newline);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_identifier_end(const char* source, size_t pos, size_t length) {
+    size_t limit = pos + SCAN_SHORT_RUN < length ? pos + SCAN_SHORT_RUN : length;
+    while (pos < limit) {
+        if (!is_identifier_char(source[pos])) return pos;
+        pos++;
+    }
+    while (pos + 32 <= length) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(source + pos));
+        uint32_t stop = ~avx2_identifier_mask(v);
+        if (stop) return pos + (size_t)__builtin_ctz(stop);
+        pos += 32;
+    }
+    return sse2_identifier_end(source, pos, length);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_ascii_run(const char* source, size_t pos, size_t length) {
+    while (pos + 32 <= length) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(source + pos));
+        uint32_t high = (uint32_t)_mm256_movemask_epi8(v);
+        if (high) return pos + (size_t)__builtin_ctz(high);
+        pos += 32;
+    }
+    return sse2_ascii_run(source, pos, length);
+}
+
+static const LexerScanOps avx2_ops = {
+    "avx2",
+    avx2_blank_run,
+    avx2_line_end,
+    avx2_block_comment_end,
+    avx2_identifier_end,
+    avx2_ascii_run,
+};
+
+#endif // PLIKE_SCAN_X86
+
+const LexerScanOps* lexer_scan_backend(ScanBackend backend) {
+    switch (backend) {
+        case SCAN_BACKEND_SCALAR:
+            return &scalar_ops;
+#ifdef PLIKE_SCAN_X86
+        case SCAN_BACKEND_SSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2") ? &sse2_ops : NULL;
+        case SCAN_BACKEND_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? &avx2_ops : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+const LexerScanOps* lexer_scan_ops(void) {
+    static const LexerScanOps* selected = NULL;
+    if (!selected) {
+        for (int backend = SCAN_BACKEND_COUNT - 1; backend >= 0 && !selected; backend--) {
+            selected = lexer_scan_backend((ScanBackend)backend);
+        }
+    }
+    return selected;
+}
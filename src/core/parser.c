@@ -8,6 +8,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PLIKE_HAVE_THREADS
+#include <pthread.h>
+#endif
 
 // Forward declarations for recursive descent functions
 static ASTNode* parse_declaration(Parser* parser);
@@ -32,17 +40,7 @@ static ASTNode* parse_type_specifier(Parser* parser, int* pointer_level);
 static ASTNode* parse_parameter(Parser* parser);
 //static ASTNode* parse_array_bounds(Parser* parser);
 static ASTNode* parse_function_call(Parser* parser, const char* name);
-static ASTNode* parse_logical_or(Parser* parser);
-static ASTNode* parse_logical_and(Parser* parser);
-static ASTNode* parse_equality(Parser* parser);
-static ASTNode* parse_bitwise_or(Parser* parser);
-static ASTNode* parse_bitwise_xor(Parser* parser);
-static ASTNode* parse_bitwise_and(Parser* parser);
-static ASTNode* parse_shift(Parser* parser);
-static ASTNode* parse_comparison(Parser* parser);
-static ASTNode* parse_term(Parser* parser);
-static ASTNode* parse_factor(Parser* parser);
-static ASTNode* parse_unary(Parser* parser);
+static ASTNode* parse_binary(Parser* parser, int min_precedence);
 static ASTNode* parse_primary(Parser* parser);
 static ASTNode* parse_array_access(Parser* parser, ASTNode* array);
 static bool parse_dimension_bounds(Parser* parser, DimensionBounds* bounds);
@@ -51,6 +49,7 @@ static ASTNode* parse_record_type(Parser* parser, bool is_typedef);
 static ASTNode* parse_record_field(Parser* parser);
 static ASTNode* parse_type_declaration(Parser* parser);
 static ASTNode* parse_field_access(Parser* parser, ASTNode* record, Symbol* record_sym);
+static void advance(Parser* parser);
 
 static Token* consume_token_with_trace(Parser* parser, const char* context) {
     verbose_print("\n=== CONSUMING TOKEN AT %s ===\n", context);
@@ -69,8 +68,7 @@ static Token* consume_token_with_trace(Parser* parser, const char* context) {
     }
 
     Token* result = parser->ctx.current;
-    parser->ctx.current = parser->ctx.peek;
-    parser->ctx.peek = lexer_next_token(parser->ctx.lexer);
+    advance(parser);
 
     verbose_print("After consumption:\n");
     verbose_print("  Current: type=%d, value='%s', line=%d, col=%d\n",
@@ -119,9 +117,7 @@ static void advance_with_trace(Parser* parser, const char* context) {
     verbose_print("\n=== ADVANCING TOKEN AT %s ===\n", context);
     debug_print_parser_state_verb(parser, "BEFORE ADVANCE");
     
-    Token* old_current = parser->ctx.current;
-    parser->ctx.current = parser->ctx.peek;
-    parser->ctx.peek = lexer_next_token(parser->ctx.lexer);
+    advance(parser);
     
     debug_print_parser_state_verb(parser, "AFTER ADVANCE");
     verbose_print("=== END ADVANCING ===\n\n");
@@ -158,33 +154,137 @@ static bool is_statement_start(TokenType type) {
            type == TOK_IDENTIFIER;
 }
 
-// Parser creation and destruction
-Parser* parser_create(Lexer* lexer) {
-    verbose_print("Allocating parser structure...\n");
-    Parser* parser = (Parser*)malloc(sizeof(Parser));
-    if (!parser) return NULL;
+// Error recovery sets
+// Classes of tokens that recovery can stop at. A rule's sync set is a mask
+// of them, so skipping a token costs one lookup and one test.
+enum {
+    SYNC_DECLARATION = 1 << 0,  // FIRST(declaration)
+    SYNC_STATEMENT = 1 << 1,    // FIRST(statement), for the keyword-led ones
+    SYNC_CLOSER = 1 << 2,       // FOLLOW(statement): what closes a statement list
+    SYNC_LINE_START = 1 << 3    // FIRST(statement) when first on its line
+};
+
+static const unsigned char sync_class[TOK_COUNT] = {
+    [TOK_FUNCTION] = SYNC_DECLARATION,
+    [TOK_PROCEDURE] = SYNC_DECLARATION,
+    [TOK_TYPE] = SYNC_DECLARATION,
+    [TOK_VAR] = SYNC_DECLARATION | SYNC_STATEMENT,
+    [TOK_IF] = SYNC_STATEMENT,
+    [TOK_WHILE] = SYNC_STATEMENT,
+    [TOK_FOR] = SYNC_STATEMENT,
+    [TOK_REPEAT] = SYNC_STATEMENT,
+    [TOK_RETURN] = SYNC_STATEMENT,
+    [TOK_BEGIN] = SYNC_STATEMENT,
+    [TOK_PRINT] = SYNC_STATEMENT,
+    [TOK_READ] = SYNC_STATEMENT,
+    [TOK_END] = SYNC_CLOSER,
+    [TOK_ELSEIF] = SYNC_CLOSER,
+    [TOK_ELSE] = SYNC_CLOSER,
+    [TOK_ENDIF] = SYNC_CLOSER,
+    [TOK_ENDWHILE] = SYNC_CLOSER,
+    [TOK_ENDFOR] = SYNC_CLOSER,
+    [TOK_UNTIL] = SYNC_CLOSER,
+    [TOK_ENDFUNCTION] = SYNC_CLOSER,
+    [TOK_ENDPROCEDURE] = SYNC_CLOSER,
+    [TOK_IDENTIFIER] = SYNC_LINE_START,
+};
+
+// Between declarations, and inside functions and procedures
+#define SYNC_TOP_LEVEL SYNC_DECLARATION
+#define SYNC_BODY (SYNC_DECLARATION | SYNC_STATEMENT | SYNC_CLOSER | SYNC_LINE_START)
+
+static unsigned sync_classes(TokenType type, unsigned mask) {
+    return (unsigned)type < TOK_COUNT ? sync_class[type] & mask : 0;
+}
 
-    verbose_print("Initializing parser context...\n");
+// Token buffer
+// Lex until the buffer holds index, stopping at EOF. Once EOF is buffered
+// it answers every index past the end.
+static bool token_buffer_fill(Parser* parser, size_t index) {
+    TokenBuffer* buffer = &parser->ctx.buffer;
+    while (buffer->count <= index) {
+        if (buffer->count > 0 && buffer->tokens[buffer->count - 1]->type == TOK_EOF) {
+            return false;
+        }
+        if (buffer->count == buffer->capacity) {
+            size_t new_capacity = buffer->capacity ? buffer->capacity * 2 : TOKEN_BUFFER_INITIAL_CAPACITY;
+            Token** new_tokens = (Token**)realloc(buffer->tokens, new_capacity * sizeof(Token*));
+            if (!new_tokens) return false;
+            buffer->tokens = new_tokens;
+            buffer->capacity = new_capacity;
+        }
+        Token* token = lexer_next_token(parser->ctx.lexer);
+        if (!token) continue;  // Lexical error already reported, keep scanning
+        buffer->tokens[buffer->count++] = token;
+    }
+    return true;
+}
+
+// Token k positions after the current one (k = 0 is current)
+Token* parser_peek_n(Parser* parser, size_t k) {
+    TokenBuffer* buffer = &parser->ctx.buffer;
+    size_t index = buffer->position + k;
+    if (!token_buffer_fill(parser, index)) {
+        return buffer->count ? buffer->tokens[buffer->count - 1] : NULL;
+    }
+    return buffer->tokens[index];
+}
+
+static void sync_token_window(Parser* parser) {
+    TokenBuffer* buffer = &parser->ctx.buffer;
+    parser->ctx.prev = buffer->position > 0 ? buffer->tokens[buffer->position - 1] : NULL;
+    parser->ctx.current = parser_peek_n(parser, 0);
+    parser->ctx.peek = parser_peek_n(parser, 1);
+}
+
+// Parser creation and destruction
+static void parser_init(Parser* parser, Lexer* lexer, SymbolTable* symbols) {
     parser->ctx.lexer = lexer;
     parser->ctx.prev = NULL;
     parser->ctx.current = NULL;
     parser->ctx.peek = NULL;
-    verbose_print("Creating symbol table...\n");
-    parser->ctx.symbols = symtable_create();
+    parser->ctx.buffer = (TokenBuffer){0};
+    parser->ctx.symbols = symbols;
     parser->ctx.current_function = NULL;
     parser->ctx.current_record = NULL;
+    parser->ctx.is_function = false;
     parser->ctx.in_loop = false;
+    parser->ctx.statement_depth = 0;
+    parser->ctx.statement_errors = 0;
+    parser->ctx.sync = SYNC_TOP_LEVEL;
     parser->ctx.error_count = 0;
+    parser->recovery = (RecoveryStats){0};
+    parser->units = NULL;
+    parser->unit_count = 0;
+    parser->pending_calls = NULL;
+    parser->pending_count = 0;
+    parser->pending_capacity = 0;
+    parser->defer_calls = false;
+    parser->lazy = NULL;
+    parser->lazy_count = 0;
+    parser->lazy_bodies = g_config.check_signatures;
     parser->had_error = false;
     parser->panic_mode = false;
+    ast_arena_init(&parser->ast);
+    ast_arena_init(&parser->unit_ast);
+    parser->token_mark = 0;
+}
+
+Parser* parser_create(Lexer* lexer) {
+    verbose_print("Allocating parser structure...\n");
+    Parser* parser = (Parser*)malloc(sizeof(Parser));
+    if (!parser) return NULL;
+
+    verbose_print("Initializing parser context...\n");
+    verbose_print("Creating symbol table...\n");
+    parser_init(parser, lexer, symtable_create());
  
     verbose_print("Getting initial tokens...\n");    
     // Prime the parser with the first two tokens
-    parser->ctx.current = lexer_next_token(lexer);
+    sync_token_window(parser);
     if (parser->ctx.current) {
         verbose_print("First token: type=%d\n", parser->ctx.current->type);
     }
-    parser->ctx.peek = lexer_next_token(lexer);
     if (parser->ctx.peek) {
         verbose_print("Second token: type=%d\n", parser->ctx.peek->type);
     }
@@ -193,23 +293,34 @@ Parser* parser_create(Lexer* lexer) {
     return parser;
 }
 
+static void release_units(Parser* parser);
+
 void parser_destroy(Parser* parser) {
     if (parser) {
-        token_destroy(parser->ctx.prev);
-        token_destroy(parser->ctx.current);
-        token_destroy(parser->ctx.peek);
+        // Tokens belong to the lexer's arena
+        free(parser->ctx.buffer.tokens);
         symtable_destroy(parser->ctx.symbols);
         free(parser->ctx.current_function);
+        if (DEBUG_ENABLED(DEBUG_PARSER)) {
+            fprintf(debug_file, "AST nodes: %zu (%zu arena bytes in %zu blocks, %zu child arrays spilled)\n",
+                    parser->ast.node_count, parser->ast.arena.bytes_used,
+                    parser->ast.arena.block_count, parser->ast.spilled);
+        }
+        release_units(parser);
+        free(parser->pending_calls);
+        free(parser->lazy);
+        ast_arena_release(&parser->ast);
+        ast_arena_release(&parser->unit_ast);
         free(parser);
     }
 }
 
 // Token handling functions
 static void advance(Parser* parser) {
-    token_destroy(parser->ctx.prev);
-    parser->ctx.prev = parser->ctx.current;
-    parser->ctx.current = parser->ctx.peek;
-    parser->ctx.peek = lexer_next_token(parser->ctx.lexer);
+    if (parser->ctx.current && parser->ctx.current->type != TOK_EOF) {
+        parser->ctx.buffer.position++;
+    }
+    sync_token_window(parser);
 }
 
 static bool check(Parser* parser, TokenType type) {
@@ -231,21 +342,9 @@ static Token* consume(Parser* parser, TokenType type, const char* message) {
            type, parser->ctx.current->type, parser->ctx.current->value);
            
     if (check(parser, type)) {
-        Token* token = (Token*)malloc(sizeof(Token));
-        if (!token) {
-            verbose_print("Failed to allocate memory for token\n");
-            return NULL;
-        }
-        
-        token->type = parser->ctx.current->type;
-        token->value = strdup(parser->ctx.current->value);  // Make sure to copy the entire value
-        token->loc = parser->ctx.current->loc;
-        
-        if (!token->value) {
-            verbose_print("Failed to duplicate token value\n");
-            free(token);
-            return NULL;
-        }
+        // Tokens live until the lexer is destroyed, so hand out the
+        // current one directly instead of copying it
+        Token* token = parser->ctx.current;
         debug_parser_token_consume(parser, token, message);
         verbose_print("Successfully consumed token: %s\n", token->value);
         advance(parser);
@@ -256,77 +355,116 @@ static Token* consume(Parser* parser, TokenType type, const char* message) {
     return NULL;
 }
 
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Whether the current token is in the sync set of the rules being parsed.
+// Names only start a statement there when they come first on their line.
+static bool at_sync_point(Parser* parser) {
+    unsigned classes = sync_classes(parser->ctx.current->type, parser->ctx.sync);
+    if (classes & ~SYNC_LINE_START) return true;
+    return classes && parser->ctx.prev && parser->ctx.prev->loc.line != parser->ctx.current->loc.line;
+}
+
+// Skips past a ';' or up to a token in the sync set. Panic mode stays on
+// until the next statement or declaration starts, so the rules unwinding
+// from the error don't report errors of their own.
 static void synchronize(Parser* parser) {
     debug_parser_error_sync(parser, "Starting synchronization");
     parser->panic_mode = true;
+    double start = now_seconds();
+    size_t from = parser->ctx.buffer.position;
 
     while (!check(parser, TOK_EOF)) {
-        if (parser->ctx.current->type == TOK_SEMICOLON) {
+        if (check(parser, TOK_SEMICOLON)) {
             advance(parser);
-            parser->panic_mode = false;
             debug_parser_error_sync(parser, "Synchronized at semicolon");
-            return;
+            break;
         }
-
-        switch (parser->ctx.current->type) {
-            case TOK_FUNCTION:
-            case TOK_PROCEDURE:
-            case TOK_VAR:
-            case TOK_BEGIN:
-            case TOK_END:
-                parser->panic_mode = false;
-                debug_parser_error_sync(parser, "Synchronized at statement boundary");
-                return;
-            default:
-                advance(parser);
+        if (at_sync_point(parser)) {
+            debug_parser_error_sync(parser, "Synchronized at statement boundary");
+            break;
         }
+        advance(parser);
+    }
+    if (check(parser, TOK_EOF)) {
+        debug_parser_error_sync(parser, "Synchronized at EOF");
     }
 
-    parser->panic_mode = false;
-    debug_parser_error_sync(parser, "Synchronized at EOF");
+    parser->recovery.recoveries++;
+    parser->recovery.skipped += parser->ctx.buffer.position - from;
+    parser->recovery.seconds += now_seconds() - start;
 }
 
 void parser_error(Parser* parser, const char* message) {
-    if (parser->panic_mode) return;
+    if (parser->panic_mode) {
+        parser->recovery.suppressed++;
+        return;
+    }
     
     parser->had_error = true;
+    // Past the cap the rest of the statement is taken as cascading errors
+    if (parser->ctx.statement_errors++ >= MAX_STATEMENT_ERRORS) {
+        parser->recovery.suppressed++;
+        synchronize(parser);
+        return;
+    }
     parser->ctx.error_count++;
     
     error_report(ERROR_SYNTAX, SEVERITY_ERROR, 
                 parser->ctx.current->loc, "%s", message);
     
+    // A muted parse is thrown away and redone at its first error, which is
+    // reported then; skip to EOF rather than recover
+    if (error_muted()) {
+        TokenBuffer* buffer = &parser->ctx.buffer;
+        if (buffer->count > 0) buffer->position = buffer->count - 1;
+        sync_token_window(parser);
+        return;
+    }
+    // Past the error limit nothing more would be reported either, so the
+    // input ends here without lexing the rest
+    if (error_limit_reached()) {
+        TokenBuffer* buffer = &parser->ctx.buffer;
+        parser->end_of_input = (Token){.type = TOK_EOF, .value = "", .loc = parser->ctx.current->loc};
+        buffer->tokens[buffer->position] = &parser->end_of_input;
+        buffer->count = buffer->position + 1;
+        sync_token_window(parser);
+        parser->panic_mode = true;
+        return;
+    }
+
     debug_print_error_context(parser->ctx.current->loc);
     debug_print_parser_state_d(parser);
     synchronize(parser);
 }
 
+// For rules that failed without a syntax error
 bool parser_sync_to_next_statement(Parser* parser) {
-    parser->panic_mode = true;
+    synchronize(parser);
+    parser->panic_mode = false;
+    return !check(parser, TOK_EOF);
+}
 
-    while (parser->ctx.current->type != TOK_EOF) {
-        if (parser->ctx.current->type == TOK_SEMICOLON) {
-            advance(parser);
-            parser->panic_mode = false;
-            return true;
-        }
+// Whether a statement list can go on after a statement that failed. Past a
+// syntax error it can, from where recovery stopped; a token no statement
+// can start with is skipped there, so the list always moves on.
+static bool resume_statements(Parser* parser, size_t start) {
+    if (!parser->panic_mode) return false;
+    if (parser->ctx.buffer.position == start) advance(parser);
+    return true;
+}
 
-        switch (parser->ctx.current->type) {
-            case TOK_FUNCTION:
-            case TOK_PROCEDURE:
-            case TOK_VAR:
-            case TOK_IF:
-            case TOK_WHILE:
-            case TOK_FOR:
-            case TOK_RETURN:
-                parser->panic_mode = false;
-                return true;
-            default:
-                advance(parser);
-        }
-    }
+// A token that closes a statement list, whether or not it is this list's
+static bool at_list_end(Parser* parser) {
+    return check(parser, TOK_EOF) || sync_classes(parser->ctx.current->type, SYNC_CLOSER);
+}
 
-    parser->panic_mode = false;
-    return false;
+RecoveryStats parser_recovery_stats(const Parser* parser) {
+    return parser->recovery;
 }
 
 static void debug_print_bounds(const char* context, Symbol* sym) {
@@ -373,6 +511,14 @@ static void debug_print_bounds(const char* context, Symbol* sym) {
     }
 }
 
+// Only variables and parameters have a pointer level; any other symbol
+// reads as an unknown name
+static Symbol* lookup_variable(Parser* parser, const char* name) {
+    Symbol* sym = symtable_lookup(parser->ctx.symbols, name);
+    if (sym && (sym->kind == SYMBOL_VARIABLE || sym->kind == SYMBOL_PARAMETER)) return sym;
+    return NULL;
+}
+
 static bool should_auto_dereference(Parser* parser, ASTNode* node) {
     if (!node) return false;
 
@@ -399,12 +545,403 @@ static bool should_auto_dereference(Parser* parser, ASTNode* node) {
     return false;
 }
 
+// Parallel parsing
+// scan_units() finds the top-level functions and procedures in the tokens.
+// The rest of the top level is parsed in order on this thread, forking the
+// symbol table at each unit so the unit sees just the globals before it.
+// The units are then parsed side by side, each by a parser of its own over
+// its slice of the tokens, and merged in source order, their globals joined
+// into the table one unit at a time. An error, a unit the parse doesn't end
+// where the scan did, or a global declared twice throws all of it away and
+// the file is parsed in order, so the result is always the same.
+
+struct ParseUnit {
+    size_t begin;           // Token range, end just past 'end Name'
+    size_t end;
+    bool ready;             // parser set up by prepare_unit()
+    Parser parser;          // Forked symbols, owns the unit's subtree
+    Token eof;              // Stands in for the token at end
+    ASTNode* node;
+    int errors;
+};
+
+typedef struct ParseUnit ParseUnit;
+
+typedef struct {
+    ASTNode* node;
+    size_t units_before;    // Units ahead of it in the source
+    size_t calls_end;       // End of its calls in the parser's pending calls
+} GlobalDeclaration;
+
+typedef struct {
+    ParseUnit* units;
+    size_t count;
+    atomic_size_t next;
+} UnitQueue;
+
+// Tokens that can start the top-level declaration after a unit
+static bool is_unit_follower(TokenType type) {
+    return type == TOK_EOF || type == TOK_FUNCTION || type == TOK_PROCEDURE ||
+           type == TOK_VAR || type == TOK_TYPE || is_type_keyword(type);
+}
+
+// Index just past 'end end Name' or 'end endfunction' at i, closing the
+// body of the unit called name, or 0 if the tokens there don't close it
+static size_t unit_close(Token** tokens, size_t count, size_t i, const char* name) {
+    if (tokens[i]->type != TOK_END || i + 1 >= count) return 0;
+    Token* next = tokens[i + 1];
+    if (next->type == TOK_ENDFUNCTION || next->type == TOK_ENDPROCEDURE) return i + 2;
+    if (next->type == TOK_END && i + 2 < count &&
+        tokens[i + 2]->type == TOK_IDENTIFIER && strcmp(tokens[i + 2]->value, name) == 0) {
+        return i + 3;
+    }
+    return 0;
+}
+
+// Index just past the tokens closing the unit whose 'function' or
+// 'procedure' is at head, or 0 if there are none
+static size_t unit_end(Token** tokens, size_t count, size_t head) {
+    if (head + 1 >= count || tokens[head + 1]->type != TOK_IDENTIFIER) return 0;
+    const char* name = tokens[head + 1]->value;
+    for (size_t i = head + 2; i + 1 < count; i++) {
+        TokenType type = tokens[i]->type;
+        if (type == TOK_FUNCTION || type == TOK_PROCEDURE) return 0;
+        size_t end = unit_close(tokens, count, i, name);
+        if (end && end < count && is_unit_follower(tokens[end]->type)) return end;
+    }
+    return 0;
+}
+
+// Whether a unit, return type first if it has one, starts at start
+static bool unit_at(Token** tokens, size_t count, size_t start, size_t* end) {
+    size_t head = start;
+    if (is_type_keyword(tokens[start]->type)) {
+        int line = tokens[start]->loc.line;
+        while (head < count && tokens[head]->loc.line == line &&
+               tokens[head]->type != TOK_FUNCTION && tokens[head]->type != TOK_EOF) {
+            head++;
+        }
+        if (head == count || tokens[head]->type != TOK_FUNCTION || tokens[head]->loc.line != line) {
+            return false;
+        }
+    } else if (tokens[start]->type != TOK_FUNCTION && tokens[start]->type != TOK_PROCEDURE) {
+        return false;
+    }
+    *end = unit_end(tokens, count, head);
+    return *end != 0;
+}
+
+static ParseUnit* scan_units(const TokenBuffer* buffer, size_t* count) {
+    ParseUnit* units = NULL;
+    size_t capacity = 0;
+    *count = 0;
+    for (size_t i = 0; i < buffer->count && buffer->tokens[i]->type != TOK_EOF;) {
+        size_t end;
+        if (!unit_at(buffer->tokens, buffer->count, i, &end)) {
+            i++;
+            continue;
+        }
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            ParseUnit* grown = (ParseUnit*)realloc(units, capacity * sizeof(ParseUnit));
+            if (!grown) {
+                free(units);
+                *count = 0;
+                return NULL;
+            }
+            units = grown;
+        }
+        units[(*count)++] = (ParseUnit){.begin = i, .end = end};
+        i = end;
+    }
+    return units;
+}
+
+static void add_pending_call(Parser* parser, ASTNode* call) {
+    if (parser->pending_count == parser->pending_capacity) {
+        size_t capacity = parser->pending_capacity ? parser->pending_capacity * 2 : 16;
+        ASTNode** grown = (ASTNode**)realloc(parser->pending_calls, capacity * sizeof(ASTNode*));
+        if (!grown) return;
+        parser->pending_calls = grown;
+        parser->pending_capacity = capacity;
+    }
+    parser->pending_calls[parser->pending_count++] = call;
+}
+
+static Symbol* find_callee(Parser* parser, const char* name) {
+    Symbol* sym = symtable_lookup_global(parser->ctx.symbols, name);
+    if (sym && (sym->kind == SYMBOL_FUNCTION || sym->kind == SYMBOL_PROCEDURE)) return sym;
+    return NULL;
+}
+
+// Points call at the function or procedure it names, if that is declared
+// yet, and otherwise keeps it for resolve_forward_calls()
+static void resolve_call(Parser* parser, ASTNode* call) {
+    call->data.name.symbol = find_callee(parser, call->data.value);
+    if (!call->data.name.symbol) add_pending_call(parser, call);
+}
+
+// Units and the rest of a parallel parse can't see everything before
+// them, so they keep their calls for parse_in_parallel() to resolve in
+// source order
+static void resolve_callee(Parser* parser, ASTNode* call) {
+    if (parser->ctx.symbols->base || parser->defer_calls) {
+        add_pending_call(parser, call);
+    } else {
+        resolve_call(parser, call);
+    }
+}
+
+// Once the whole program is parsed, resolves the calls made before their
+// function or procedure was declared. Code generation looks again for any
+// still left, like calls to C functions.
+static void resolve_forward_calls(Parser* parser) {
+    for (size_t i = 0; i < parser->pending_count; i++) {
+        ASTNode* call = parser->pending_calls[i];
+        call->data.name.symbol = find_callee(parser, call->data.value);
+    }
+    parser->pending_count = 0;
+}
+
+// Set up the unit's parser over its tokens, with the globals so far
+static bool prepare_unit(Parser* parser, ParseUnit* unit) {
+    TokenBuffer* buffer = &parser->ctx.buffer;
+    size_t length = unit->end - unit->begin;
+    Token** tokens = (Token**)malloc((length + 1) * sizeof(Token*));
+    SymbolTable* symbols = symtable_fork(parser->ctx.symbols);
+    if (!tokens || !symbols) {
+        free(tokens);
+        symtable_destroy(symbols);
+        return false;
+    }
+    memcpy(tokens, &buffer->tokens[unit->begin], length * sizeof(Token*));
+    unit->eof = *buffer->tokens[buffer->count - 1];
+    unit->eof.loc = buffer->tokens[unit->end]->loc;
+    tokens[length] = &unit->eof;
+
+    parser_init(&unit->parser, parser->ctx.lexer, symbols);
+    unit->parser.ctx.buffer = (TokenBuffer){tokens, length + 1, length + 1, 0};
+    sync_token_window(&unit->parser);
+    unit->ready = true;
+    return true;
+}
+
+static void parse_unit(ParseUnit* unit) {
+    AstArena* previous = ast_use_arena(&unit->parser.ast);
+    error_mute();
+    unit->node = parse_declaration(&unit->parser);
+    unit->errors = error_unmute();
+    ast_use_arena(previous);
+}
+
+static void* unit_worker(void* arg) {
+    UnitQueue* queue = (UnitQueue*)arg;
+    for (;;) {
+        size_t index = atomic_fetch_add(&queue->next, 1);
+        if (index >= queue->count) return NULL;
+        parse_unit(&queue->units[index]);
+    }
+}
+
+// Units are handed out one at a time, since their sizes vary a lot
+static void parse_units(ParseUnit* units, size_t count, int threads) {
+    UnitQueue queue = {units, count, 0};
+#ifdef PLIKE_HAVE_THREADS
+    size_t extra = (size_t)threads < count ? (size_t)threads - 1 : count - 1;
+    pthread_t* workers = extra ? (pthread_t*)malloc(extra * sizeof(pthread_t)) : NULL;
+    size_t started = 0;
+    while (workers && started < extra &&
+           pthread_create(&workers[started], NULL, unit_worker, &queue) == 0) {
+        started++;
+    }
+    unit_worker(&queue);
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+#else
+    (void)threads;
+    unit_worker(&queue);
+#endif
+}
+
+static bool merge_unit(Parser* parser, ASTNode* root, ParseUnit* unit) {
+    // The parse has to end where the scan did
+    if (!unit->node || unit->errors > 0 || unit->parser.ctx.current->type != TOK_EOF) return false;
+    if (!symtable_join(parser->ctx.symbols, unit->parser.ctx.symbols)) return false;
+    unit->parser.ctx.symbols = NULL;
+    // Units are merged in source order, so calls see what a serial parse would
+    for (size_t i = 0; i < unit->parser.pending_count; i++) {
+        resolve_call(parser, unit->parser.pending_calls[i]);
+    }
+    ast_add_child(root, unit->node);
+    return true;
+}
+
+static void release_units(Parser* parser) {
+    for (size_t i = 0; i < parser->unit_count; i++) {
+        ParseUnit* unit = &parser->units[i];
+        if (!unit->ready) continue;
+        free(unit->parser.ctx.buffer.tokens);
+        symtable_destroy(unit->parser.ctx.symbols);
+        free(unit->parser.ctx.current_function);
+        free(unit->parser.pending_calls);
+        ast_arena_release(&unit->parser.ast);
+    }
+    free(parser->units);
+    parser->units = NULL;
+    parser->unit_count = 0;
+}
+
+// Back to where parser_create() left the parser
+static void reset_parser(Parser* parser) {
+    release_units(parser);
+    parser->pending_count = 0;
+    symtable_destroy(parser->ctx.symbols);
+    parser->ctx.symbols = symtable_create();
+    free(parser->ctx.current_function);
+    free(parser->ctx.current_record);
+    parser->ctx.current_function = NULL;
+    parser->ctx.current_record = NULL;
+    parser->ctx.is_function = false;
+    parser->ctx.in_loop = false;
+    parser->ctx.statement_depth = 0;
+    parser->ctx.statement_errors = 0;
+    parser->ctx.sync = SYNC_TOP_LEVEL;
+    parser->ctx.error_count = 0;
+    parser->recovery = (RecoveryStats){0};
+    parser->had_error = false;
+    parser->panic_mode = false;
+    ast_arena_release(&parser->ast);
+    ast_arena_init(&parser->ast);
+    free(parser->lazy);
+    parser->lazy = NULL;
+    parser->lazy_count = 0;
+    parser->ctx.buffer.position = 0;
+    sync_token_window(parser);
+}
+
+// Debug tracing and verbose output follow one parse in order, and lexical
+// errors have to come out between the parse errors. Skipped bodies are
+// expanded from the parser's own token buffer.
+static bool can_parse_in_parallel(const Parser* parser) {
+    const Lexer* lexer = parser->ctx.lexer;
+    return g_config.jobs > 1 && !g_config.enable_verbose && !parser->lazy_bodies &&
+           !DEBUG_ENABLED(DEBUG_PARSER | DEBUG_AST | DEBUG_SYMBOLS) &&
+           parser->ctx.buffer.position == 0 &&
+           lexer && lexer->lexed && lexer->diagnostic_count == 0;
+}
+
+// The program, or NULL with the parser reset if it has to be parsed in order
+static ASTNode* parse_in_parallel(Parser* parser) {
+    TokenBuffer* buffer = &parser->ctx.buffer;
+    token_buffer_fill(parser, SIZE_MAX);
+    size_t count = 0;
+    ParseUnit* units = scan_units(buffer, &count);
+    if (count < 2) {
+        free(units);
+        return NULL;
+    }
+    parser->units = units;
+    parser->unit_count = count;
+    ast_register_file(buffer->tokens[0]->loc.filename);
+
+    AstArena* previous = ast_use_arena(&parser->ast);
+    ASTNode* root = ast_create_node(NODE_PROGRAM);
+    GlobalDeclaration* globals = NULL;
+    size_t global_count = 0;
+    size_t global_capacity = 0;
+    bool ok = root != NULL;
+
+    // The rest of the top level, in order
+    error_mute();
+    parser->defer_calls = true;
+    size_t next = 0;
+    while (ok && parser->ctx.current->type != TOK_EOF) {
+        if (next < count && buffer->position == units[next].begin) {
+            ok = prepare_unit(parser, &units[next]);
+            buffer->position = units[next++].end;
+            sync_token_window(parser);
+            continue;
+        }
+        // As parser_parse() does it
+        ASTNode* decl = parse_declaration(parser);
+        if (!decl && !parser->panic_mode) {
+            parser_sync_to_next_statement(parser);
+        }
+        ok = next == count || buffer->position <= units[next].begin;
+        if (!decl) continue;
+        if (ok && global_count == global_capacity) {
+            global_capacity = global_capacity ? global_capacity * 2 : 16;
+            GlobalDeclaration* grown = (GlobalDeclaration*)realloc(globals, global_capacity * sizeof(GlobalDeclaration));
+            ok = grown != NULL;
+            if (grown) globals = grown;
+        }
+        if (ok) globals[global_count++] = (GlobalDeclaration){decl, next, parser->pending_count};
+    }
+    ok = error_unmute() == 0 && ok && next == count;
+    parser->defer_calls = false;
+    ast_use_arena(previous);
+
+    if (ok) parse_units(units, count, g_config.jobs);
+
+    // Merges resolve their calls into the parser's now empty list
+    ASTNode** calls = parser->pending_calls;
+    parser->pending_calls = NULL;
+    parser->pending_count = 0;
+    parser->pending_capacity = 0;
+    size_t unit = 0;
+    size_t call = 0;
+    for (size_t i = 0; ok && i <= global_count; i++) {
+        size_t before = i < global_count ? globals[i].units_before : count;
+        while (ok && unit < before) {
+            ok = merge_unit(parser, root, &units[unit++]);
+        }
+        if (!ok || i == global_count) continue;
+        for (; call < globals[i].calls_end; call++) {
+            resolve_call(parser, calls[call]);
+        }
+        ast_add_child(root, globals[i].node);
+    }
+    free(calls);
+    free(globals);
+    if (ok) {
+        resolve_forward_calls(parser);
+        return root;
+    }
+
+    reset_parser(parser);
+    return NULL;
+}
+
+AstStats parser_ast_stats(const Parser* parser) {
+    AstStats stats = ast_arena_stats(&parser->ast);
+    for (size_t i = 0; i < parser->unit_count; i++) {
+        if (!parser->units[i].ready) continue;
+        AstStats unit = ast_arena_stats(&parser->units[i].parser.ast);
+        stats.nodes += unit.nodes;
+        stats.node_bytes += unit.node_bytes;
+        stats.child_bytes += unit.child_bytes;
+        stats.side_bytes += unit.side_bytes;
+        stats.bounds_bytes += unit.bounds_bytes;
+        stats.string_bytes += unit.string_bytes;
+    }
+    return stats;
+}
+
 // Main parsing functions
 ASTNode* parser_parse(Parser* parser) {
+    if (can_parse_in_parallel(parser)) {
+        ASTNode* root = parse_in_parallel(parser);
+        if (root) return root;
+    }
+
+    AstArena* previous = ast_use_arena(&parser->ast);
     verbose_print("Creating program node...\n");
     ASTNode* root = ast_create_node(NODE_PROGRAM);
     if (!root) {
         verbose_print("Failed to create program node\n");
+        ast_use_arena(previous);
         return NULL;
     }
 
@@ -421,9 +958,193 @@ ASTNode* parser_parse(Parser* parser) {
         }
     }
 
+    resolve_forward_calls(parser);
+    ast_use_arena(previous);
     return root;
 }
 
+ASTNode* parser_parse_next(Parser* parser) {
+    while (parser->ctx.current->type != TOK_EOF) {
+        // Globals stay, so later functions can still use their types and bounds
+        TokenType type = parser->ctx.current->type;
+        bool global = type == TOK_VAR || type == TOK_TYPE;
+        AstArena* previous = ast_use_arena(global ? &parser->ast : &parser->unit_ast);
+        ASTNode* decl = parse_declaration(parser);
+        if (!decl && !parser->panic_mode) {
+            parser_sync_to_next_statement(parser);
+        }
+        ast_use_arena(previous);
+        if (decl) return decl;
+    }
+    return NULL;
+}
+
+// Drops the buffered tokens before the previous one, and lets the lexer
+// free the ones from before its last release once none are buffered
+static void release_tokens(Parser* parser) {
+    TokenBuffer* buffer = &parser->ctx.buffer;
+    size_t drop = buffer->position > 0 ? buffer->position - 1 : 0;
+    if (drop > 0) {
+        memmove(buffer->tokens, buffer->tokens + drop, (buffer->count - drop) * sizeof(Token*));
+        buffer->count -= drop;
+        buffer->position -= drop;
+        parser->token_mark = parser->token_mark > drop ? parser->token_mark - drop : 0;
+    }
+    if (parser->token_mark == 0 && lexer_release_tokens(parser->ctx.lexer)) {
+        parser->token_mark = buffer->count;
+    }
+}
+
+void parser_release_unit(Parser* parser, ASTNode* unit) {
+    const char* name = NULL;
+    if (unit && (unit->type == NODE_FUNCTION || unit->type == NODE_PROCEDURE)) {
+        name = unit->data.function.name;
+    }
+    symtable_release_function(parser->ctx.symbols, name);
+    parser->pending_count = 0;  // Its calls are generated already
+    ast_arena_release(&parser->unit_ast);
+    ast_arena_init(&parser->unit_ast);
+    release_tokens(parser);
+}
+
+// Function bodies
+// Variable declarations up to and including 'begin'. They can give the
+// parameters their types, so they count as part of the signature. NULL if
+// 'begin' is missing.
+static ASTNode* parse_body_declarations(Parser* parser, const char* begin_message) {
+    ASTNode* body = ast_create_node(NODE_BLOCK);
+    if (!body) return NULL;
+    ast_set_location(body, parser->ctx.current->loc);
+
+    // Parse variable declarations until we see 'begin'
+    while (check(parser, TOK_VAR)) {
+        ASTNode* var_decl = parse_variable_declaration(parser);
+        if (var_decl) {
+            ast_add_child(body, var_decl);
+        }
+    }
+
+    // Expect 'begin'
+    if (!match(parser, TOK_BEGIN)) {
+        parser_error(parser, begin_message);
+        return NULL;
+    }
+    return body;
+}
+
+// Statements up to the 'end' closing the body, which is left current
+static void parse_body_statements(Parser* parser, ASTNode* body) {
+    while (!check(parser, TOK_END) && !check(parser, TOK_EOF)) {
+        size_t start = parser->ctx.buffer.position;
+        ASTNode* statement = parse_statement(parser);
+        if (statement) {
+            ast_add_child(body, statement);
+        } else if (!resume_statements(parser, start)) {
+            parser_sync_to_next_statement(parser);
+        }
+    }
+}
+
+typedef struct LazyBody {
+    ASTNode* function;          // NULL once expanded
+    Scope* scope;               // The function's scope, holding its parameters
+    size_t begin;               // First token after 'begin'
+    size_t end;                 // The 'end' closing the body
+    bool is_function;
+} LazyBody;
+
+// In a signature-only parse, remembers the statements of function's body
+// and skips to the 'end' closing it. Nested blocks and records are counted,
+// and the closing tokens have to be followed by the next declaration, as in
+// unit_end(). A body whose end can't be found this way is parsed as usual.
+static bool skip_body(Parser* parser, ASTNode* function) {
+    if (!parser->lazy_bodies) return false;
+    TokenBuffer* buffer = &parser->ctx.buffer;
+    const char* name = function->data.function.name;
+    size_t end = 0;
+    size_t depth = 0;
+    for (size_t i = buffer->position; !end && token_buffer_fill(parser, i + 1); i++) {
+        TokenType type = buffer->tokens[i]->type;
+        if (type == TOK_FUNCTION || type == TOK_PROCEDURE || type == TOK_EOF) return false;
+        if (type == TOK_BEGIN || type == TOK_RECORD) depth++;
+        if (type != TOK_END) continue;
+        if (depth > 0) {
+            depth--;
+            continue;
+        }
+        token_buffer_fill(parser, i + 4);
+        size_t close = unit_close(buffer->tokens, buffer->count, i, name);
+        if (!close || close >= buffer->count || !is_unit_follower(buffer->tokens[close]->type)) {
+            return false;
+        }
+        end = i;
+    }
+    if (!end) return false;
+
+    if (parser->lazy_count % 64 == 0) {
+        LazyBody* grown = (LazyBody*)realloc(parser->lazy, (parser->lazy_count + 64) * sizeof(LazyBody));
+        if (!grown) return false;
+        parser->lazy = grown;
+    }
+    parser->lazy[parser->lazy_count++] = (LazyBody){
+        function, parser->ctx.symbols->current, buffer->position, end, parser->ctx.is_function
+    };
+    buffer->position = end;
+    sync_token_window(parser);
+    return true;
+}
+
+static bool expand_body(Parser* parser, LazyBody* lazy) {
+    ASTNode* function = lazy->function;
+    lazy->function = NULL;
+    TokenBuffer* buffer = &parser->ctx.buffer;
+    size_t position = buffer->position;
+    char* current_function = parser->ctx.current_function;
+    bool is_function = parser->ctx.is_function;
+    int errors = error_count();
+
+    AstArena* previous = ast_use_arena(&parser->ast);
+    symtable_resume_scope(parser->ctx.symbols, lazy->scope);
+    parser->ctx.current_function = strdup(function->data.function.name);
+    parser->ctx.is_function = lazy->is_function;
+    buffer->position = lazy->begin;
+    sync_token_window(parser);
+
+    unsigned sync = parser->ctx.sync;
+    parser->ctx.sync = SYNC_BODY;
+    parse_body_statements(parser, function->data.function.body);
+    parser->ctx.sync = sync;
+    if (buffer->position != lazy->end) {
+        parser_error(parser, "Unexpected 'end' in function body");
+    }
+
+    symtable_exit_scope(parser->ctx.symbols);
+    parser->pending_count = 0;  // Every function is declared by now
+    free(parser->ctx.current_function);
+    parser->ctx.current_function = current_function;
+    parser->ctx.is_function = is_function;
+    parser->panic_mode = false;
+    buffer->position = position;
+    sync_token_window(parser);
+    ast_use_arena(previous);
+    return error_count() == errors;
+}
+
+bool parser_expand_body(Parser* parser, ASTNode* function) {
+    for (size_t i = 0; i < parser->lazy_count; i++) {
+        if (parser->lazy[i].function == function) return expand_body(parser, &parser->lazy[i]);
+    }
+    return true;
+}
+
+bool parser_expand_bodies(Parser* parser) {
+    bool ok = true;
+    for (size_t i = 0; i < parser->lazy_count; i++) {
+        if (parser->lazy[i].function && !expand_body(parser, &parser->lazy[i])) ok = false;
+    }
+    return ok;
+}
+
 static ASTNode* parse_typed_function_declaration(Parser* parser, ASTNode* type, int type_pointer_level) {
     debug_parser_rule_start(parser, "parse_typed_function_declaration");
     verbose_print("Parsing function declaration with preceding type\n");
@@ -446,8 +1167,10 @@ static ASTNode* parse_typed_function_declaration(Parser* parser, ASTNode* type,
     Symbol* func_sym = symtable_add_function(parser->ctx.symbols, name->value, type->data.value, false);
     verbose_print("\nCreated function symbol: %s\n", name->value);
 
-    func_sym->info.func.is_pointer = type_pointer_level > 0;
-    func_sym->info.func.pointer_level = type_pointer_level;
+    if (func_sym) {
+        func_sym->info.func.is_pointer = type_pointer_level > 0;
+        func_sym->info.func.pointer_level = type_pointer_level;
+    }
     
     // Enter new scope for function
     debug_parser_scope_enter(parser, "Function");
@@ -479,37 +1202,17 @@ static ASTNode* parse_typed_function_declaration(Parser* parser, ASTNode* type,
         return func;
     }
 
-    // Create a block node for the function body
+    // Function body; a signature-only parse skips its statements
     debug_parser_state(parser, "Before function body");
-    ASTNode* body = ast_create_node(NODE_BLOCK);
+    ASTNode* body = parse_body_declarations(parser, "Expected 'begin' in function body");
     if (!body) {
         ast_destroy_node(func);
         return NULL;
     }
-    ast_set_location(body, parser->ctx.current->loc);
-    // Parse variable declarations until we see 'begin'
-    while (check(parser, TOK_VAR)) {
-        ASTNode* var_decl = parse_variable_declaration(parser);
-        if (var_decl) {
-            ast_add_child(body, var_decl);
-        }
-    }
-
-    // Expect 'begin'
-    if (!match(parser, TOK_BEGIN)) {
-        parser_error(parser, "Expected 'begin' in function body");
-        ast_destroy_node(func);
-        return NULL;
-    }
-
-    // Parse statements until 'end'
-    while (!check(parser, TOK_END) && !check(parser, TOK_EOF)) {
-        ASTNode* statement = parse_statement(parser);
-        if (statement) {
-            ast_add_child(body, statement);
-        } else if (!parser->panic_mode) {
-            parser_sync_to_next_statement(parser);
-        }
+    // Attach the body first, for parser_expand_body()
+    func->data.function.body = body;
+    if (!skip_body(parser, func)) {
+        parse_body_statements(parser, body);
     }
 
     // Expect 'end'
@@ -519,9 +1222,6 @@ static ASTNode* parse_typed_function_declaration(Parser* parser, ASTNode* type,
         return NULL;
     }
 
-    // Attach the body to the function
-    func->data.function.body = body;
-
     // Expect 'endfunction'
     if (!match(parser, TOK_ENDFUNCTION)) {
         parser_error(parser, "Expected 'endfunction'");
@@ -540,8 +1240,30 @@ static ASTNode* parse_typed_function_declaration(Parser* parser, ASTNode* type,
     return func;
 }
 
+static void end_routine(Parser* parser, unsigned sync, Scope* scope) {
+    parser->ctx.sync = sync;
+    symtable_exit_to_scope(parser->ctx.symbols, scope);
+}
+
 static ASTNode* parse_declaration(Parser* parser) {
     verbose_print("In parse_declaration, token type: %d\n", parser->ctx.current->type);
+
+    // Still recovering from an error in the declaration before: skip to
+    // the next one without reporting what comes first
+    TokenType first = parser->ctx.current->type;
+    if (parser->panic_mode && !is_type_keyword(first) && !sync_classes(first, SYNC_DECLARATION)) {
+        synchronize(parser);
+        return NULL;
+    }
+
+    // A new declaration ends any recovery
+    parser->panic_mode = false;
+    if (parser->ctx.statement_depth == 0) parser->ctx.statement_errors = 0;
+    // Functions and procedures recover at the statements in their bodies,
+    // and may return from inside their scope after an error
+    unsigned sync = parser->ctx.sync;
+    Scope* scope = parser->ctx.symbols->current;
+    ASTNode* routine;
     
     // Check for type-before-name function syntax
     if (is_type_keyword(parser->ctx.current->type)) {
@@ -550,7 +1272,10 @@ static ASTNode* parse_declaration(Parser* parser) {
         verbose_print("Found type keyword, checking for function declaration\n");
         
         if (match(parser, TOK_FUNCTION)) {
-            return parse_typed_function_declaration(parser, type, type_pointer_level);
+            parser->ctx.sync = SYNC_BODY;
+            routine = parse_typed_function_declaration(parser, type, type_pointer_level);
+            end_routine(parser, sync, scope);
+            return routine;
         } else {
             // TODO: handle global variables here
         }
@@ -559,11 +1284,17 @@ static ASTNode* parse_declaration(Parser* parser) {
     // Original function/procedure/var parsing
     if (match(parser, TOK_FUNCTION)) {
         verbose_print("Parsing function declaration\n");
-        return parse_function_declaration(parser);
+        parser->ctx.sync = SYNC_BODY;
+        routine = parse_function_declaration(parser);
+        end_routine(parser, sync, scope);
+        return routine;
     }
     if (match(parser, TOK_PROCEDURE)) {
         verbose_print("Parsing procedure declaration\n");
-        return parse_procedure_declaration(parser);
+        parser->ctx.sync = SYNC_BODY;
+        routine = parse_procedure_declaration(parser);
+        end_routine(parser, sync, scope);
+        return routine;
     }
     if (match(parser, TOK_VAR)) {
         match(parser, TOK_COLON);
@@ -603,6 +1334,7 @@ static ASTNode* parse_identifier(Parser* parser) {
         return NULL;
     }
     ast_set_location(base, name->loc);
+    base->data.variable.symbol = symbol;
 
     // Handle array access - either with [] or with () if enabled
     if (check(parser, TOK_LBRACKET) || 
@@ -712,10 +1444,10 @@ static ASTNode* parse_variable(Parser* parser) {
     if (ast_is_node_type(var, NODE_VARIABLE) || ast_is_node_type(var, NODE_IDENTIFIER)) {
         verbose_print("Checking for array access\n");
         debug_print_token_info(parser->ctx.current, "Current token before array access check");
-        Symbol* sym = symtable_lookup_parameter(parser->ctx.symbols, parser->ctx.current_function, var->type == NODE_VARIABLE ? var->data.variable.name : var->data.value);
-        if (!sym)
-            sym = symtable_lookup(parser->ctx.symbols, var->type == NODE_VARIABLE ? var->data.variable.name : var->data.value);
-        if (check(parser, TOK_LBRACKET) || (check(parser, TOK_LPAREN) && g_config.allow_mixed_array_access && sym && sym->info.var.is_array)) {
+        Symbol* sym = ast_symbol(var);
+        if (check(parser, TOK_LBRACKET) ||
+            (check(parser, TOK_LPAREN) && g_config.allow_mixed_array_access &&
+             sym && (sym->kind == SYMBOL_VARIABLE || sym->kind == SYMBOL_PARAMETER) && sym->info.var.is_array)) {
             verbose_print("Found array access operator\n");
             return parse_array_access(parser, var);
         }
@@ -791,48 +1523,30 @@ static ASTNode* parse_function_declaration(Parser* parser) {
         int pointer_level = 0;
         ASTNode* return_type = parse_type_specifier(parser, &pointer_level);
         if (return_type) {
-            func->data.function.return_type = strdup(return_type->data.value);
+            func->data.function.return_type = ast_strdup(return_type->data.value);
             func->data.function.is_pointer = pointer_level > 0;
             func->data.function.pointer_level = pointer_level;
             ast_destroy_node(return_type);
 
-            func_sym->info.func.is_pointer = pointer_level > 0;
-            func_sym->info.func.pointer_level = pointer_level;
+            // NULL for a name that is already declared
+            if (func_sym) {
+                func_sym->info.func.is_pointer = pointer_level > 0;
+                func_sym->info.func.pointer_level = pointer_level;
+            }
         }
     }
 
-    // Create a block node for the procedure body
+    // Function body; a signature-only parse skips its statements
     debug_parser_state(parser, "Before function body");
-    ASTNode* body = ast_create_node(NODE_BLOCK);
+    ASTNode* body = parse_body_declarations(parser, "Expected 'begin' in procedure body");
     if (!body) {
         ast_destroy_node(func);
         return NULL;
     }
-    ast_set_location(body, parser->ctx.current->loc);
-    
-    // Parse variable declarations until we see 'begin'
-    while (check(parser, TOK_VAR)) {
-        ASTNode* var_decl = parse_variable_declaration(parser);
-        if (var_decl) {
-            ast_add_child(body, var_decl);
-        }
-    }
-
-    // Expect 'begin'
-    if (!match(parser, TOK_BEGIN)) {
-        parser_error(parser, "Expected 'begin' in procedure body");
-        ast_destroy_node(func);
-        return NULL;
-    }
-
-    // Parse statements until 'end'
-    while (!check(parser, TOK_END) && !check(parser, TOK_EOF)) {
-        ASTNode* statement = parse_statement(parser);
-        if (statement) {
-            ast_add_child(body, statement);
-        } else if (!parser->panic_mode) {
-            parser_sync_to_next_statement(parser);
-        }
+    // Attach the body first, for parser_expand_body()
+    func->data.function.body = body;
+    if (!skip_body(parser, func)) {
+        parse_body_statements(parser, body);
     }
 
     // Expect 'end'
@@ -842,9 +1556,6 @@ static ASTNode* parse_function_declaration(Parser* parser) {
         return NULL;
     }
 
-    // Attach the body to the procedure
-    func->data.function.body = body;
-
     if (match(parser, TOK_END)) {
         // Check for function name
         Token* end_name = consume(parser, TOK_IDENTIFIER, "Expected function name after end");
@@ -923,38 +1634,17 @@ static ASTNode* parse_procedure_declaration(Parser* parser) {
     verbose_print("\nAfter parsing parameters:\n");
     symtable_debug_dump_all(parser->ctx.symbols);
 
-    // Create a block node for the procedure body
+    // Procedure body; a signature-only parse skips its statements
     debug_parser_state(parser, "Before procedure body");
-    ASTNode* body = ast_create_node(NODE_BLOCK);
+    ASTNode* body = parse_body_declarations(parser, "Expected 'begin' in procedure body");
     if (!body) {
         ast_destroy_node(proc);
         return NULL;
     }
-    ast_set_location(body, parser->ctx.current->loc);
-
-    // Parse variable declarations until we see 'begin'
-    while (check(parser, TOK_VAR)) {
-        ASTNode* var_decl = parse_variable_declaration(parser);
-        if (var_decl) {
-            ast_add_child(body, var_decl);
-        }
-    }
-
-    // Expect 'begin'
-    if (!match(parser, TOK_BEGIN)) {
-        parser_error(parser, "Expected 'begin' in procedure body");
-        ast_destroy_node(proc);
-        return NULL;
-    }
-
-    // Parse statements until 'end'
-    while (!check(parser, TOK_END) && !check(parser, TOK_EOF)) {
-        ASTNode* statement = parse_statement(parser);
-        if (statement) {
-            ast_add_child(body, statement);
-        } else if (!parser->panic_mode) {
-            parser_sync_to_next_statement(parser);
-        }
+    // Attach the body first, for parser_expand_body()
+    proc->data.function.body = body;
+    if (!skip_body(parser, proc)) {
+        parse_body_statements(parser, body);
     }
 
     // Expect 'end'
@@ -964,9 +1654,6 @@ static ASTNode* parse_procedure_declaration(Parser* parser) {
         return NULL;
     }
 
-    // Attach the body to the procedure
-    proc->data.function.body = body;
-
     // Expect 'endprocedure'
     if (match(parser, TOK_END)) {
         // Check for procedure name
@@ -1136,6 +1823,11 @@ static ArrayBoundsData* parse_paren_array_bounds_for_all_dimensions(Parser* pars
     return bounds;
 }
 
+// A constant bound's value, truncating a real
+static long number_literal_as_long(const NumberLiteral* number) {
+    return number->kind == NUMBER_REAL ? (long)number->real : (long)number->integer;
+}
+
 // Helper function to parse bounds for a single dimension
 static bool parse_dimension_bounds(Parser* parser, DimensionBounds* bounds) {
     verbose_print("Parsing single dimension bounds\n");
@@ -1149,7 +1841,7 @@ static bool parse_dimension_bounds(Parser* parser, DimensionBounds* bounds) {
     // Convert expression to bounds data
     if (start_expr->type == NODE_NUMBER) {
         bounds->start.is_constant = true;
-        bounds->start.constant_value = atol(start_expr->data.value);
+        bounds->start.constant_value = number_literal_as_long(&start_expr->data.number.literal);
     } else {
         bounds->start.is_constant = false;
         bounds->start.variable_name = ast_to_string(start_expr);
@@ -1169,7 +1861,7 @@ static bool parse_dimension_bounds(Parser* parser, DimensionBounds* bounds) {
 
         if (end_expr->type == NODE_NUMBER) {
             bounds->end.is_constant = true;
-            bounds->end.constant_value = atol(end_expr->data.value);
+            bounds->end.constant_value = number_literal_as_long(&end_expr->data.number.literal);
         } else {
             bounds->end.is_constant = false;
             bounds->end.variable_name = ast_to_string(end_expr);
@@ -1233,145 +1925,68 @@ static ASTNode* parse_array_bounds_node(Parser* parser) {
         return NULL;
     }
 
-    // Store bounds data in the node
-    bounds_node->array_bounds = *bounds_data;
-    free(bounds_data); // Free the temporary structure since we copied its contents
+    // The node's side table takes the bounds over
+    if (!ast_set_array_bounds(bounds_node, bounds_data)) {
+        symtable_destroy_bounds(bounds_data);
+        return NULL;
+    }
 
     return bounds_node;
 }
 
-static int count_comma_array_dimensions_ahead(Lexer* lexer, size_t var_start, bool use_paren) {
-    const char* source = lexer->source;
-    size_t pos = var_start;
-    char open = use_paren ? '(' : '[';
-    char close = use_paren ? ')' : ']';
-    // Find first '['
-    while (source[pos] && source[pos] != open) {
-        pos++;
-    }
-    
-    if (!source[pos]) {
-        return 0;
-    }
-    
-    size_t start_pos = pos;
-    
-    // Find end (colon)
-    size_t end_pos = start_pos;
-    while (source[end_pos] && source[end_pos] != close) {
-        end_pos++;
-    }
-    
-    int dimensions = 0;
-    int nesting = 0;
-    pos = start_pos;
-    
-    while (pos < end_pos && source[pos]) {
-        char c = source[pos];
-        
-        if (c == ',') {
-            if (dimensions)
-                dimensions++;
-            else 
-                dimensions = 2;
-        }
-        pos++;
-    }
-    return dimensions;
+// Index of the first buffered token at or after offset. Buffered tokens
+// are in source order.
+static size_t buffered_token_at(Parser* parser, size_t offset) {
+    TokenBuffer* buffer = &parser->ctx.buffer;
+    size_t low = 0, high = buffer->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (buffer->tokens[mid]->offset < offset) low = mid + 1;
+        else high = mid;
+    }
+    return low;
 }
 
-static int count_array_dimensions_ahead(Lexer* lexer, size_t var_start, bool use_paren) {
-    const char* source = lexer->source;
-    size_t pos = var_start;
-    
-    char open = use_paren ? '(' : '[';
-    char close = use_paren ? ')' : ']';
-    // Find first '['
-    while (source[pos] && source[pos] != open) {
-        pos++;
-    }
-    
-    if (!source[pos]) {
-        return 0;
-    }
-    
-    size_t start_pos = pos;
-    
-    // Find end (colon)
-    size_t end_pos = start_pos;
-    bool currently_closed = false;
-    while (source[end_pos] && 
-          (source[end_pos] != ':' && 
-          (source[end_pos] != ',' || !currently_closed))) {
-        if (source[end_pos] == close)
-            currently_closed = true;
-        else if (source[end_pos] == open)
-            currently_closed = false;
-        end_pos++;
-    }
-    
-    int dimensions = 0;
-    int nesting = 0;
-    pos = start_pos;
-    
-    while (pos < end_pos && source[pos]) {
-        char c = source[pos];
-        
-        if (c == open) {
-            if (nesting == 0) {
-                // Found start of a new dimension
-                dimensions++;
-            }
-            nesting++;
-        } else if (c == close) {
-            nesting--;
-        }
-        pos++;
+// Id of the first ( or [ pair at or after offset, without leaving the
+// current declaration
+static uint32_t find_bracket_ahead(Parser* parser, size_t offset, bool use_paren) {
+    TokenBuffer* buffer = &parser->ctx.buffer;
+    TokenType open = use_paren ? TOK_LPAREN : TOK_LBRACKET;
+    for (size_t index = buffered_token_at(parser, offset);; index++) {
+        if (!token_buffer_fill(parser, index)) return 0;
+        Token* token = buffer->tokens[index];
+        if (token->type == open) return token->bracket;
+        if (token->type == TOK_EOF || token->type == TOK_SEMICOLON) return 0;
     }
-    return dimensions;
 }
 
-static int count_array_type_dimensions_ahead(Lexer* lexer, size_t var_start, bool use_paren) {
-    const char* source = lexer->source;
-    size_t pos = var_start;
-    
-    
-    char open = use_paren ? '(' : '[';
-    char close = use_paren ? ')' : ']';
-    // Find first '['
-    while (source[pos] && source[pos] != open) {
-        pos++;
-    }
-    
-    if (!source[pos]) {
-        return 0;
-    }
-    
-    size_t start_pos = pos;
-    
-    // Find end (colon)
-    size_t end_pos = start_pos;
-    while (source[end_pos] && source[end_pos] != 'o' && source[end_pos + 1] != 'f' && source[end_pos + 2] != ' ') {
-        end_pos++;
+// Bracket info once the pair and the token after it have been lexed
+static const BracketInfo* resolve_bracket(Parser* parser, uint32_t id) {
+    const BracketInfo* info = lexer_bracket_info(parser->ctx.lexer, id);
+    size_t k = 0;
+    while (info && !info->next_known) {
+        if (parser_peek_n(parser, k++)->type == TOK_EOF) break;
+        info = lexer_bracket_info(parser->ctx.lexer, id);  // Table may have moved
     }
-    
+    return info;
+}
+
+// Dimensions written as [a, b, c]: commas + 1, or 0 without commas
+static int count_comma_array_dimensions_ahead(Parser* parser, size_t var_start, bool use_paren) {
+    const BracketInfo* info = resolve_bracket(parser, find_bracket_ahead(parser, var_start, use_paren));
+    if (!info || info->commas == 0) return 0;
+    return (int)info->commas + 1;
+}
+
+// Dimensions written as [a][b][c]: consecutive bracket groups
+static int count_array_dimensions_ahead(Parser* parser, size_t var_start, bool use_paren) {
     int dimensions = 0;
-    int nesting = 0;
-    pos = start_pos;
-    
-    while (pos < end_pos && source[pos]) {
-        char c = source[pos];
-        
-        if (c == open) {
-            if (nesting == 0) {
-                // Found start of a new dimension
-                dimensions++;
-            }
-            nesting++;
-        } else if (c == close) {
-            nesting--;
-        }
-        pos++;
+    uint32_t id = find_bracket_ahead(parser, var_start, use_paren);
+    while (id) {
+        const BracketInfo* info = resolve_bracket(parser, id);
+        if (!info) break;
+        dimensions++;
+        id = info->next;
     }
     return dimensions;
 }
@@ -1399,7 +2014,7 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
             advance(parser);  // Consume the * token
         }
 
-        size_t var_start = parser->ctx.lexer->start;
+        size_t var_start = parser->ctx.peek->offset;
         Token* name = consume(parser, TOK_IDENTIFIER, "Expected variable name");
         if (!name) {
             ast_destroy_node(declarations);
@@ -1457,10 +2072,10 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
         if (match(parser, TOK_LBRACKET)) {
             is_array_decl = true;
             // Here we need to check all commas within the brackets
-            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, false)) {
+            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser, var_start, false)) {
                 int dimension_count = 1;
                 TokenType lookahead_type = parser->ctx.peek->type;
-                dimension_count = count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, false);
+                dimension_count = count_comma_array_dimensions_ahead(parser, var_start, false);
                 
                 // Create bounds for all dimensions
                 var_bounds = symtable_create_bounds(dimension_count);
@@ -1494,7 +2109,7 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
                 total_dimensions = dimension_count;
             } else {
                 // Count dimensions
-                total_dimensions = count_array_dimensions_ahead(parser->ctx.lexer, var_start, false);
+                total_dimensions = count_array_dimensions_ahead(parser, var_start, false);
 
                 if (total_dimensions <= 0) {
                     ast_destroy_node(declarations);
@@ -1510,10 +2125,10 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
         } else if (g_config.allow_mixed_array_access && match(parser, TOK_LPAREN)) {
             is_array_decl = true;
             // Here we need to check all commas within the parentheses
-            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, true)) {
+            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser, var_start, true)) {
                 int dimension_count = 1;
                 TokenType lookahead_type = parser->ctx.peek->type;
-                dimension_count = count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, true);
+                dimension_count = count_comma_array_dimensions_ahead(parser, var_start, true);
                 
                 // Create bounds for all dimensions
                 var_bounds = symtable_create_bounds(dimension_count);
@@ -1547,7 +2162,7 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
                 total_dimensions = dimension_count;
             } else {
                 // Count dimensions
-                total_dimensions = count_array_dimensions_ahead(parser->ctx.lexer, var_start, true);
+                total_dimensions = count_array_dimensions_ahead(parser, var_start, true);
                 if (total_dimensions <= 0) {
                     ast_destroy_node(declarations);
                     return NULL;
@@ -1570,13 +2185,13 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
         ast_set_location(var, name->loc);
 
 
-        var->data.variable.name = strdup(name->value);
+        var->data.variable.name = ast_strdup(name->value);
         var->data.variable.is_array = (is_array_decl || var_bounds != NULL);
         var->data.variable.is_pointer = pointer_level > 0;
         var->data.variable.pointer_level = pointer_level;
 
         if (var_bounds) {
-            var->data.variable.array_info.bounds = var_bounds;
+            if (!ast_set_array_bounds(var, var_bounds)) symtable_destroy_bounds(var_bounds);
             var->data.variable.array_info.dimensions = total_dimensions;
             var->data.variable.array_info.has_dynamic_size = false;
             
@@ -1617,7 +2232,7 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
     ArrayBoundsData* type_bounds = NULL;
     int type_dimensions = 0;
 
-    size_t var_start = parser->ctx.lexer->start;
+    size_t var_start = parser->ctx.peek->offset;
     // Check for dimensional specifier (e.g., "2d array")
     if (parser->ctx.current->type == TOK_IDENTIFIER) {
         // here we need to make sure the dimension is either specified with d (5d) or implicit (check for number of bracket pairs or number of commas [,,,,] or [][][][][])
@@ -1627,18 +2242,18 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
     } else if (parser->ctx.current->type == TOK_ARRAY) {
         if (parser->ctx.peek->type == TOK_LBRACKET) {
             // we founds bounds, so we are in the implicit case: if is comma parse commas else count brackets
-            type_dimensions = count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, false);
+            type_dimensions = count_comma_array_dimensions_ahead(parser, var_start, false);
             if (type_dimensions == 1) { // we found no commas
                 // check brackets
-                type_dimensions = count_array_type_dimensions_ahead(parser->ctx.lexer, var_start, false);
+                type_dimensions = count_array_dimensions_ahead(parser, var_start, false);
                 if (type_dimensions < 1)
                     type_dimensions = 1;
             }
         } else if (g_config.allow_mixed_array_access && parser->ctx.peek->type == TOK_LPAREN) {
-            type_dimensions = count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, true);
+            type_dimensions = count_comma_array_dimensions_ahead(parser, var_start, true);
             if (type_dimensions == 1) { // we found no commas
                 // check brackets
-                type_dimensions = count_array_type_dimensions_ahead(parser->ctx.lexer, var_start, true);
+                type_dimensions = count_array_dimensions_ahead(parser, var_start, true);
                 if (type_dimensions < 1)
                     type_dimensions = 1;
             }
@@ -1658,10 +2273,10 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
 
         if (match(parser, TOK_LBRACKET)) {
             // check if is comma
-            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, false)) {
+            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser, var_start, false)) {
                 //int dimension_count = 1;
                 //TokenType lookahead_type = parser->ctx.peek->type;
-                //dimension_count = count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start);
+                //dimension_count = count_comma_array_dimensions_ahead(parser, var_start);
                 
                 // Create bounds for all dimensions
                 type_bounds = symtable_create_bounds(type_dimensions);
@@ -1707,10 +2322,10 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
                 return NULL;
             }
         } else if (g_config.allow_mixed_array_access && match(parser, TOK_LPAREN)) {
-            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, true)) {
+            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser, var_start, true)) {
                 //int dimension_count = 1;
                 //TokenType lookahead_type = parser->ctx.peek->type;
-                //dimension_count = count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start);
+                //dimension_count = count_comma_array_dimensions_ahead(parser, var_start);
                 
                 // Create bounds for all dimensions
                 type_bounds = symtable_create_bounds(type_dimensions);
@@ -1795,14 +2410,15 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
             return NULL;
         }
         // Set record name if not already set
-        //if (!record_type->record_type.name) {
-        record_type->record_type.name = strdup(declarations->children[0]->data.variable.name);
+        RecordTypeData* record_data = ast_record_type(record_type);
+        //if (!record_data->name) {
+        record_data->name = ast_strdup(declarations->children[0]->data.variable.name);
         //}
         ast_add_child(declarations->children[0], record_type);
         
         // Create and register type symbol
         Symbol* type_sym = symtable_add_type(parser->ctx.symbols, 
-                                            record_type->record_type.name,
+                                            record_data->name,
                                             record_type);
         if (!type_sym) {
             parser_error(parser, "Failed to register record type");
@@ -1857,14 +2473,16 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
 
         
             
-        var_node->data.variable.type = full_type;
+        var_node->data.variable.type = ast_strdup(full_type);
+        free(full_type);
         var_node->data.variable.is_pointer = var_node->data.variable.is_pointer || type_pointer_level > 0;
         var_node->data.variable.pointer_level = var_node->data.variable.pointer_level + type_pointer_level;
 
         // If no bounds were specified with name but we have array type with bounds
         if (is_array && !var_node->data.variable.is_array && type_bounds) {
             var_node->data.variable.is_array = true;
-            var_node->data.variable.array_info.bounds = symtable_clone_bounds(type_bounds);
+            ArrayBoundsData* bounds = symtable_clone_bounds(type_bounds);
+            if (bounds && !ast_set_array_bounds(var_node, bounds)) symtable_destroy_bounds(bounds);
             var_node->data.variable.array_info.dimensions = type_bounds->dimensions;
             var_node->data.variable.array_info.has_dynamic_size = false;
             
@@ -1881,14 +2499,13 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
 
         // Add to symbol table
         Symbol* sym = NULL;
+        ArrayBoundsData* var_bounds = ast_array_bounds(var_node);
         if (var_node->data.variable.is_array) {
-            // Pass the complete bounds information
+            // Pass the complete bounds information; the symbol keeps a copy
             sym = symtable_add_array(parser->ctx.symbols, 
                                 var_node->data.variable.name,
                                 base_type->data.value,
-                                var_node->data.variable.array_info.bounds ? 
-                                symtable_clone_bounds(var_node->data.variable.array_info.bounds) :
-                                (type_bounds ? symtable_clone_bounds(type_bounds) : NULL));
+                                var_bounds ? var_bounds : type_bounds);
         } else {
             sym = symtable_add_variable(parser->ctx.symbols,
                                     var_node->data.variable.name,
@@ -1944,7 +2561,7 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
             param->info.var.needs_type_declaration = false;
 
             if (param->node) {
-                param->node->data.variable.type = strdup(full_type);
+                param->node->data.variable.type = ast_strdup(full_type);
                 param->node->data.parameter.is_pointer = var_node->data.variable.is_pointer || type_pointer_level > 0;
                 param->node->data.parameter.pointer_level = var_node->data.variable.pointer_level + type_pointer_level;
             }
@@ -1959,7 +2576,8 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
 
             if (is_array && !var_node->data.variable.is_array && type_bounds) {
                 var_node->data.variable.is_array = true;
-                var_node->data.variable.array_info.bounds = symtable_clone_bounds(type_bounds);
+                ArrayBoundsData* bounds = symtable_clone_bounds(type_bounds);
+                if (bounds && !ast_set_array_bounds(var_node, bounds)) symtable_destroy_bounds(bounds);
                 var_node->data.variable.array_info.dimensions = type_bounds->dimensions;
                 var_node->data.variable.array_info.has_dynamic_size = false;
                 
@@ -1990,11 +2608,12 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
                     //param->node->type = NODE_ARRAY_DECL;
                 //}
             }
-            if (is_array || type_bounds || var_node->data.variable.is_array || var_node->data.variable.array_info.bounds) 
+            ArrayBoundsData* var_bounds = ast_array_bounds(var_node);
+            if (is_array || type_bounds || var_node->data.variable.is_array || var_bounds) 
                 param->info.var.is_array = true;
-            if (is_array || type_bounds || var_node->data.variable.array_info.bounds) {
-                ArrayBoundsData* bounds = var_node->data.variable.array_info.bounds ? 
-                                    symtable_clone_bounds(var_node->data.variable.array_info.bounds) :
+            if (is_array || type_bounds || var_bounds) {
+                ArrayBoundsData* bounds = var_bounds ? 
+                                    symtable_clone_bounds(var_bounds) :
                                     (type_bounds ? symtable_clone_bounds(type_bounds) : NULL);
 
                 param->info.var.needs_deref = false;
@@ -2039,155 +2658,115 @@ static ASTNode* parse_variable_declaration(Parser* parser) {
 }
 
 
-static bool look_ahead_for_assignment(Parser* parser, int tokens_ahead) {
-    // Save current token position
-    size_t current = parser->ctx.lexer->current;
-    Token* saved_current = parser->ctx.current;
-    Token* saved_peek = parser->ctx.peek;
-    
-    bool result = false;
-    
-    // Look ahead desired number of tokens
-    for (int i = 0; i < tokens_ahead; i++) {
-        Token* next = lexer_next_token(parser->ctx.lexer);
-        if (next && next->type == TOK_ASSIGN) {
-            result = true;
-        }
-        token_destroy(next);
-    }
-    
-    // Restore parser state
-    parser->ctx.lexer->current = current;
-    parser->ctx.current = saved_current;
-    parser->ctx.peek = saved_peek;
-    
-    return result;
+// Statement kinds, decided before any statement rule runs
+typedef enum {
+    STMT_NONE,              // Not a statement start
+    STMT_ASSIGNMENT,
+    STMT_DEREF_ASSIGNMENT,  // '*'... name ':='
+    STMT_CALL,
+    STMT_IF,
+    STMT_WHILE,
+    STMT_FOR,
+    STMT_REPEAT,
+    STMT_RETURN,
+    STMT_BLOCK,
+    STMT_VAR,
+    STMT_PRINT,
+    STMT_READ,
+    STMT_BY_NAME,           // Decided by the token after the name
+    STMT_BY_DEREF,          // Decided by the tokens after the '*' run
+    STMT_CALL_OR_ARRAY,     // name '(': an array element when mixed access finds an array
+    STMT_SCAN_LINE          // An assignment if ':=' follows on the same line
+} StatementKind;
+
+// Statement kind by first token
+static const unsigned char statement_start[TOK_COUNT] = {
+    [TOK_IF] = STMT_IF,
+    [TOK_WHILE] = STMT_WHILE,
+    [TOK_FOR] = STMT_FOR,
+    [TOK_REPEAT] = STMT_REPEAT,
+    [TOK_RETURN] = STMT_RETURN,
+    [TOK_BEGIN] = STMT_BLOCK,
+    [TOK_VAR] = STMT_VAR,
+    [TOK_PRINT] = STMT_PRINT,
+    [TOK_READ] = STMT_READ,
+    [TOK_AT] = STMT_ASSIGNMENT,
+    [TOK_IDENTIFIER] = STMT_BY_NAME,
+    [TOK_MULTIPLY] = STMT_BY_DEREF,
+    [TOK_DEREF] = STMT_BY_DEREF,
+};
+
+// Statement kind of a leading name by the token after it; anything not
+// listed falls back to scanning the line
+static const unsigned char name_statement[TOK_COUNT] = {
+    [TOK_ASSIGN] = STMT_ASSIGNMENT,
+    [TOK_LBRACKET] = STMT_ASSIGNMENT,
+    [TOK_LPAREN] = STMT_CALL_OR_ARRAY,
+};
+
+static StatementKind token_statement(const unsigned char* table, TokenType type) {
+    return (unsigned)type < TOK_COUNT ? (StatementKind)table[type] : STMT_NONE;
 }
 
-static bool is_start_of_assignment(Parser* parser) {
-    verbose_print("Checking if current tokens start an assignment\n");
-    
-    // Count consecutive dereference operators
-    size_t pos = parser->ctx.lexer->current;
-    int deref_count = 0;
-    
-    while (parser->ctx.current->type == TOK_MULTIPLY || 
-           parser->ctx.current->type == TOK_DEREF) {
-        deref_count++;
-        if (!parser->ctx.peek) break;
-        parser->ctx.current = parser->ctx.peek;
-        parser->ctx.peek = lexer_next_token(parser->ctx.lexer);
-    }
-    
-    // Reset parser position
-    parser->ctx.lexer->current = pos;
-    
-    // Handle patterns:
-    // 1. Multiple dereferences followed by identifier and assignment
-    if (deref_count > 0 && 
-        parser->ctx.current->type == TOK_IDENTIFIER &&
-        look_ahead_for_assignment(parser, 1)) {
-        return true;
-    }
-    
-    // 2. Simple identifier followed by assignment
-    if (parser->ctx.current->type == TOK_IDENTIFIER && 
-        parser->ctx.peek && parser->ctx.peek->type == TOK_ASSIGN) {
-        return true;
-    }
-    
-    // 3. Dereference operators at start
-    if (parser->ctx.current->type == TOK_MULTIPLY || 
-        parser->ctx.current->type == TOK_DEREF) {
-        return true;
-    }
-    
-    return false;
+static bool is_deref_token(Token* token) {
+    return token && (token->type == TOK_MULTIPLY || token->type == TOK_DEREF);
 }
 
-static bool is_dereferenced_assignment(Parser* parser) {
-    verbose_print("\n=== CHECKING FOR DEREFERENCED ASSIGNMENT ===\n");
-    if (!parser || !parser->ctx.current) {
-        verbose_print("Invalid parser or current token\n");
-        return false;
-    }
-
-    // Save current parser state
-    Token* saved_current = parser->ctx.current;
-    Token* saved_peek = parser->ctx.peek;
-    size_t saved_pos = parser->ctx.lexer->current;
-    int deref_count = 0;
-    
-    verbose_print("Starting token state:\n");
-    verbose_print("  Current token: type=%d, value='%s', line=%d, col=%d\n", 
-                 parser->ctx.current->type, 
-                 parser->ctx.current->value,
-                 parser->ctx.current->loc.line,
-                 parser->ctx.current->loc.column);
-    if (parser->ctx.peek) {
-        verbose_print("  Peek token: type=%d, value='%s', line=%d, col=%d\n",
-                     parser->ctx.peek->type,
-                     parser->ctx.peek->value,
-                     parser->ctx.peek->loc.line,
-                     parser->ctx.peek->loc.column);
+// Number of consecutive '*' tokens starting at the current token
+static size_t count_deref_run(Parser* parser) {
+    size_t count = 0;
+    while (is_deref_token(parser_peek_n(parser, count))) {
+        count++;
     }
-    
-    while (parser->ctx.current && 
-           (parser->ctx.current->type == TOK_MULTIPLY || 
-            parser->ctx.current->type == TOK_DEREF)) {
-        deref_count++;
-        verbose_print("Found dereference operator %d at line %d, col %d\n", 
-                     deref_count,
-                     parser->ctx.current->loc.line,
-                     parser->ctx.current->loc.column);
+    return count;
+}
 
-        // Advance tokens
-        Token* old_current = parser->ctx.current;
-        parser->ctx.current = parser->ctx.peek;
-        parser->ctx.peek = lexer_next_token(parser->ctx.lexer);
-        
-        if (parser->ctx.current) {
-            verbose_print("Advanced to token: type=%d, value='%s'\n", 
-                         parser->ctx.current->type,
-                         parser->ctx.current->value);
-        } else {
-            verbose_print("Advanced to NULL current token\n");
+// Decides what statement starts at the current token from the next few
+// tokens alone. Only name '(' with mixed array access and '*' runs need
+// the symbol table, and only to confirm what the tokens suggest.
+static StatementKind classify_statement(Parser* parser) {
+    StatementKind kind = token_statement(statement_start, parser->ctx.current->type);
+
+    if (kind == STMT_BY_DEREF) {
+        size_t deref_count = count_deref_run(parser);
+        Token* target = parser_peek_n(parser, deref_count);
+        Token* after = parser_peek_n(parser, deref_count + 1);
+        if (target->type != TOK_IDENTIFIER || !after || after->type != TOK_ASSIGN) {
+            return STMT_NONE;
+        }
+        // The target has to be a pointer at least that deep
+        Symbol* sym = lookup_variable(parser, target->value);
+        if (!sym || (int)deref_count > sym->info.var.pointer_level) {
+            return STMT_NONE;
+        }
+        return STMT_DEREF_ASSIGNMENT;
+    }
+    if (kind != STMT_BY_NAME) return kind;
+
+    Token* peek = parser->ctx.peek;
+    kind = token_statement(name_statement, peek->type);
+    if (kind == STMT_CALL_OR_ARRAY) {
+        if (!g_config.allow_mixed_array_access) return STMT_CALL;
+        const char* name = parser->ctx.current->value;
+        Symbol* sym = symtable_lookup_parameter(parser->ctx.symbols, parser->ctx.current_function, name);
+        if (!sym)
+            sym = symtable_lookup(parser->ctx.symbols, name);
+        bool array = sym && (sym->kind == SYMBOL_VARIABLE || sym->kind == SYMBOL_PARAMETER) &&
+                     sym->info.var.is_array;
+        return array ? STMT_ASSIGNMENT : STMT_CALL;
+    }
+    if (kind != STMT_NONE) return kind;
+
+    // Field and pointer targets: an assignment if ':=' comes later on the line
+    for (size_t k = 2;; k++) {
+        Token* next = parser_peek_n(parser, k);
+        if (next->type == TOK_EOF || next->type == TOK_SEMICOLON ||
+            next->loc.line != peek->loc.line) {
             break;
         }
+        if (next->type == TOK_ASSIGN) return STMT_ASSIGNMENT;
     }
-
-    bool result = false;
-    if (deref_count > 0) {
-        verbose_print("After counting %d dereference operators:\n", deref_count);
-        if (parser->ctx.current) {
-            verbose_print("Current token: type=%d, value='%s'\n",
-                         parser->ctx.current->type,
-                         parser->ctx.current->value);
-            
-            if (parser->ctx.current->type == TOK_IDENTIFIER) {
-                Symbol* sym = symtable_lookup(parser->ctx.symbols, parser->ctx.current->value);
-                if (sym) {
-                    verbose_print("Found symbol '%s' with pointer level %d\n",
-                                sym->name, sym->info.var.pointer_level);
-                    if (deref_count <= sym->info.var.pointer_level) {
-                        if (parser->ctx.peek && parser->ctx.peek->type == TOK_ASSIGN) {
-                            verbose_print("Found valid assignment pattern\n");
-                            result = true;
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    // Restore parser state
-    parser->ctx.current = saved_current;
-    parser->ctx.peek = saved_peek;
-    parser->ctx.lexer->current = saved_pos;
-
-    verbose_print("=== END DEREFERENCED ASSIGNMENT CHECK (result: %s) ===\n\n",
-                 result ? "true" : "false");
-    return result;
+    return STMT_CALL;
 }
 
 static ASTNode* parse_repeat_statement(Parser* parser) {
@@ -2207,11 +2786,12 @@ static ASTNode* parse_repeat_statement(Parser* parser) {
     ast_set_location(body, parser->ctx.current->loc);
 
     // Parse statements until 'until'
-    while (!check(parser, TOK_UNTIL) && !check(parser, TOK_EOF)) {
+    while (!at_list_end(parser)) {
+        size_t start = parser->ctx.buffer.position;
         ASTNode* statement = parse_statement(parser);
         if (statement) {
             ast_add_child(body, statement);
-        } else if (!parser->panic_mode) {
+        } else if (!resume_statements(parser, start)) {
             ast_destroy_node(body);
             ast_destroy_node(repeat);
             return NULL;
@@ -2244,134 +2824,65 @@ static ASTNode* parse_repeat_statement(Parser* parser) {
 
 static ASTNode* parse_statement(Parser* parser) {
     verbose_print("\n=== PARSING STATEMENT ===\n");
-    verbose_print("Token state at start of parse_statement:\n");
-    ASTNode* stmt;
-    if (parser->ctx.current) {
-        verbose_print("  Current token: type=%d, value='%s', line=%d, col=%d\n",
-                     parser->ctx.current->type,
-                     parser->ctx.current->value,
-                     parser->ctx.current->loc.line,
-                     parser->ctx.current->loc.column);
-    } else {
-        verbose_print("  Current token: NULL\n");
-    }
-    
-    if (parser->ctx.peek) {
-        verbose_print("  Peek token: type=%d, value='%s', line=%d, col=%d\n",
-                     parser->ctx.peek->type,
-                     parser->ctx.peek->value,
-                     parser->ctx.peek->loc.line,
-                     parser->ctx.peek->loc.column);
-    } else {
-        verbose_print("  Peek token: NULL\n");
-    }
+    debug_print_token_info(parser->ctx.current, "Current token at start of statement");
+    debug_print_token_info(parser->ctx.peek, "Peek token at start of statement");
+
+    // A new statement ends any recovery
+    parser->panic_mode = false;
+    if (parser->ctx.statement_depth == 0) parser->ctx.statement_errors = 0;
 
-    if (parser->ctx.current->type == TOK_AT) {
-        verbose_print("Found @ operator at start of statement\n");
-        stmt = parse_assignment(parser);
-        goto parsed;
+    // Statements still nest through calls, so stop before the stack runs out
+    if (parser->ctx.statement_depth >= MAX_STATEMENT_DEPTH) {
+        parser_error(parser, "Statements nested too deeply");
+        return NULL;
     }
 
-    if (parser->ctx.current && 
-        (parser->ctx.current->type == TOK_MULTIPLY || 
-         parser->ctx.current->type == TOK_DEREF)) {
-        verbose_print("Found potential dereference operator, checking for assignment\n");
-        if (is_dereferenced_assignment(parser)) {
-            verbose_print("Confirmed as dereferenced assignment, parsing assignment\n");
+    ASTNode* stmt;
+    parser->ctx.statement_depth++;
+    switch (classify_statement(parser)) {
+        case STMT_ASSIGNMENT:
+        case STMT_DEREF_ASSIGNMENT:
             stmt = parse_assignment(parser);
-            goto parsed;
-        }
-        verbose_print("Not a valid dereferenced assignment\n");
-    }
-
-    switch (parser->ctx.current->type) {
-        case TOK_IF:
-            verbose_print("Parsing if statement\n");
+            break;
+        case STMT_CALL:
+            stmt = parse_procedure_call(parser);
+            break;
+        case STMT_IF:
             stmt = parse_if_statement(parser);
-            goto parsed;
-        case TOK_WHILE:
-            verbose_print("Parsing while statement\n");
+            break;
+        case STMT_WHILE:
             stmt = parse_while_statement(parser);
-            goto parsed;
-        case TOK_FOR:
-            verbose_print("Parsing for statement\n");
+            break;
+        case STMT_FOR:
             stmt = parse_for_statement(parser);
-            goto parsed;
-        case TOK_RETURN:
-            verbose_print("Parsing return statement\n");
+            break;
+        case STMT_REPEAT:
+            stmt = parse_repeat_statement(parser);
+            break;
+        case STMT_RETURN:
             stmt = parse_return_statement(parser);
-            goto parsed;
-        case TOK_BEGIN:
-            verbose_print("Parsing block\n");
+            break;
+        case STMT_BLOCK:
             stmt = parse_block(parser);
-            goto parsed;
-        case TOK_IDENTIFIER:
-            // Look ahead to determine statement type
-            Token* peek = parser->ctx.peek;
-            Token* current = parser->ctx.current;
-            
-            // Look up symbol to check if it's an array
-            Symbol* sym = symtable_lookup_parameter(parser->ctx.symbols, parser->ctx.current_function, current->value);
-
-            if (!sym)
-                sym = symtable_lookup(parser->ctx.symbols, current->value);
-            
-            // Handle array access with parentheses
-            if (peek->type == TOK_LPAREN && g_config.allow_mixed_array_access && 
-                sym && (sym->kind == SYMBOL_VARIABLE || sym->kind == SYMBOL_PARAMETER) && sym->info.var.is_array) {
-                stmt = parse_assignment(parser);
-                goto parsed;
-            }
-            
-            // Handle regular array access
-            if (peek->type == TOK_LBRACKET || peek->type == TOK_ASSIGN) {
-                stmt = parse_assignment(parser);
-                goto parsed;
-            }
-
-            // If it's not an array access or assignment, treat as procedure call
-            if (peek->type == TOK_LPAREN) {
-                stmt = parse_procedure_call(parser);
-                goto parsed;
-            }
-            
-            // Default to parsing as assignment if we see := later
-            size_t i = parser->ctx.lexer->current;
-            while (i < parser->ctx.lexer->source_length) {
-                if (parser->ctx.lexer->source[i] == ':' && 
-                    i + 1 < parser->ctx.lexer->source_length && 
-                    parser->ctx.lexer->source[i + 1] == '=') {
-                    stmt = parse_assignment(parser);
-                    goto parsed;
-                }
-                if (parser->ctx.lexer->source[i] == ';' || 
-                    parser->ctx.lexer->source[i] == '\n') {
-                    break;
-                }
-                i++;
-            }
-            stmt = parse_procedure_call(parser);
-            goto parsed;
-        case TOK_VAR:
+            break;
+        case STMT_VAR:
             stmt = parse_variable_declaration(parser);
-            goto parsed;
-        case TOK_PRINT:
+            break;
+        case STMT_PRINT:
             stmt = parse_print_statement(parser);
-            goto parsed;
-        case TOK_READ:
+            break;
+        case STMT_READ:
             stmt = parse_read_statement(parser);
-            goto parsed;
-        case TOK_REPEAT:
-            stmt = parse_repeat_statement(parser);
-            goto parsed;
+            break;
         default:
             verbose_print("Unexpected token type %d in statement\n", parser->ctx.current->type);
             parser_error(parser, "Expected statement");
+            parser->ctx.statement_depth--;
             return NULL;
     }
-    verbose_print("End of statement parsing\n");
+    parser->ctx.statement_depth--;
+
     verbose_print("=== END PARSING STATEMENT ===\n\n");
-parsed:
     match(parser, TOK_SEMICOLON);
     return stmt;
 }
@@ -2392,7 +2903,8 @@ static ASTNode* parse_block(Parser* parser) {
 
     verbose_print("Parsing block statements\n");
     // Parse declarations and statements until 'end'
-    while (!check(parser, TOK_END) && !check(parser, TOK_EOF)) {
+    while (!at_list_end(parser)) {
+        size_t start = parser->ctx.buffer.position;
         verbose_print("\nParsing next statement in block.\n");
         verbose_print("Current token: type=%d, value='%s', line=%d, col=%d\n",
                      parser->ctx.current->type,
@@ -2415,7 +2927,7 @@ static ASTNode* parse_block(Parser* parser) {
         if (node) {
             verbose_print("Adding statement to block\n");
             ast_add_child(block, node);
-        } else if (!parser->panic_mode) {
+        } else if (!resume_statements(parser, start)) {
             verbose_print("Statement parse failed, synchronizing\n");
             parser_sync_to_next_statement(parser);
         }
@@ -2438,7 +2950,8 @@ static ASTNode* parse_procedure_call(Parser* parser) {
     if (!call) return NULL;
     ast_set_location(call, name->loc);
 
-    call->data.value = strdup(name->value);
+    call->data.value = ast_strdup(name->value);
+    resolve_callee(parser, call);
 
     // Parameter list
     if (!match(parser, TOK_LPAREN)) {
@@ -2499,12 +3012,12 @@ static ASTNode* parse_if_statement(Parser* parser) {
     ast_set_location(then_block, parser->ctx.prev->loc);
 
     // Parse statements until 'else' or 'endif'
-     while (!check(parser, TOK_ELSE) && !check(parser, TOK_ELSEIF) && 
-           !check(parser, TOK_ENDIF) && !check(parser, TOK_EOF)) {
+    while (!at_list_end(parser)) {
+        size_t start = parser->ctx.buffer.position;
         ASTNode* statement = parse_statement(parser);
         if (statement) {
             ast_add_child(then_block, statement);
-        } else if (!parser->panic_mode) {
+        } else if (!resume_statements(parser, start)) {
             ast_destroy_node(then_block);
             ast_destroy_node(if_node);
             return NULL;
@@ -2551,12 +3064,12 @@ static ASTNode* parse_if_statement(Parser* parser) {
 
 
         // Parse statements for this elseif branch
-        while (!check(parser, TOK_ELSE) && !check(parser, TOK_ELSEIF) && 
-               !check(parser, TOK_ENDIF) && !check(parser, TOK_EOF)) {
+        while (!at_list_end(parser)) {
+            size_t start = parser->ctx.buffer.position;
             ASTNode* statement = parse_statement(parser);
             if (statement) {
                 ast_add_child(elseif_block, statement);
-            } else if (!parser->panic_mode) {
+            } else if (!resume_statements(parser, start)) {
                 ast_destroy_node(elseif_block);
                 ast_destroy_node(elseif_node);
                 ast_destroy_node(if_node);
@@ -2589,11 +3102,12 @@ static ASTNode* parse_if_statement(Parser* parser) {
         }
 
         // Parse statements until 'endif'
-        while (!check(parser, TOK_ENDIF) && !check(parser, TOK_EOF)) {
+        while (!at_list_end(parser)) {
+            size_t start = parser->ctx.buffer.position;
             ASTNode* statement = parse_statement(parser);
             if (statement) {
                 ast_add_child(else_block, statement);
-            } else if (!parser->panic_mode) {
+            } else if (!resume_statements(parser, start)) {
                 ast_destroy_node(else_block);
                 ast_destroy_node(if_node);
                 return NULL;
@@ -2646,11 +3160,12 @@ static ASTNode* parse_while_statement(Parser* parser) {
     ast_set_location(body, parser->ctx.prev->loc);
 
     // Parse statements until endwhile
-    while (!check(parser, TOK_ENDWHILE) && !check(parser, TOK_EOF)) {
+    while (!at_list_end(parser)) {
+        size_t start = parser->ctx.buffer.position;
         ASTNode* statement = parse_statement(parser);
         if (statement) {
             ast_add_child(body, statement);
-        } else if (!parser->panic_mode) {
+        } else if (!resume_statements(parser, start)) {
             ast_destroy_node(body);
             ast_destroy_node(while_node);
             return NULL;
@@ -2683,7 +3198,7 @@ static ASTNode* parse_for_statement(Parser* parser) {
         return NULL;
     }
 
-    for_node->data.value = strdup(var->value);
+    for_node->data.value = ast_strdup(var->value);
 
     // Initial value
     consume(parser, TOK_ASSIGN, "Expected assignment operator after loop variable");
@@ -2723,13 +3238,21 @@ static ASTNode* parse_for_statement(Parser* parser) {
             return NULL;
         }
         ast_set_location(step_node, parser->ctx.current->loc);
+        step_node->data.number.literal = step_value->data.number.literal;
         if (is_negative) {
-            char* negative_value = malloc(strlen(step_value->data.value) + 1);
+            char* negative_value = malloc(strlen(step_value->data.value) + 2);
             negative_value[0] = '-';
+            negative_value[1] = '\0';
             strcat(negative_value, step_value->data.value);
-            step_value->data.value = negative_value;
+            step_value->data.value = ast_strdup(negative_value);
+            free(negative_value);
+            if (step_node->data.number.literal.kind == NUMBER_REAL) {
+                step_node->data.number.literal.real = -step_node->data.number.literal.real;
+            } else if (step_node->data.number.literal.kind != NUMBER_NONE) {
+                step_node->data.number.literal.integer = -step_node->data.number.literal.integer;
+            }
         }
-        step_node->data.value = strdup(step_value->data.value);
+        step_node->data.value = ast_strdup(step_value->data.value);
         ast_destroy_node(step_value);
         for_node->children[3] = step_node;
         verbose_print("Step value node created: type=%d, value=%s\n", 
@@ -2739,6 +3262,10 @@ static ASTNode* parse_for_statement(Parser* parser) {
     }
 
     Token* do_token = consume(parser, TOK_DO, "Expected 'do' after loop bounds");
+    if (!do_token) {
+        ast_destroy_node(for_node);
+        return NULL;
+    }
 
     // Track that we're in a loop for break/continue
     bool outer_loop = parser->ctx.in_loop;
@@ -2770,11 +3297,12 @@ static ASTNode* parse_for_statement(Parser* parser) {
 
 
     // Parse statements until endfor
-    while (!check(parser, TOK_ENDFOR) && !check(parser, TOK_EOF)) {
+    while (!at_list_end(parser)) {
+        size_t start = parser->ctx.buffer.position;
         ASTNode* statement = parse_statement(parser);
         if (statement) {
             ast_add_child(body, statement);
-        } else if (!parser->panic_mode) {
+        } else if (!resume_statements(parser, start)) {
             ast_destroy_node(body);
             ast_destroy_node(for_node);
             parser->ctx.in_loop = outer_loop;
@@ -2881,7 +3409,7 @@ static ASTNode* parse_left_hand_side(Parser* parser) {
         
         if (var_name) {
             verbose_print("Looking up symbol: %s\n", var_name);
-            sym = symtable_lookup(parser->ctx.symbols, var_name);
+            sym = lookup_variable(parser, var_name);
             if (sym) {
                 verbose_print("Found symbol with pointer level %d\n", sym->info.var.pointer_level);
                 if (deref_count > sym->info.var.pointer_level) {
@@ -2966,24 +3494,48 @@ static ASTNode* parse_assignment(Parser* parser) {
     return assign;
 }
 
-// The precedence order from highest to lowest will be:
-// 1. Primary (literals, parentheses)
-// 2. Unary (!, ~, -)  
-// 3. Multiplicative (*, /)
-// 4. Additive (+, -)
-// 5. Shift (<<, >>)
-// 6. Bitwise AND (&)
-// 7. Bitwise XOR (^)
-// 8. Bitwise OR (|)
-// 9. Logical AND (&&)
-// 10. Logical OR (||)
-// 11. Equality (==, !=)
+// Binary operator precedence, loosest first. Every level is left
+// associative; unary operators and primaries bind tighter than all of them.
+typedef enum {
+    PREC_NONE,
+    PREC_LOGICAL_OR,        // ||
+    PREC_LOGICAL_AND,       // &&
+    PREC_BITWISE_OR,        // |
+    PREC_BITWISE_XOR,       // ^
+    PREC_BITWISE_AND,       // &
+    PREC_SHIFT,             // << >>
+    PREC_EQUALITY,          // == !=
+    PREC_COMPARISON,        // < > <= >=
+    PREC_TERM,              // + -
+    PREC_FACTOR             // * / %
+} Precedence;
+
+static const unsigned char binary_precedence[TOK_COUNT] = {
+    [TOK_OR] = PREC_LOGICAL_OR,
+    [TOK_AND] = PREC_LOGICAL_AND,
+    [TOK_BITOR] = PREC_BITWISE_OR,
+    [TOK_BITXOR] = PREC_BITWISE_XOR,
+    [TOK_BITAND] = PREC_BITWISE_AND,
+    [TOK_LSHIFT] = PREC_SHIFT,
+    [TOK_RSHIFT] = PREC_SHIFT,
+    [TOK_EQ] = PREC_EQUALITY,
+    [TOK_NE] = PREC_EQUALITY,
+    [TOK_LT] = PREC_COMPARISON,
+    [TOK_GT] = PREC_COMPARISON,
+    [TOK_LE] = PREC_COMPARISON,
+    [TOK_GE] = PREC_COMPARISON,
+    [TOK_PLUS] = PREC_TERM,
+    [TOK_MINUS] = PREC_TERM,
+    [TOK_MULTIPLY] = PREC_FACTOR,
+    [TOK_DIVIDE] = PREC_FACTOR,
+    [TOK_MOD] = PREC_FACTOR,
+};
 
 ASTNode* parse_expression(Parser* parser) {
     debug_parser_rule_start(parser, "parse_expression");
     verbose_print("\n=== PARSING EXPRESSION ===\n");
     debug_print_parser_state_verb(parser, "START OF EXPRESSION");
-    ASTNode* expr = parse_logical_or(parser);
+    ASTNode* expr = parse_binary(parser, PREC_LOGICAL_OR);
 
     if (parser->ctx.current && 
         (parser->ctx.current->type == TOK_ASSIGN || 
@@ -2998,486 +3550,232 @@ ASTNode* parse_expression(Parser* parser) {
     return expr;
 }
 
-static ASTNode* parse_logical_or(Parser* parser) {
-    verbose_print("Parsing logical OR\n");
-    ASTNode* expr = parse_logical_and(parser);
-    if (!expr) return NULL;
-
-    while (check(parser, TOK_OR)) {
-        TokenType op = parser->ctx.current->type;
-        SourceLocation or_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-
-        ASTNode* right = parse_logical_and(parser);
-        if (!right) {
-            ast_destroy_node(expr);
-            return NULL;
-        }
-
-        ASTNode* new_expr = ast_create_node(NODE_BINARY_OP);
-        if (!new_expr) {
-            ast_destroy_node(expr);
-            ast_destroy_node(right);
-            return NULL;
-        }
-        ast_set_location(new_expr, or_loc);
-
-        new_expr->data.binary_op.op = op;
-        ast_add_child(new_expr, expr);
-        ast_add_child(new_expr, right);
-        expr = new_expr;
-    }
-
-    return expr;
-}
-
-static ASTNode* parse_logical_and(Parser* parser) {
-    verbose_print("Parsing logical AND\n");
-    ASTNode* expr = parse_bitwise_or(parser);  // Chain to bitwise OR
-    if (!expr) return NULL;
-
-    while (check(parser, TOK_AND)) {
-        TokenType op = parser->ctx.current->type;
-        SourceLocation and_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-
-        ASTNode* right = parse_bitwise_or(parser);  // Chain to bitwise OR
-        if (!right) {
-            ast_destroy_node(expr);
-            return NULL;
-        }
-
-        ASTNode* new_expr = ast_create_node(NODE_BINARY_OP);
-        if (!new_expr) {
-            ast_destroy_node(expr);
-            ast_destroy_node(right);
-            return NULL;
-        }
-        ast_set_location(new_expr, and_loc);
-
-        new_expr->data.binary_op.op = op;
-        ast_add_child(new_expr, expr);
-        ast_add_child(new_expr, right);
-        expr = new_expr;
-    }
-
-    return expr;
-}
-
-static ASTNode* parse_bitwise_or(Parser* parser) {
-    verbose_print("Parsing bitwise OR\n");
-    // First get left operand from next precedence level
-    ASTNode* expr = parse_bitwise_xor(parser);
-    if (!expr) return NULL;
-
-    // Then look for OR operators
-    while (check(parser, TOK_BITOR)) {
-        TokenType op = parser->ctx.current->type;
-        SourceLocation bitor_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-
-        ASTNode* right = parse_bitwise_xor(parser);
-        if (!right) {
-            ast_destroy_node(expr);
-            return NULL;
-        }
-
-        ASTNode* new_expr = ast_create_node(NODE_BINARY_OP);
-        if (!new_expr) {
-            ast_destroy_node(expr);
-            ast_destroy_node(right);
-            return NULL;
-        }
-        ast_set_location(new_expr, bitor_loc);
-
-        new_expr->data.binary_op.op = op;
-        ast_add_child(new_expr, expr);
-        ast_add_child(new_expr, right);
-        expr = new_expr;
-    }
-
-    return expr;
-}
-
-static ASTNode* parse_bitwise_xor(Parser* parser) {
-    verbose_print("Parsing bitwise XOR\n");
-    ASTNode* expr = parse_bitwise_and(parser);
-    if (!expr) return NULL;
-
-    while (check(parser, TOK_BITXOR)) {
-        TokenType op = parser->ctx.current->type;
-        SourceLocation bitxor_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-
-        ASTNode* right = parse_bitwise_and(parser);
-        if (!right) {
-            ast_destroy_node(expr);
-            return NULL;
-        }
-
-        ASTNode* new_expr = ast_create_node(NODE_BINARY_OP);
-        if (!new_expr) {
-            ast_destroy_node(expr);
-            ast_destroy_node(right);
-            return NULL;
-        }
-        ast_set_location(new_expr, bitxor_loc);
-
-        new_expr->data.binary_op.op = op;
-        ast_add_child(new_expr, expr);
-        ast_add_child(new_expr, right);
-        expr = new_expr;
-    }
-
-    return expr;
+// The operators of an expression wait on an explicit stack rather than in
+// nested calls, so nesting depth is limited by memory instead of the call
+// stack. Each frame stands for one call of a recursive descent parser.
+typedef enum {
+    FRAME_BINARY,       // One precedence-climbing level
+    FRAME_PREFIX,       // '-', not, '~' or '&' waiting for its operand
+    FRAME_DEREF,        // A run of '*' waiting for a primary
+    FRAME_AT,           // '@' waiting for a primary
+    FRAME_GROUP         // '(' waiting for its expression and ')'
+} ExprFrameKind;
+
+typedef struct {
+    ExprFrameKind kind;
+    TokenType op;           // Prefix operator, or the binary operator after left
+    int min_precedence;     // Binary levels: loosest operator they take
+    int start_line;         // Binary levels: line their first operand starts on
+    int deref_count;
+    SourceLocation loc;     // Of the operator
+    ASTNode* left;          // Binary levels: the operand so far, if any
+} ExprFrame;
+
+typedef struct {
+    ExprFrame* frames;
+    size_t count;
+    size_t capacity;
+} ExprStack;
+
+static bool push_frame(ExprStack* stack, ExprFrame frame) {
+    if (stack->count == stack->capacity) {
+        size_t capacity = stack->capacity ? stack->capacity * 2 : 16;
+        ExprFrame* frames = (ExprFrame*)realloc(stack->frames, capacity * sizeof(ExprFrame));
+        if (!frames) return false;
+        stack->frames = frames;
+        stack->capacity = capacity;
+    }
+    stack->frames[stack->count++] = frame;
+    return true;
 }
 
-static ASTNode* parse_bitwise_and(Parser* parser) {
-    verbose_print("Parsing bitwise AND\n");
-    ASTNode* expr = parse_shift(parser);
-    if (!expr) return NULL;
-
-    while (check(parser, TOK_BITAND)) {
-        TokenType op = parser->ctx.current->type;
-        SourceLocation bitand_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-
-        ASTNode* right = parse_shift(parser);
-        if (!right) {
-            ast_destroy_node(expr);
-            return NULL;
-        }
-
-        ASTNode* new_expr = ast_create_node(NODE_BINARY_OP);
-        if (!new_expr) {
-            ast_destroy_node(expr);
-            ast_destroy_node(right);
-            return NULL;
-        }
-        ast_set_location(new_expr, bitand_loc);
-
-        new_expr->data.binary_op.op = op;
-        ast_add_child(new_expr, expr);
-        ast_add_child(new_expr, right);
-        expr = new_expr;
-    }
-
-    return expr;
+static bool push_level(Parser* parser, ExprStack* stack, int min_precedence) {
+    return push_frame(stack, (ExprFrame){
+        .kind = FRAME_BINARY,
+        .min_precedence = min_precedence,
+        .start_line = parser->ctx.current->loc.line
+    });
 }
 
-static ASTNode* parse_shift(Parser* parser) {
-    verbose_print("Parsing shift\n");
-    ASTNode* expr = parse_equality(parser);
-    if (!expr) return NULL;
-
-    while (check(parser, TOK_LSHIFT) || check(parser, TOK_RSHIFT)) {
-        TokenType op = parser->ctx.current->type;
-        SourceLocation shift_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-
-        ASTNode* right = parse_equality(parser);
-        if (!right) {
-            ast_destroy_node(expr);
-            return NULL;
-        }
-
-        ASTNode* new_expr = ast_create_node(NODE_BINARY_OP);
-        if (!new_expr) {
-            ast_destroy_node(expr);
-            ast_destroy_node(right);
-            return NULL;
-        }
-        ast_set_location(new_expr, shift_loc);
-
-        new_expr->data.binary_op.op = op;
-        ast_add_child(new_expr, expr);
-        ast_add_child(new_expr, right);
-        expr = new_expr;
+// Unwinds a failed expression as the nested calls would return: each open
+// parenthesis still expects its ')'
+static ASTNode* abandon_expression(Parser* parser, ExprStack* stack) {
+    while (stack->count > 0) {
+        ExprFrame* frame = &stack->frames[--stack->count];
+        if (frame->kind == FRAME_GROUP) consume(parser, TOK_RPAREN, "Expected ')'");
+        ast_destroy_node(frame->left);
     }
-
-    return expr;
+    free(stack->frames);
+    return NULL;
 }
 
-static ASTNode* parse_equality(Parser* parser) {
-    verbose_print("Parsing equality\n");
-    ASTNode* expr = parse_comparison(parser);
-    if (!expr) return NULL;
-
-    while (check(parser, TOK_EQ) || check(parser, TOK_NE)) {
-        TokenType op = parser->ctx.current->type;
-        SourceLocation equality_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-
-        ASTNode* right = parse_comparison(parser);
-        if (!right) {
-            ast_destroy_node(expr);
-            return NULL;
+// The node a prefix, dereference or '@' frame makes of its operand
+static ASTNode* apply_prefix(Parser* parser, const ExprFrame* frame, ASTNode* operand) {
+    if (frame->kind == FRAME_DEREF) {
+        // Look up symbol to validate dereferencing
+        Symbol* sym = NULL;
+        if (operand->type == NODE_IDENTIFIER) {
+            sym = lookup_variable(parser, operand->data.value);
+        } else if (operand->type == NODE_VARIABLE) {
+            sym = lookup_variable(parser, operand->data.variable.name);
         }
-
-        ASTNode* new_expr = ast_create_node(NODE_BINARY_OP);
-        if (!new_expr) {
-            ast_destroy_node(expr);
-            ast_destroy_node(right);
+        if (sym && frame->deref_count > sym->info.var.pointer_level) {
+            parser_error(parser, "Too many dereference operators");
+            ast_destroy_node(operand);
             return NULL;
         }
-        ast_set_location(new_expr, equality_loc);
-
-        new_expr->data.binary_op.op = op;
-        ast_add_child(new_expr, expr);
-        ast_add_child(new_expr, right);
-        expr = new_expr;
     }
 
-    return expr;
-}
-
-static ASTNode* parse_comparison(Parser* parser) {
-    verbose_print("Parsing comparison\n");
-    ASTNode* expr = parse_term(parser);
-    if (!expr) return NULL;
-
-    while (check(parser, TOK_LT) || check(parser, TOK_GT) ||
-           check(parser, TOK_LE) || check(parser, TOK_GE)) {
-        TokenType op = parser->ctx.current->type;
-        SourceLocation comparison_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-
-        ASTNode* right = parse_term(parser);
-        if (!right) {
-            ast_destroy_node(expr);
-            return NULL;
-        }
-
-        ASTNode* new_expr = ast_create_node(NODE_BINARY_OP);
-        if (!new_expr) {
-            ast_destroy_node(expr);
-            ast_destroy_node(right);
-            return NULL;
-        }
-        ast_set_location(new_expr, comparison_loc);
-
-        new_expr->data.binary_op.op = op;
-        ast_add_child(new_expr, expr);
-        ast_add_child(new_expr, right);
-        expr = new_expr;
+    ASTNode* node = ast_create_node(NODE_UNARY_OP);
+    if (!node) {
+        ast_destroy_node(operand);
+        return NULL;
     }
+    ast_set_location(node, frame->loc);
 
-    return expr;
-}
-
-static ASTNode* parse_term(Parser* parser) {
-    verbose_print("Parsing term\n");
-    int start_line = parser->ctx.current->loc.line;
-    ASTNode* expr = parse_factor(parser);
-    if (!expr) return NULL;
-
-    while (check(parser, TOK_PLUS) || check(parser, TOK_MINUS)) {
-        if (start_line != parser->ctx.current->loc.line) {
-            verbose_print("Detected new line in factor, stopping\n");
+    switch (frame->kind) {
+        case FRAME_DEREF:
+            node->data.unary_op.op = TOK_DEREF;
+            node->data.unary_op.deref_count = frame->deref_count;
+            verbose_print("Created dereference node with %d levels\n", frame->deref_count);
             break;
-        }
-        TokenType op = parser->ctx.current->type;
-        SourceLocation sum_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-
-        ASTNode* right = parse_factor(parser);
-        if (!right) {
-            ast_destroy_node(expr);
-            return NULL;
-        }
-
-        ASTNode* new_expr = ast_create_node(NODE_BINARY_OP);
-        if (!new_expr) {
-            ast_destroy_node(expr);
-            ast_destroy_node(right);
-            return NULL;
-        }
-        ast_set_location(new_expr, sum_loc);
-
-        new_expr->data.binary_op.op = op;
-        ast_add_child(new_expr, expr);
-        ast_add_child(new_expr, right);
-        expr = new_expr;
-    }
-
-    return expr;
-}
-
-static ASTNode* parse_factor(Parser* parser) {
-    verbose_print("\n=== PARSING FACTOR ===\n");
-    debug_print_parser_state_verb(parser, "START OF FACTOR");
-    //Token* start_token = parser->ctx.current;
-    int start_line = parser->ctx.current->loc.line;
-    ASTNode* expr = parse_unary(parser);
-    if (!expr) return NULL;
-
-    while (check(parser, TOK_MULTIPLY) || check(parser, TOK_DIVIDE) || check(parser, TOK_MOD)) {
-        if (start_line != parser->ctx.current->loc.line) {
-            verbose_print("Detected new line in factor, stopping\n");
+        case FRAME_AT:
+            node->data.unary_op.op = TOK_AT;
+            node->data.unary_op.deref_count = 0;
+            operand->data.unary_op.op = TOK_AT;
+            break;
+        default:
+            node->data.unary_op.op = frame->op;
+            node->data.unary_op.deref_count = 0;
             break;
-        }
-        TokenType op = parser->ctx.current->type;
-        //advance(parser);
-        SourceLocation op_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-        //consume_token_with_trace(parser, "FACTOR OPERATOR");
-
-        ASTNode* right = parse_unary(parser);
-        if (!right) {
-            ast_destroy_node(expr);
-            return NULL;
-        }
-
-        ASTNode* new_expr = ast_create_node(NODE_BINARY_OP);
-        if (!new_expr) {
-            ast_destroy_node(expr);
-            ast_destroy_node(right);
-            return NULL;
-        }
-        ast_set_location(new_expr, op_loc);
-
-        new_expr->data.binary_op.op = op;
-        ast_add_child(new_expr, expr);
-        ast_add_child(new_expr, right);
-        expr = new_expr;
     }
-
-    debug_print_parser_state_verb(parser, "END OF FACTOR");
-
-    return expr;
+    ast_add_child(node, operand);
+    return node;
 }
 
-static ASTNode* parse_unary(Parser* parser) {
-    
-    verbose_print("\n=== PARSING UNARY ===\n");
-    debug_print_parser_state_verb(parser, "START OF UNARY");
-    
-    Token* start_token = parser->ctx.current;
-    if (check(parser, TOK_MULTIPLY) || check(parser, TOK_DEREF)) {
-        verbose_print("Found dereference operator\n");
-        int deref_count = 0;
-        SourceLocation deref_loc = token_clone_location(parser->ctx.current);
-        
-        // Count consecutive dereference operators
-        while (check(parser, TOK_MULTIPLY) || check(parser, TOK_DEREF)) {
-            verbose_print("Found dereference operator %d\n", deref_count);
-            consume_token_with_trace(parser, "DEREFERENCE OPERATOR");
-            deref_count++;
-            //advance(parser);
-        }
-        
-        verbose_print("Parsing operand after %d dereference operators\n", deref_count);
-        ASTNode* operand = parse_primary(parser);
-        if (!operand) {
-            verbose_print("Failed to parse operand after dereference\n");
-            return NULL;
-        }
-
-        // Look up symbol to validate dereferencing
-        Symbol* sym = NULL;
-        if (operand->type == NODE_IDENTIFIER) {
-            sym = symtable_lookup(parser->ctx.symbols, operand->data.value);
-        } else if (operand->type == NODE_VARIABLE) {
-            sym = symtable_lookup(parser->ctx.symbols, operand->data.variable.name);
-        }
-
-        if (sym) {
-            verbose_print("Found symbol %s with pointer level %d\n", 
-                         sym->name, sym->info.var.pointer_level);
-            if (deref_count > sym->info.var.pointer_level) {
-                parser_error(parser, "Too many dereference operators");
-                ast_destroy_node(operand);
-                return NULL;
-            }
-        }
-
-        // Create unary node for dereferencing
-        ASTNode* node = ast_create_node(NODE_UNARY_OP);
-        if (!node) {
-            ast_destroy_node(operand);
-            return NULL;
-        }
-        ast_set_location(node, deref_loc);
-
-        node->data.unary_op.op = TOK_DEREF;
-        node->data.unary_op.deref_count = deref_count;
-        ast_add_child(node, operand);
-        verbose_print("Created dereference node with %d levels\n", deref_count);
-        return node;
-    }
-    else if (check(parser, TOK_ADDR_OF)) {
-        SourceLocation addrof_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-        ASTNode* operand = parse_unary(parser);
-        if (!operand) return NULL;
-
-        ASTNode* node = ast_create_node(NODE_UNARY_OP);
+// Hands a finished operand to the level on top of the stack. Returns true
+// once that level has taken an operator and wants its right operand;
+// otherwise the level is finished too and is popped into *operand.
+static bool continue_level(Parser* parser, ExprStack* stack, ASTNode** operand) {
+    ExprFrame* level = &stack->frames[stack->count - 1];
+    if (level->left) {
+        ASTNode* node = ast_create_node(NODE_BINARY_OP);
         if (!node) {
-            ast_destroy_node(operand);
-            return NULL;
+            ast_destroy_node(*operand);
+            *operand = NULL;
+            return false;
         }
-        ast_set_location(node, addrof_loc);
-
-        node->data.unary_op.op = TOK_ADDR_OF;
-        node->data.unary_op.deref_count = 0;
-        ast_add_child(node, operand);
-        return node;
+        ast_set_location(node, level->loc);
+        node->data.binary_op.op = level->op;
+        ast_add_child(node, level->left);
+        ast_add_child(node, *operand);
+        *operand = node;
+    }
+    level->left = *operand;
+
+    TokenType op = parser->ctx.current->type;
+    int precedence = (unsigned)op < TOK_COUNT ? binary_precedence[op] : PREC_NONE;
+    bool takes = precedence != PREC_NONE && precedence >= level->min_precedence;
+    // An arithmetic operator on a new line starts the next statement
+    if (takes && precedence >= PREC_TERM && parser->ctx.current->loc.line != level->start_line) {
+        verbose_print("Detected new line in expression, stopping\n");
+        takes = false;
+    }
+    if (!takes) {
+        stack->count--;
+        *operand = level->left;
+        return false;
     }
 
-    else if (check(parser, TOK_MINUS) || check(parser, TOK_NOT) || 
-        check(parser, TOK_BITNOT)) {
-        TokenType op = parser->ctx.current->type;
-        SourceLocation op_loc = token_clone_location(parser->ctx.current);
-        advance(parser);
-        
-        ASTNode* operand = parse_unary(parser);  // Recursively parse the operand
-        if (!operand) return NULL;
+    level->op = op;
+    level->loc = token_clone_location(parser->ctx.current);
+    advance(parser);
+    return true;
+}
 
-        ASTNode* node = ast_create_node(NODE_UNARY_OP);
-        if (!node) {
-            ast_destroy_node(operand);
-            return NULL;
+// Parses a unary operand followed by binary operators that bind at least
+// as tightly as min_precedence, by precedence climbing
+static ASTNode* parse_binary(Parser* parser, int min_precedence) {
+    ExprStack stack = {0};
+    if (!push_level(parser, &stack, min_precedence)) return NULL;
+
+    // After '*' or '@' only a primary can follow
+    bool primary_only = false;
+    for (;;) {
+        ExprFrame frame = {.loc = token_clone_location(parser->ctx.current)};
+        TokenType type = parser->ctx.current->type;
+        bool pushed = false;
+        if (!primary_only && (type == TOK_MULTIPLY || type == TOK_DEREF)) {
+            verbose_print("Found dereference operator\n");
+            frame.kind = FRAME_DEREF;
+            while (check(parser, TOK_MULTIPLY) || check(parser, TOK_DEREF)) {
+                consume_token_with_trace(parser, "DEREFERENCE OPERATOR");
+                frame.deref_count++;
+            }
+            primary_only = true;
+            pushed = push_frame(&stack, frame);
+        } else if (!primary_only && (type == TOK_ADDR_OF || type == TOK_MINUS ||
+                                     type == TOK_NOT || type == TOK_BITNOT)) {
+            frame.kind = FRAME_PREFIX;
+            frame.op = type;
+            advance(parser);
+            pushed = push_frame(&stack, frame);
+        } else if (type == TOK_AT) {
+            verbose_print("Found @ operator\n");
+            frame.kind = FRAME_AT;
+            advance(parser);
+            primary_only = true;
+            pushed = push_frame(&stack, frame);
+        } else if (type == TOK_LPAREN) {
+            frame.kind = FRAME_GROUP;
+            advance(parser);
+            primary_only = false;
+            pushed = push_frame(&stack, frame) && push_level(parser, &stack, PREC_LOGICAL_OR);
+        } else {
+            ASTNode* operand = parse_primary(parser);
+            primary_only = false;
+
+            // Finish every frame the operand completes
+            while (operand) {
+                ExprFrame* top = &stack.frames[stack.count - 1];
+                if (top->kind == FRAME_BINARY) {
+                    if (continue_level(parser, &stack, &operand)) {
+                        pushed = push_level(parser, &stack, binary_precedence[top->op] + 1);
+                        break;
+                    }
+                    if (!operand) break;
+                    if (stack.count == 0) {
+                        free(stack.frames);
+                        return operand;
+                    }
+                    continue;
+                }
+                ExprFrame finished = *top;
+                stack.count--;
+                if (finished.kind == FRAME_GROUP) {
+                    consume(parser, TOK_RPAREN, "Expected ')'");
+                } else {
+                    operand = apply_prefix(parser, &finished, operand);
+                }
+            }
+            if (!operand) return abandon_expression(parser, &stack);
         }
-        ast_set_location(node, op_loc);
-
-        node->data.unary_op.op = op;
-        ast_add_child(node, operand);
-        return node;
+        if (!pushed) return abandon_expression(parser, &stack);
     }
-
-    return parse_primary(parser);
 }
 
 static ASTNode* parse_primary(Parser* parser) {
     verbose_print("\n=== PARSING PRIMARY ===\n");
     debug_print_parser_state_verb(parser, "START OF PRIMARY");
     
-    if (match(parser, TOK_AT)) {
-        verbose_print("Found @ operator\n");
-        SourceLocation at_loc = token_clone_location(parser->ctx.prev);
-        ASTNode* expr = parse_primary(parser);
-        if (!expr) return NULL;
-
-        ASTNode* no_deref = ast_create_node(NODE_UNARY_OP);
-        if (!no_deref) {
-            ast_destroy_node(expr);
-            return NULL;
-        }
-        ast_set_location(no_deref, at_loc);
-        no_deref->data.unary_op.op = TOK_AT;
-        no_deref->data.unary_op.deref_count = 0;
-        expr->data.unary_op.op = TOK_AT;
-        ast_add_child(no_deref, expr);
-        return no_deref;
-    }
-
     if (check(parser, TOK_NUMBER)) {
         Token* number = consume(parser, TOK_NUMBER, "Expected number");
         SourceLocation number_loc = token_clone_location(number);
         ASTNode* node = ast_create_node(NODE_NUMBER);
         if (!node) return NULL;
         ast_set_location(node, number_loc);
-        node->data.value = strdup(number->value);
+        node->data.value = ast_strdup(number->value);
+        node->data.number.literal = number->number;
         return node;
     }
 
@@ -3491,7 +3789,7 @@ static ASTNode* parse_primary(Parser* parser) {
         ast_set_location(node, bool_loc);
 
         // Store standardized value
-        node->data.value = strdup(bool_token->type == TOK_TRUE ? "1" : "0");
+        node->data.value = ast_strdup(bool_token->type == TOK_TRUE ? "1" : "0");
         return node;
     }
 
@@ -3512,7 +3810,8 @@ static ASTNode* parse_primary(Parser* parser) {
             node = ast_create_node(NODE_IDENTIFIER);
             if (!node) return NULL;
             ast_set_location(node, identifier_loc);
-            node->data.value = strdup(name->value);
+            node->data.value = ast_strdup(name->value);
+            node->data.name.symbol = symbol;
             node = parse_array_access(parser, node);
         }
         // Check if it's a function call
@@ -3523,7 +3822,8 @@ static ASTNode* parse_primary(Parser* parser) {
             ast_set_location(node, identifier_loc);
             if (!node) return NULL;
             ast_set_location(node, identifier_loc);
-            node->data.value = strdup(name->value);
+            node->data.value = ast_strdup(name->value);
+            node->data.name.symbol = symbol;
             if (symbol && symbol->info.var.is_parameter && symbol->info.var.needs_deref &&
                 (strcasecmp(symbol->info.var.param_mode, "out") == 0 || 
                 strcasecmp(symbol->info.var.param_mode, "inout") == 0 || 
@@ -3567,12 +3867,10 @@ static ASTNode* parse_primary(Parser* parser) {
                 while (check(parser, TOK_DOT) || check(parser, TOK_ARROW)) {
                     TokenType op = match(parser, TOK_DOT) ? TOK_DOT : match(parser, TOK_ARROW) ? TOK_ARROW : TOK_DOT;
                     ASTNode* field_access = parse_field_access(parser, node, type_sym);
-                    char* new_name = malloc(strlen(field_access->data.variable.name) + strlen(op == TOK_DOT ? "." : "->"));
-                    sprintf(new_name, "%s%s", op == TOK_DOT ? "." : "->", field_access->data.variable.name);
-                    free(field_access->data.variable.name);
-                    field_access->data.variable.name = strdup(new_name);
-                    free(new_name);
                     if (!field_access) return NULL;
+                    char* name = field_access->data.variable.name;
+                    field_access->data.variable.name = ast_strcat(op == TOK_DOT ? "." : "->", name);
+                    if (!field_access->arena) free(name);
                     node = field_access;
                 }
             }
@@ -3589,16 +3887,10 @@ static ASTNode* parse_primary(Parser* parser) {
         ast_set_location(node, string_loc);
 
         // Store standardized value
-        node->data.value = strdup(string_token->value);
+        node->data.value = ast_strdup(string_token->value);
         return node;
     }
 
-    if (match(parser, TOK_LPAREN)) {
-        ASTNode* expr = parse_expression(parser);
-        consume(parser, TOK_RPAREN, "Expected ')'");
-        return expr;
-    }
-
     parser_error(parser, "Expected expression");
     return NULL;
 }
@@ -3628,7 +3920,7 @@ static ASTNode* parse_field_access(Parser* parser, ASTNode* record, Symbol* reco
     if (!access) return NULL;
     
     ast_set_location(access, parser->ctx.current->loc);
-    access->data.value = strdup(field->value);  // Store field name
+    access->data.value = ast_strdup(field->value);  // Store field name
     ast_add_child(access, record);  // Add record expression as child
 
     /*// Validate that record is actually a record type
@@ -3721,8 +4013,11 @@ static ASTNode* parse_array_access(Parser* parser, ASTNode* array) {
 
         verbose_print("Created new array access node\n");
 
-        // Link previous expression as array base
+        // Link previous expression as array base, whose symbol is the array's
         ast_add_child(access, current);
+        if (current->type == NODE_VARIABLE || current->type == NODE_IDENTIFIER) {
+            access->data.array_access.symbol = ast_symbol(current);
+        }
         verbose_print("Added base node as first child\n");
 
         // Parse first index expression
@@ -3779,7 +4074,8 @@ static ASTNode* parse_function_call(Parser* parser, const char* name) {
     if (!call) return NULL;
     ast_set_location(call, parser->ctx.prev->loc);
 
-    call->data.value = strdup(name);
+    call->data.value = ast_strdup(name);
+    resolve_callee(parser, call);
     
     consume(parser, TOK_LPAREN, "Expected '(' after function name");
 
@@ -3845,7 +4141,7 @@ static ASTNode* parse_type_specifier(Parser* parser, int* pointer_level) {
 
     // Check for dimensional specifier (e.g., "2d", "3d")
     int dimensions = parse_array_dimension(parser);
-    size_t var_start = parser->ctx.lexer->start;
+    size_t var_start = parser->ctx.peek->offset;
     if (dimensions > 0) {
         verbose_print("Found %dd array\n", dimensions);
         
@@ -3873,7 +4169,7 @@ static ASTNode* parse_type_specifier(Parser* parser, int* pointer_level) {
         }
     } else {
         // Count array dimensions from multiple brackets
-        /*int bracket_dimensions = count_array_type_dimensions_ahead(parser->ctx.lexer, var_start);
+        /*int bracket_dimensions = count_array_dimensions_ahead(parser, var_start);
         for (int i = 0; i < bracket_dimensions; ++i) {
             if (type_len + prefix_len >= sizeof(type_str) - 1) {
                 parser_error(parser, "Type string too long");
@@ -3925,13 +4221,19 @@ static ASTNode* parse_type_specifier(Parser* parser, int* pointer_level) {
     // Add base type to type string
     strcat(type_str, base_type);
     // Store complete type string and dimensions
-    type->data.value = strdup(type_str);
+    type->data.value = ast_strdup(type_str);
     while (match(parser, TOK_MULTIPLY) || match(parser, TOK_DEREF)) {
         *pointer_level += 1;
     }
 
-    if (dimensions)
-        type->array_bounds.dimensions = dimensions;
+    if (dimensions) {
+        ArrayBoundsData* bounds = (ArrayBoundsData*)malloc(sizeof(ArrayBoundsData));
+        if (bounds) {
+            bounds->dimensions = dimensions;
+            bounds->bounds = NULL;
+            if (!ast_set_array_bounds(type, bounds)) free(bounds);
+        }
+    }
 
     
     return type;
@@ -3992,7 +4294,7 @@ static ASTNode* parse_parameter(Parser* parser) {
     }
 
 
-    size_t var_start = parser->ctx.lexer->start;
+    size_t var_start = parser->ctx.peek->offset;
 
     Token* name = consume(parser, TOK_IDENTIFIER, "Expected parameter name");
 
@@ -4000,7 +4302,7 @@ static ASTNode* parse_parameter(Parser* parser) {
         ast_destroy_node(param);
         return NULL;
     }
-    param->data.parameter.name = strdup(name->value);
+    param->data.parameter.name = ast_strdup(name->value);
 
     ArrayBoundsData* bounds = NULL;
     int total_dimensions = 0;
@@ -4009,11 +4311,11 @@ static ASTNode* parse_parameter(Parser* parser) {
     if (match(parser, TOK_LBRACKET)) {
         has_brackets = true;
         // Check if we have comma-separated dimensions like [n,m]
-        if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, false)) {  //TODO do the same for LBRACKET and for type LBRACKET and for for var decl
+        if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser, var_start, false)) {  //TODO do the same for LBRACKET and for type LBRACKET and for for var decl
             
             int dimension_count = 1;
             TokenType lookahead_type = parser->ctx.peek->type;
-            dimension_count = count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, false);
+            dimension_count = count_comma_array_dimensions_ahead(parser, var_start, false);
             
             // Create bounds for all dimensions
             bounds = symtable_create_bounds(dimension_count);
@@ -4048,7 +4350,7 @@ static ASTNode* parse_parameter(Parser* parser) {
         } else {
             // Single dimension bounds like [n] or [1..n]
 
-            total_dimensions = count_array_dimensions_ahead(parser->ctx.lexer, var_start, false);
+            total_dimensions = count_array_dimensions_ahead(parser, var_start, false);
             if (total_dimensions <= 0) {
                 ast_destroy_node(param);
                 return NULL;
@@ -4069,10 +4371,10 @@ static ASTNode* parse_parameter(Parser* parser) {
     } else if (g_config.allow_mixed_array_access && match(parser, TOK_LPAREN)) {
         has_brackets = true;
         // Check if we have comma-separated dimensions like [n,m]
-        if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, true)) {
+        if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser, var_start, true)) {
             int dimension_count = 1;
             TokenType lookahead_type = parser->ctx.peek->type;
-            dimension_count = count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, true);
+            dimension_count = count_comma_array_dimensions_ahead(parser, var_start, true);
             
             // Create bounds for all dimensions
             bounds = symtable_create_bounds(dimension_count);
@@ -4106,7 +4408,7 @@ static ASTNode* parse_parameter(Parser* parser) {
             
         } else {
             // Single dimension bounds like [n] or [1..n]
-            total_dimensions = count_array_dimensions_ahead(parser->ctx.lexer, var_start, true);
+            total_dimensions = count_array_dimensions_ahead(parser, var_start, true);
             if (total_dimensions <= 0) {
                 ast_destroy_node(param);
                 return NULL;
@@ -4145,21 +4447,21 @@ static ASTNode* parse_parameter(Parser* parser) {
     } else if (parser->ctx.current->type == TOK_ARRAY) {
         if (parser->ctx.peek->type == TOK_LBRACKET) {
             // we founds bounds, so we are in the implicit case: if is comma parse commas else count brackets
-            size_t var_start = parser->ctx.lexer->start;
-            type_dimensions = count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, false);
+            size_t var_start = parser->ctx.peek->offset;
+            type_dimensions = count_comma_array_dimensions_ahead(parser, var_start, false);
             if (type_dimensions == 1) { // we found no commas
                 // check brackets
-                type_dimensions = count_array_type_dimensions_ahead(parser->ctx.lexer, var_start, false);
+                type_dimensions = count_array_dimensions_ahead(parser, var_start, false);
                 if (type_dimensions < 1)
                     type_dimensions = 1;
             }
         } else if (g_config.allow_mixed_array_access && parser->ctx.peek->type == TOK_LPAREN) {
              // we founds bounds, so we are in the implicit case: if is comma parse commas else count brackets
-            size_t var_start = parser->ctx.lexer->start;
-            type_dimensions = count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, true);
+            size_t var_start = parser->ctx.peek->offset;
+            type_dimensions = count_comma_array_dimensions_ahead(parser, var_start, true);
             if (type_dimensions == 1) { // we found no commas
                 // check brackets
-                type_dimensions = count_array_type_dimensions_ahead(parser->ctx.lexer, var_start, true);
+                type_dimensions = count_array_dimensions_ahead(parser, var_start, true);
                 if (type_dimensions < 1)
                     type_dimensions = 1;
             }
@@ -4178,7 +4480,7 @@ static ASTNode* parse_parameter(Parser* parser) {
 
         // Handle array bounds in type declaration
         if (match(parser, TOK_LBRACKET)) {
-            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, false)) {
+            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser, var_start, false)) {
                 // Create bounds for all dimensions
                 type_bounds = symtable_create_bounds(type_dimensions);
                 if (!type_bounds) {
@@ -4224,7 +4526,7 @@ static ASTNode* parse_parameter(Parser* parser) {
                 return NULL;
             }
         } else if (match(parser, TOK_LPAREN)) {
-            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser->ctx.lexer, var_start, true)) {
+            if (parser->ctx.peek->type == TOK_COMMA || count_comma_array_dimensions_ahead(parser, var_start, true)) {
                 // Create bounds for all dimensions
                 type_bounds = symtable_create_bounds(type_dimensions);
                 if (!type_bounds) {
@@ -4309,7 +4611,7 @@ static ASTNode* parse_parameter(Parser* parser) {
     }
 
     if (base_type) {
-        char* full_type = malloc(strlen(base_type->data.value) + array_dimensions * 32);
+        char* full_type = malloc(strlen(base_type->data.value) + array_dimensions * 32 + 1);
         if (!full_type) {
             ast_destroy_node(base_type);
             if (type_bounds) symtable_destroy_bounds(type_bounds);
@@ -4323,7 +4625,8 @@ static ASTNode* parse_parameter(Parser* parser) {
             strcat(full_type, "array of ");
         }
         strcat(full_type, base_type->data.value);
-        param->data.parameter.type = full_type;
+        param->data.parameter.type = ast_strdup(full_type);
+        free(full_type);
         param->data.parameter.pointer_level = type_pointer_level + pointer_level;
         param->data.parameter.is_pointer = type_pointer_level + pointer_level > 0;
     }
@@ -4369,6 +4672,10 @@ static ASTNode* parse_parameter(Parser* parser) {
         }
     }
 
+    // The function's copy, which the signature is generated from
+    param->data.parameter.symbol = symtable_lookup_parameter(parser->ctx.symbols, parser->ctx.current_function,
+                                              param->data.parameter.name);
+
     // Clean up
     ast_destroy_node(base_type);
     if (type_bounds) symtable_destroy_bounds(type_bounds);
@@ -4381,19 +4688,22 @@ static ASTNode* parse_parameter(Parser* parser) {
 static ASTNode* parse_record_type(Parser* parser, bool is_typedef) {
     ASTNode* record = ast_create_node(NODE_RECORD_TYPE);
     if (!record) return NULL;
+    RecordTypeData* record_data = ast_record_type(record);
+    if (!record_data) return NULL;
 
-    record->record_type.is_typedef = is_typedef;
-    record->record_type.is_nested = false; // Will be set to true by parent if nested
-    record->record_type.fields = NULL;
-    record->record_type.field_count = 0;
-    record->record_type.parent = NULL;
+    record_data->is_typedef = is_typedef;
+    record_data->is_nested = false; // Will be set to true by parent if nested
+    record_data->fields = NULL;
+    record_data->field_count = 0;
+    record_data->parent = NULL;
 
     // For non-typedef records in var declarations, create a temporary type name
     if (!is_typedef) {
-        static int anon_record_count = 0;
+        // Callers rename these, so the count only has to be per thread
+        static _Thread_local int anon_record_count = 0;
         char temp_name[32];
         snprintf(temp_name, sizeof(temp_name), "record_%d", anon_record_count++);
-        record->record_type.name = strdup(temp_name);
+        record_data->name = ast_strdup(temp_name);
     }
 
     // Parse fields until 'end'
@@ -4406,12 +4716,13 @@ static ASTNode* parse_record_type(Parser* parser, bool is_typedef) {
         
         // If this field contains a nested record, set up the parent-child relationship
         if (field->children[0] && field->children[0]->type == NODE_RECORD_TYPE) {
-            field->children[0]->record_type.parent = &record->record_type;
-            field->children[0]->record_type.is_nested = true;
+            RecordTypeData* nested = ast_record_type(field->children[0]);
+            nested->parent = record_data;
+            nested->is_nested = true;
             
             // Create name for nested record if not provided
-            //if (!field->children[0]->record_type.name) {
-            //    field->children[0]->record_type.name = strdup(field->data.variable.name);
+            //if (!nested->name) {
+            //    nested->name = strdup(field->data.variable.name);
             //}
         }
         
@@ -4437,7 +4748,7 @@ static ASTNode* parse_record_field(Parser* parser) {
     ASTNode* field = ast_create_node(NODE_RECORD_FIELD);
     if (!field) return NULL;
 
-    field->data.variable.name = strdup(name->value);
+    field->data.variable.name = ast_strdup(name->value);
     // Check if field is a nested record
     if (match(parser, TOK_RECORD)) {
         ASTNode* nested_record = parse_record_type(parser, false);
@@ -4446,10 +4757,11 @@ static ASTNode* parse_record_field(Parser* parser) {
             return NULL;
         }
         // Set the nested record's name to be the same as the field
-        //if (nested_record->record_type.name == NULL) {
-            nested_record->record_type.name = strdup(name->value);
+        RecordTypeData* nested = ast_record_type(nested_record);
+        //if (nested->name == NULL) {
+            nested->name = ast_strdup(name->value);
         //}
-        nested_record->record_type.is_nested = true;
+        nested->is_nested = true;
         ast_add_child(field, nested_record);
         return field;
     }
@@ -4462,7 +4774,7 @@ static ASTNode* parse_record_field(Parser* parser) {
         return NULL;
     }
 
-    field->data.variable.type = strdup(type->data.value);
+    field->data.variable.type = ast_strdup(type->data.value);
     field->data.variable.is_pointer = pointer_level > 0;
     field->data.variable.pointer_level = pointer_level;
     ast_destroy_node(type);
@@ -4491,8 +4803,8 @@ static ASTNode* parse_type_declaration(Parser* parser) {
     parser->ctx.current_record = NULL;
     if (!record) return NULL;
 
-    record->record_type.name = strdup(name->value);
-    //symtable_add_type(parser->ctx.symbols, name->value, &record->record_type);
+    ast_record_type(record)->name = ast_strdup(name->value);
+    //symtable_add_type(parser->ctx.symbols, name->value, ast_record_type(record));
     symtable_add_type(parser->ctx.symbols, name->value, record);
 
     ASTNode* type_decl = ast_create_node(NODE_TYPE_DECLARATION);
@@ -4,45 +4,128 @@
 #include "ast.h"
 #include "utils.h"
 #include "debug.h"
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// Hash function for symbol names
-static unsigned int hash(const char* str) {
-    unsigned int hash = 5381;
-    int c;
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c;
+#define NAME_BLOCK_SIZE (16 * 1024)
+#define MIN_NAME_SLOTS 64
+
+typedef struct {
+    uint32_t hash;
+    char text[];
+} InternedName;
+
+// FNV-1a
+static uint32_t hash_name(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* c = (const unsigned char*)name; *c; c++) {
+        hash = (hash ^ *c) * 16777619u;
     }
-    return hash % HASH_SIZE;
+    return hash;
 }
 
-static char* safe_strdup(const char* str) {
-    if (!str) return NULL;
-    char* dup = strdup(str);
-    if (!dup) {
-        error_report(ERROR_INTERNAL, SEVERITY_ERROR, 
-                    (SourceLocation){0, 0, "internal"},
-                    "Failed to allocate memory for string duplication");
+// Interned names carry their hash, so it is worked out once per name
+static uint32_t name_hash(const char* name) {
+    return ((const InternedName*)(name - offsetof(InternedName, text)))->hash;
+}
+
+static void pool_init(NamePool* pool) {
+    arena_init(&pool->strings, NAME_BLOCK_SIZE);
+    pool->slots = NULL;
+    pool->capacity = 0;
+    pool->count = 0;
+}
+
+static void pool_release(NamePool* pool) {
+    arena_release(&pool->strings);
+    free(pool->slots);
+    pool->slots = NULL;
+    pool->capacity = 0;
+    pool->count = 0;
+}
+
+static const char* pool_find(const NamePool* pool, const char* name, uint32_t hash) {
+    if (!pool->slots) return NULL;
+    size_t mask = pool->capacity - 1;
+    for (size_t i = hash & mask; pool->slots[i]; i = (i + 1) & mask) {
+        const char* interned = pool->slots[i];
+        if (name_hash(interned) == hash && strcmp(interned, name) == 0) return interned;
     }
-    return dup;
+    return NULL;
+}
+
+// Adds a name the pool doesn't have yet, keeping it at most half full
+static bool pool_insert(NamePool* pool, const char* interned) {
+    if ((pool->count + 1) * 2 > pool->capacity) {
+        size_t capacity = pool->capacity ? pool->capacity * 2 : MIN_NAME_SLOTS;
+        const char** slots = (const char**)calloc(capacity, sizeof(const char*));
+        if (!slots) return false;
+        for (size_t i = 0; i < pool->capacity; i++) {
+            const char* moved = pool->slots[i];
+            if (!moved) continue;
+            size_t j = name_hash(moved) & (capacity - 1);
+            while (slots[j]) j = (j + 1) & (capacity - 1);
+            slots[j] = moved;
+        }
+        free(pool->slots);
+        pool->slots = slots;
+        pool->capacity = capacity;
+    }
+
+    size_t mask = pool->capacity - 1;
+    size_t i = name_hash(interned) & mask;
+    while (pool->slots[i]) i = (i + 1) & mask;
+    pool->slots[i] = interned;
+    pool->count++;
+    return true;
+}
+
+// A fork looks in its own names, then in its table's
+static const char* find_name_hashed(const SymbolTable* table, const char* name, uint32_t hash) {
+    const char* interned = pool_find(&table->names, name, hash);
+    if (!interned && table->base) interned = pool_find(&table->base->names, name, hash);
+    return interned;
+}
+
+// The interned copy of name, or NULL if no symbol can be called that
+static const char* find_name(const SymbolTable* table, const char* name) {
+    return find_name_hashed(table, name, hash_name(name));
+}
+
+static const char* intern_name(SymbolTable* table, const char* name) {
+    uint32_t hash = hash_name(name);
+    const char* interned = find_name_hashed(table, name, hash);
+    if (interned) return interned;
+
+    size_t length = strlen(name);
+    InternedName* entry = (InternedName*)arena_alloc(&table->names.strings,
+                                                     sizeof(InternedName) + length + 1);
+    if (!entry) return NULL;
+    entry->hash = hash;
+    memcpy(entry->text, name, length + 1);
+    if (!pool_insert(&table->names, entry->text)) return NULL;
+    return entry->text;
 }
 
 // Create a new symbol
-static Symbol* symbol_create(const char* name, SymbolKind kind) {
+static Symbol* symbol_create(SymbolTable* table, const char* name, SymbolKind kind) {
     Symbol* symbol = (Symbol*)malloc(sizeof(Symbol));
     if (!symbol) return NULL;
 
-    symbol->name = safe_strdup(name);
+    symbol->name = intern_name(table, name);
     if (!symbol->name) {
+        error_report(ERROR_INTERNAL, SEVERITY_ERROR,
+                    (SourceLocation){0, 0, "internal"},
+                    "Failed to allocate memory for symbol name");
         free(symbol);
         return NULL;
     }
 
     symbol->kind = kind;
     symbol->scope = NULL;
-    symbol->next = NULL;
     memset(&symbol->info, 0, sizeof(symbol->info));
 
     // Initialize union based on kind
@@ -63,19 +146,36 @@ static Symbol* symbol_create(const char* name, SymbolKind kind) {
     return symbol;
 }
 
+// Frees a function's copies of its locals. They share their strings with
+// the locals in the function's scope, but have bounds of their own.
+static void release_local_copies(Symbol* func) {
+    for (int i = 0; i < func->info.func.local_var_count; i++) {
+        Symbol* local = func->info.func.local_variables[i];
+        if (local->info.var.is_array) symtable_destroy_bounds(local->info.var.bounds);
+        free(local);
+    }
+    free(func->info.func.local_variables);
+    func->info.func.local_variables = NULL;
+    func->info.func.local_var_count = 0;
+}
+
 static void symbol_destroy(Symbol* symbol) {
     if (!symbol) return;
     
-    free(symbol->name);
-    
     if (symbol->kind == SYMBOL_FUNCTION) {
         free(symbol->info.func.return_type);
         for (int i = 0; i < symbol->info.func.param_count; i++) {
             symbol_destroy(symbol->info.func.parameters[i]);
         }
         free(symbol->info.func.parameters);
+        release_local_copies(symbol);
     } else if (symbol->kind == SYMBOL_VARIABLE) {
         free(symbol->info.var.type);
+        symtable_destroy_bounds(symbol->info.var.bounds);
+    } else if (symbol->kind == SYMBOL_PARAMETER) {
+        free(symbol->info.var.type);
+        free(symbol->info.var.param_mode);
+        symtable_destroy_bounds(symbol->info.var.bounds);
     }
     
     free(symbol);
@@ -88,35 +188,196 @@ Scope* scope_create(ScopeType type, Scope* parent) {
 
     scope->type = type;
     scope->parent = parent;
-    scope->symbols = (Symbol**)calloc(HASH_SIZE, sizeof(Symbol*));
+    scope->symbols = NULL;
     scope->symbol_count = 0;
+    scope->symbol_capacity = 0;
+    scope->index = NULL;
+    scope->index_capacity = 0;
     scope->function_name = NULL;
+    scope->children = NULL;
+    scope->next_sibling = NULL;
 
-    if (!scope->symbols) {
-        free(scope);
-        return NULL;
+    return scope;
+}
+
+// Frees the scope's symbols, keeping the array for the next ones
+static void scope_clear(Scope* scope) {
+    for (int i = 0; i < scope->symbol_count; i++) {
+        debug_symbol_destroy(scope->symbols[i], "destroying scope and symbols");
+        symbol_destroy(scope->symbols[i]);
     }
+    scope->symbol_count = 0;
 
-    return scope;
+    free(scope->index);
+    scope->index = NULL;
+    scope->index_capacity = 0;
+    free(scope->function_name);
+    scope->function_name = NULL;
 }
 
 static void scope_destroy(Scope* scope) {
     if (!scope) return;
 
-    // Free all symbols in this scope
-    for (int i = 0; i < HASH_SIZE; i++) {
-        Symbol* current = scope->symbols[i];
-        while (current) {
-            Symbol* next = current->next;
-            debug_symbol_destroy(current, "destroying scope and symbols");
-            symbol_destroy(current);
-            current = next;
+    scope_clear(scope);
+    free(scope->symbols);
+    free(scope);
+}
+
+// Takes a scope from the pool if there is one
+static Scope* scope_acquire(SymbolTable* table, ScopeType type, Scope* parent) {
+    Scope* scope = table->free_scopes;
+    if (!scope) return scope_create(type, parent);
+
+    table->free_scopes = scope->next_sibling;
+    table->free_count--;
+    scope->type = type;
+    scope->parent = parent;
+    scope->children = NULL;
+    scope->next_sibling = NULL;
+    return scope;
+}
+
+static void scope_release(SymbolTable* table, Scope* scope) {
+    if (table->free_count >= MAX_POOLED_SCOPES) {
+        scope_destroy(scope);
+        return;
+    }
+    scope_clear(scope);
+    scope->parent = NULL;
+    scope->children = NULL;
+    scope->next_sibling = table->free_scopes;
+    table->free_scopes = scope;
+    table->free_count++;
+}
+
+// Releases everything below parent. Blocks nest as deep as the source does,
+// so this works through a list rather than recursing.
+static void release_children(SymbolTable* table, Scope* parent) {
+    Scope* pending = parent->children;
+    parent->children = NULL;
+    while (pending) {
+        Scope* scope = pending;
+        pending = scope->next_sibling;
+        if (scope->children) {
+            Scope* last = scope->children;
+            while (last->next_sibling) last = last->next_sibling;
+            last->next_sibling = pending;
+            pending = scope->children;
         }
+        scope_release(table, scope);
     }
+}
 
-    free(scope->symbols);
-    free(scope->function_name);
-    free(scope);
+// The scope after scope in a walk of root's subtree, parents first
+static Scope* next_in_tree(const Scope* root, Scope* scope) {
+    if (scope->children) return scope->children;
+    while (scope != root) {
+        if (scope->next_sibling) return scope->next_sibling;
+        scope = scope->parent;
+    }
+    return NULL;
+}
+
+// Points the index at symbols[position]; a newer symbol with the same name
+// takes over the older one's slot
+static void index_insert(Scope* scope, int position) {
+    const char* name = scope->symbols[position]->name;
+    int mask = scope->index_capacity - 1;
+    int i = (int)(name_hash(name) & (uint32_t)mask);
+    while (scope->index[i] && scope->symbols[scope->index[i] - 1]->name != name) {
+        i = (i + 1) & mask;
+    }
+    scope->index[i] = position + 1;
+}
+
+// Rebuilds the index at twice the symbol count, rounded up to a power of two
+static bool index_rebuild(Scope* scope) {
+    int capacity = SMALL_SCOPE_SIZE * 2;
+    while (capacity < scope->symbol_count * 2) capacity *= 2;
+    int* index = (int*)calloc((size_t)capacity, sizeof(int));
+    if (!index) return false;
+
+    free(scope->index);
+    scope->index = index;
+    scope->index_capacity = capacity;
+    for (int i = 0; i < scope->symbol_count; i++) {
+        index_insert(scope, i);
+    }
+    return true;
+}
+
+static bool scope_add(Scope* scope, Symbol* symbol) {
+    if (scope->symbol_count == scope->symbol_capacity) {
+        int capacity = scope->symbol_capacity ? scope->symbol_capacity * 2 : 4;
+        Symbol** symbols = (Symbol**)realloc(scope->symbols, (size_t)capacity * sizeof(Symbol*));
+        if (!symbols) return false;
+        scope->symbols = symbols;
+        scope->symbol_capacity = capacity;
+    }
+
+    symbol->scope = scope;
+    scope->symbols[scope->symbol_count++] = symbol;
+    if (scope->symbol_count <= SMALL_SCOPE_SIZE) return true;
+    if (!scope->index || scope->symbol_count * 2 > scope->index_capacity) {
+        // Small scopes are scanned anyway, so a failed index can wait
+        if (!index_rebuild(scope)) {
+            free(scope->index);
+            scope->index = NULL;
+        }
+        return true;
+    }
+    index_insert(scope, scope->symbol_count - 1);
+    return true;
+}
+
+// The newest of the scope's first limit symbols called name, which has to
+// be interned
+static Symbol* scope_find(const Scope* scope, const char* name, int limit) {
+    if (scope->index) {
+        int mask = scope->index_capacity - 1;
+        int position = 0;
+        for (int i = (int)(name_hash(name) & (uint32_t)mask); scope->index[i]; i = (i + 1) & mask) {
+            if (scope->symbols[scope->index[i] - 1]->name == name) {
+                position = scope->index[i];
+                break;
+            }
+        }
+        if (position == 0) return NULL;
+        if (position <= limit) return scope->symbols[position - 1];
+        // Added after limit, but an older one may come before it
+    }
+
+    for (int i = limit - 1; i >= 0; i--) {
+        if (scope->symbols[i]->name == name) return scope->symbols[i];
+    }
+    return NULL;
+}
+
+// Globals, including the ones a fork sees in its table
+static Symbol* find_global(const SymbolTable* table, const char* name) {
+    Symbol* symbol = scope_find(table->global, name, table->global->symbol_count);
+    if (!symbol && table->base) {
+        symbol = scope_find(table->base->global, name, table->shared_count);
+    }
+    return symbol;
+}
+
+static Symbol* find_in_scope(const SymbolTable* table, const Scope* scope, const char* name) {
+    if (scope == table->global) return find_global(table, name);
+    return scope_find(scope, name, scope->symbol_count);
+}
+
+// A global by name; unlike symtable_lookup_global(), not counted
+static Symbol* find_global_named(const SymbolTable* table, const char* name) {
+    const char* interned = find_name(table, name);
+    return interned ? find_global(table, interned) : NULL;
+}
+
+// A function or procedure by name
+static Symbol* find_function(const SymbolTable* table, const char* name) {
+    Symbol* func = find_global_named(table, name);
+    if (func && func->kind != SYMBOL_FUNCTION && func->kind != SYMBOL_PROCEDURE) return NULL;
+    return func;
 }
 
 // Symbol table operations
@@ -132,6 +393,12 @@ SymbolTable* symtable_create(void) {
 
     table->current = table->global;
     table->scope_level = 0;
+    pool_init(&table->names);
+    table->base = NULL;
+    table->shared_count = 0;
+    table->free_scopes = NULL;
+    table->free_count = 0;
+    table->lookups = 0;
 
     return table;
 }
@@ -139,27 +406,105 @@ SymbolTable* symtable_create(void) {
 void symtable_destroy(SymbolTable* table) {
     if (!table) return;
 
-    // Start from the current scope and move up to global
-    while (table->current && table->current != table->global) {
-        Scope* parent = table->current->parent;
-        scope_destroy(table->current);
-        table->current = parent;
+    // The globals go first, as their debug output can still name the
+    // scopes below them
+    Scope* global = table->global;
+    scope_clear(global);
+    release_children(table, global);
+    scope_destroy(global);
+    while (table->free_scopes) {
+        Scope* next = table->free_scopes->next_sibling;
+        scope_destroy(table->free_scopes);
+        table->free_scopes = next;
     }
-
-    scope_destroy(table->global);
+    // Last, as every symbol's name lives here
+    pool_release(&table->names);
     free(table);
 }
 
+SymbolTable* symtable_fork(const SymbolTable* table) {
+    if (!table) return NULL;
+
+    SymbolTable* fork = symtable_create();
+    if (!fork) return NULL;
+
+    fork->base = table;
+    fork->shared_count = table->global->symbol_count;
+    return fork;
+}
+
+// Points symbol at the table's copy of its name
+static void rename_symbol(const SymbolTable* table, Symbol* symbol) {
+    const char* interned = pool_find(&table->names, symbol->name, name_hash(symbol->name));
+    if (interned) symbol->name = interned;
+}
+
+static void rename_function(const SymbolTable* table, Symbol* func) {
+    rename_symbol(table, func);
+    if (func->kind != SYMBOL_FUNCTION && func->kind != SYMBOL_PROCEDURE) return;
+    for (int i = 0; i < func->info.func.param_count; i++) {
+        rename_symbol(table, func->info.func.parameters[i]);
+    }
+    for (int i = 0; i < func->info.func.local_var_count; i++) {
+        rename_symbol(table, func->info.func.local_variables[i]);
+    }
+}
+
+bool symtable_join(SymbolTable* table, SymbolTable* fork) {
+    if (!table || !fork || fork->base != table) return false;
+
+    // Check every name first, so a clash leaves both tables as they were
+    Scope* globals = fork->global;
+    for (int i = 0; i < globals->symbol_count; i++) {
+        if (find_global_named(table, globals->symbols[i]->name)) return false;
+    }
+
+    // The fork's new names move over, and its symbols switch to the
+    // table's copy of any name both of them interned
+    for (size_t i = 0; i < fork->names.capacity; i++) {
+        const char* name = fork->names.slots[i];
+        if (name && !pool_find(&table->names, name, name_hash(name))) {
+            pool_insert(&table->names, name);
+        }
+    }
+    arena_merge(&table->names.strings, &fork->names.strings);
+    table->lookups += fork->lookups;
+    for (int i = 0; i < globals->symbol_count; i++) {
+        rename_function(table, globals->symbols[i]);
+        scope_add(table->global, globals->symbols[i]);
+    }
+    globals->symbol_count = 0;
+
+    // The joined parameters still point at the scopes below the fork's
+    // global one, so those move over too
+    for (Scope* scope = next_in_tree(globals, globals); scope; scope = next_in_tree(globals, scope)) {
+        for (int i = 0; i < scope->symbol_count; i++) {
+            rename_symbol(table, scope->symbols[i]);
+        }
+    }
+    while (globals->children) {
+        Scope* scope = globals->children;
+        globals->children = scope->next_sibling;
+        scope->parent = table->global;
+        scope->next_sibling = table->global->children;
+        table->global->children = scope;
+    }
+
+    symtable_destroy(fork);
+    return true;
+}
+
 void symtable_enter_scope(SymbolTable* table, ScopeType type) {
-    if (!table || table->scope_level >= MAX_SCOPE_DEPTH) {
-        debug_symbol_table_operation("Enter Scope Failed", "Maximum depth exceeded or invalid table");
+    // Scopes are linked through their parents, so depth is limited only by memory
+    if (!table) {
+        debug_symbol_table_operation("Enter Scope Failed", "Invalid table");
         error_report(ERROR_INTERNAL, SEVERITY_ERROR, 
                     (SourceLocation){0, 0, "internal"},
-                    "Maximum scope depth exceeded");
+                    "Cannot enter scope");
         return;
     }
 
-    Scope* new_scope = scope_create(type, table->current);
+    Scope* new_scope = scope_acquire(table, type, table->current);
     if (!new_scope) {
         debug_symbol_table_operation("Enter Scope Failed", "Failed to create new scope");
         error_report(ERROR_INTERNAL, SEVERITY_ERROR, 
@@ -169,6 +514,8 @@ void symtable_enter_scope(SymbolTable* table, ScopeType type) {
     }
 
     debug_scope_enter(new_scope, "entering new scope");
+    new_scope->next_sibling = table->current->children;
+    table->current->children = new_scope;
     table->current = new_scope;
     table->scope_level++;
 }
@@ -187,7 +534,48 @@ void symtable_exit_scope(SymbolTable* table) {
     Scope* old_scope = table->current;
     table->current = old_scope->parent;
     table->scope_level--;
-    //scope_destroy(old_scope);
+    // Nothing can refer to an empty block, which is still its parent's
+    // newest child
+    if (old_scope->type == SCOPE_BLOCK && old_scope->symbol_count == 0 &&
+        !old_scope->children && table->current->children == old_scope) {
+        table->current->children = old_scope->next_sibling;
+        scope_release(table, old_scope);
+    }
+}
+
+void symtable_exit_to_scope(SymbolTable* table, Scope* scope) {
+    if (!table) return;
+    while (table->current != scope && table->current != table->global) {
+        symtable_exit_scope(table);
+    }
+}
+
+void symtable_resume_scope(SymbolTable* table, Scope* scope) {
+    if (!table || !scope) {
+        debug_symbol_table_operation("Resume Scope Failed", "Invalid table or scope");
+        error_report(ERROR_INTERNAL, SEVERITY_ERROR,
+                    (SourceLocation){0, 0, "internal"},
+                    "Cannot resume scope");
+        return;
+    }
+
+    debug_scope_enter(scope, "resuming scope");
+    table->current = scope;
+    table->scope_level++;
+}
+
+void symtable_release_function(SymbolTable* table, const char* name) {
+    if (!table || table->current != table->global) return;
+
+    Symbol* func = name ? find_global_named(table, name) : NULL;
+    if (func && (func->kind == SYMBOL_FUNCTION || func->kind == SYMBOL_PROCEDURE)) {
+        for (int i = 0; i < func->info.func.param_count; i++) {
+            func->info.func.parameters[i]->scope = NULL;
+            func->info.func.parameters[i]->node = NULL;
+        }
+        release_local_copies(func);
+    }
+    release_children(table, table->global);
 }
 
 static void deep_copy_var_info(VariableInfo* dest, const VariableInfo* src) {
@@ -241,20 +629,16 @@ Symbol* symtable_add_variable(SymbolTable* table, const char* name, const char*
     if (!table || !name || !type) return NULL;
 
     // Check if variable already exists in current scope
-    unsigned int h = hash(name);
-    Symbol* existing = table->current->symbols[h];
-    while (existing) {
-        if (strcmp(existing->name, name) == 0) {            
-            debug_symbol_table_operation("Variable Already Exists", name);
-            error_report(ERROR_SEMANTIC, SEVERITY_ERROR,
-                        (SourceLocation){0, 0, "internal"},
-                        "Variable '%s' already declared in current scope", name);
-            return NULL;
-        }
-        existing = existing->next;
+    const char* interned = find_name(table, name);
+    if (interned && find_in_scope(table, table->current, interned)) {
+        debug_symbol_table_operation("Variable Already Exists", name);
+        error_report(ERROR_SEMANTIC, SEVERITY_ERROR,
+                    (SourceLocation){0, 0, "internal"},
+                    "Variable '%s' already declared in current scope", name);
+        return NULL;
     }
 
-    Symbol* symbol = symbol_create(name, SYMBOL_VARIABLE);
+    Symbol* symbol = symbol_create(table, name, SYMBOL_VARIABLE);
     if (!symbol) return NULL;
 
     symbol->info.var.type = strdup(type);
@@ -264,11 +648,10 @@ Symbol* symtable_add_variable(SymbolTable* table, const char* name, const char*
     symbol->info.var.initialized = false;
 
     // Add to current scope
-    symbol->scope = table->current;
-    symbol->next = table->current->symbols[h];
-    
-    table->current->symbols[h] = symbol;
-    table->current->symbol_count++;
+    if (!scope_add(table->current, symbol)) {
+        symbol_destroy(symbol);
+        return NULL;
+    }
 
     if (table->current->type == SCOPE_FUNCTION || 
         (table->current->type == SCOPE_BLOCK && table->current->function_name)) {
@@ -294,19 +677,15 @@ Symbol* symtable_add_function(SymbolTable* table, const char* name,
     }
 
     // Check if function already exists
-    unsigned int h = hash(name);
-    Symbol* existing = table->global->symbols[h];
-    while (existing) {
-        if (strcmp(existing->name, name) == 0) {
-            error_report(ERROR_SEMANTIC, SEVERITY_ERROR,
-                        (SourceLocation){0, 0, "internal"},
-                        "Function '%s' already declared", name);
-            return NULL;
-        }
-        existing = existing->next;
+    const char* interned = find_name(table, name);
+    if (interned && find_global(table, interned)) {
+        error_report(ERROR_SEMANTIC, SEVERITY_ERROR,
+                    (SourceLocation){0, 0, "internal"},
+                    "Function '%s' already declared", name);
+        return NULL;
     }
 
-    Symbol* symbol = symbol_create(name, SYMBOL_FUNCTION);
+    Symbol* symbol = symbol_create(table, name, SYMBOL_FUNCTION);
     if (!symbol) return NULL;
 
     symbol->info.func.return_type = return_type ? strdup(return_type) : NULL;
@@ -316,10 +695,10 @@ Symbol* symtable_add_function(SymbolTable* table, const char* name,
     symbol->info.func.has_return_var = false;
 
     // Add to global scope
-    symbol->scope = table->global;
-    symbol->next = table->global->symbols[h];
-    table->global->symbols[h] = symbol;
-    table->global->symbol_count++;
+    if (!scope_add(table->global, symbol)) {
+        symbol_destroy(symbol);
+        return NULL;
+    }
     debug_symbol_create(symbol, "adding new function to global scope");
     debug_symbol_table_operation("Variable Added Successfully", name);
 
@@ -412,20 +791,16 @@ Symbol* symtable_add_array(SymbolTable* table, const char* name, const char* ele
     }
 
     // Check if variable already exists in current scope
-    unsigned int h = hash(name);
-    Symbol* existing = table->current->symbols[h];
-    while (existing) {
-        if (strcmp(existing->name, name) == 0) {
-            error_report(ERROR_SEMANTIC, SEVERITY_ERROR,
-                        (SourceLocation){0, 0, "internal"},
-                        "Variable '%s' already declared in current scope", name);
-            return NULL;
-        }
-        existing = existing->next;
+    const char* interned = find_name(table, name);
+    if (interned && find_in_scope(table, table->current, interned)) {
+        error_report(ERROR_SEMANTIC, SEVERITY_ERROR,
+                    (SourceLocation){0, 0, "internal"},
+                    "Variable '%s' already declared in current scope", name);
+        return NULL;
     }
 
     // Create the symbol
-    Symbol* symbol = symbol_create(name, SYMBOL_VARIABLE);
+    Symbol* symbol = symbol_create(table, name, SYMBOL_VARIABLE);
     if (!symbol) {
         verbose_print("Failed to create symbol\n");
         return NULL;
@@ -468,10 +843,10 @@ Symbol* symtable_add_array(SymbolTable* table, const char* name, const char* ele
     }
 
     // Add to current scope
-    symbol->scope = table->current;
-    symbol->next = table->current->symbols[h];
-    table->current->symbols[h] = symbol;
-    table->current->symbol_count++;
+    if (!scope_add(table->current, symbol)) {
+        symbol_destroy(symbol);
+        return NULL;
+    }
 
     verbose_print("Successfully added array to symbol table\n");
     verbose_print("Current scope: %s\n", 
@@ -543,28 +918,24 @@ void symtable_update_parameter_bounds_in_global(SymbolTable* table, const char*
                  param_name, table->current->function_name);
 
     // Find function in global scope
-    unsigned int h = hash(table->current->function_name);
-    Symbol* func = table->global->symbols[h];
-    while (func) {
-        if (strcmp(func->name, table->current->function_name) == 0) {
-            // Find parameter in function's parameter list
-            for (int i = 0; i < func->info.func.param_count; i++) {
-                Symbol* param = func->info.func.parameters[i];
-                if (strcmp(param->name, param_name) == 0) {
-                    // Update bounds in global copy
-                    if (param->info.var.bounds) {
-                        symtable_destroy_bounds(param->info.var.bounds);
-                    }
-                    param->info.var.bounds = symtable_clone_bounds(bounds);
-                    param->info.var.dimensions = bounds->dimensions;
-                    verbose_print("Successfully updated bounds for parameter %s in global scope\n", param_name);
-                    debug_symbol_bounds_update(param, bounds, "updating symbol array bounds");
-                    return;
-                }
+    const char* interned = find_name(table, param_name);
+    Symbol* func = find_function(table, table->current->function_name);
+    if (!interned || !func) return;
+
+    // Find parameter in function's parameter list
+    for (int i = 0; i < func->info.func.param_count; i++) {
+        Symbol* param = func->info.func.parameters[i];
+        if (param->name == interned) {
+            // Update bounds in global copy
+            if (param->info.var.bounds) {
+                symtable_destroy_bounds(param->info.var.bounds);
             }
-            break;
+            param->info.var.bounds = symtable_clone_bounds(bounds);
+            param->info.var.dimensions = bounds->dimensions;
+            verbose_print("Successfully updated bounds for parameter %s in global scope\n", param_name);
+            debug_symbol_bounds_update(param, bounds, "updating symbol array bounds");
+            return;
         }
-        func = func->next;
     }
 }
 
@@ -575,40 +946,34 @@ void symtable_add_local_to_function(SymbolTable* table, const char* function_nam
                  local_var->name, function_name);
 
     // Find function in global scope
-    unsigned int h = hash(function_name);
-    Symbol* func = table->global->symbols[h];
-    while (func) {
-        if (strcmp(func->name, function_name) == 0 && 
-            (func->kind == SYMBOL_FUNCTION || func->kind == SYMBOL_PROCEDURE)) {
-            // Create new local variables array or extend existing one
-            Symbol** new_locals = realloc(func->info.func.local_variables,
-                                        (func->info.func.local_var_count + 1) * sizeof(Symbol*));
-            if (new_locals) {
-                func->info.func.local_variables = new_locals;
+    Symbol* func = find_function(table, function_name);
+    if (func) {
+        // Create new local variables array or extend existing one
+        Symbol** new_locals = realloc(func->info.func.local_variables,
+                                    (func->info.func.local_var_count + 1) * sizeof(Symbol*));
+        if (new_locals) {
+            func->info.func.local_variables = new_locals;
+            
+            // Create a copy of the local variable
+            Symbol* local_copy = symbol_create(table, local_var->name, local_var->kind);
+            if (local_copy) {
+                // Copy all variable info
+                memcpy(&local_copy->info, &local_var->info, sizeof(local_var->info));
+                if (local_var->info.var.is_array && local_var->info.var.bounds) {
+                    local_copy->info.var.bounds = symtable_clone_bounds(local_var->info.var.bounds);
+                }
+                local_copy->scope = local_var->scope;
+                
+                // Store in function's local variables list
+                func->info.func.local_variables[func->info.func.local_var_count++] = local_copy;
+                verbose_print("Successfully added local variable to function\n");
                 
-                // Create a copy of the local variable
-                Symbol* local_copy = symbol_create(local_var->name, local_var->kind);
-                if (local_copy) {
-                    // Copy all variable info
-                    memcpy(&local_copy->info, &local_var->info, sizeof(local_var->info));
-                    if (local_var->info.var.is_array && local_var->info.var.bounds) {
-                        local_copy->info.var.bounds = symtable_clone_bounds(local_var->info.var.bounds);
-                    }
-                    local_copy->scope = local_var->scope;
-                    
-                    // Store in function's local variables list
-                    func->info.func.local_variables[func->info.func.local_var_count++] = local_copy;
-                    verbose_print("Successfully added local variable to function\n");
-                    
-                    // Debug print bounds if it's an array
-                    if (local_copy->info.var.is_array && local_copy->info.var.bounds) {
-                        debug_print_bounds("Local variable copy", local_copy);
-                    }
+                // Debug print bounds if it's an array
+                if (local_copy->info.var.is_array && local_copy->info.var.bounds) {
+                    debug_print_bounds("Local variable copy", local_copy);
                 }
             }
-            break;
         }
-        func = func->next;
     }
 
     debug_symbol_create(local_var, "adding new local variable to function in global scope");
@@ -623,7 +988,7 @@ Symbol* symtable_add_parameter(SymbolTable* table, const char* name, const char*
                  table->current->type == SCOPE_GLOBAL ? "GLOBAL" : "OTHER");
     verbose_print("Current function: %s\n", 
                  table->current->function_name ? table->current->function_name : "NULL");
-    Symbol* param = symbol_create(name, SYMBOL_PARAMETER);
+    Symbol* param = symbol_create(table, name, SYMBOL_PARAMETER);
     if (!param) return NULL;
 
     param->node = node;
@@ -656,59 +1021,49 @@ Symbol* symtable_add_parameter(SymbolTable* table, const char* name, const char*
     }
 
     // Add to current scope (for local use)
-    unsigned int h = hash(name);
-    param->scope = table->current;
-    param->next = table->current->symbols[h];
-    table->current->symbols[h] = param;
+    if (!scope_add(table->current, param)) {
+        symbol_destroy(param);
+        return NULL;
+    }
 
-    // Store reference to the parameter for later update
-    Symbol* global_param_copy = NULL;
-    
     // Also add to function's parameter list
-    if (table->current->function_name) {
-        verbose_print("Looking for function %s in global scope\n", table->current->function_name);
-        h = hash(table->current->function_name);
-        Symbol* func = table->global->symbols[h];
-        while (func) {
-            if (strcmp(func->name, table->current->function_name) == 0 &&
-                (func->kind == SYMBOL_FUNCTION || func->kind == SYMBOL_PROCEDURE)) {
-                verbose_print("Found function, current param count: %d\n", func->info.func.param_count);
+    Symbol* func = table->current->function_name ? find_function(table, table->current->function_name) : NULL;
+    if (func) {
+        verbose_print("Found function, current param count: %d\n", func->info.func.param_count);
+        
+        // Create new parameter array or extend existing one
+        Symbol** new_params = realloc(func->info.func.parameters, (func->info.func.param_count + 1) * sizeof(Symbol*));
+        if (new_params) {
+            func->info.func.parameters = new_params;
+            // Store a copy of the parameter in the function's parameter list
+            Symbol* global_param_copy = symbol_create(table, name, SYMBOL_PARAMETER);
+            if (global_param_copy) {
+                deep_copy_var_info(&global_param_copy->info.var, &param->info.var);
+                if (type) {
+                    free(global_param_copy->info.var.type);
+                    global_param_copy->info.var.type = strdup(type);
+                }
+                global_param_copy->scope = param->scope;
+                global_param_copy->node = node;
+                global_param_copy->info.var.needs_type_declaration = (type == NULL);
                 
-                // Create new parameter array or extend existing one
-                Symbol** new_params = realloc(func->info.func.parameters, (func->info.func.param_count + 1) * sizeof(Symbol*));
-                if (new_params) {
-                    func->info.func.parameters = new_params;
-                    // Store a copy of the parameter in the function's parameter list
-                    Symbol* global_param_copy = symbol_create(name, SYMBOL_PARAMETER);
-                    if (global_param_copy) {
-                        deep_copy_var_info(&global_param_copy->info.var, &param->info.var);
-                        if (type)
-                            global_param_copy->info.var.type = strdup(type);
-                        global_param_copy->scope = param->scope;
-                        global_param_copy->node = node;
-                        global_param_copy->info.var.needs_type_declaration = (type == NULL);
-                        
-                        if (is_array || !needs_deref) {
-                            global_param_copy->info.var.needs_deref = false;
-                        } else if (strcasecmp(mode, "out") == 0 || strcasecmp(mode, "inout") == 0) {
-                            global_param_copy->info.var.needs_deref = true;
-                        }
-
-                        // Store in function's parameter list
-                        func->info.func.parameters[func->info.func.param_count++] = global_param_copy;
-                        verbose_print("Added parameter to function's parameter list (new count: %d)\n",
-                                    func->info.func.param_count);
-                        
-                        // Debug bounds information
-                        if (global_param_copy->info.var.is_array && global_param_copy->info.var.bounds) {
-                            verbose_print("Parameter copy has bounds with %d dimensions\n",
-                                        global_param_copy->info.var.dimensions);
-                        }
-                    }
+                if (is_array || !needs_deref) {
+                    global_param_copy->info.var.needs_deref = false;
+                } else if (strcasecmp(mode, "out") == 0 || strcasecmp(mode, "inout") == 0) {
+                    global_param_copy->info.var.needs_deref = true;
+                }
+
+                // Store in function's parameter list
+                func->info.func.parameters[func->info.func.param_count++] = global_param_copy;
+                verbose_print("Added parameter to function's parameter list (new count: %d)\n",
+                            func->info.func.param_count);
+                
+                // Debug bounds information
+                if (global_param_copy->info.var.is_array && global_param_copy->info.var.bounds) {
+                    verbose_print("Parameter copy has bounds with %d dimensions\n",
+                                global_param_copy->info.var.dimensions);
                 }
-                break;
             }
-            func = func->next;
         }
     }
 
@@ -720,30 +1075,27 @@ Symbol* symtable_add_parameter(SymbolTable* table, const char* name, const char*
 Symbol* symtable_lookup_parameter(SymbolTable* table, const char* function_name, const char* param_name) {
     if (!table || !function_name || !param_name) return NULL;
     verbose_print("Looking up parameter %s in function %s\n", param_name, function_name);
+    table->lookups++;
 
     // Find function in global scope
-    unsigned int h = hash(function_name);
-    Symbol* func = table->global->symbols[h];
-    while (func) {
-        if (strcmp(func->name, function_name) == 0 && 
-            (func->kind == SYMBOL_FUNCTION || func->kind == SYMBOL_PROCEDURE)) {
-            verbose_print("Found function %s with %d parameters\n", 
-                         function_name, func->info.func.param_count);
-            
-            // Search through function parameters
-            for (int i = 0; i < func->info.func.param_count; i++) {
-                Symbol* param = func->info.func.parameters[i];
-                if (param && strcmp(param->name, param_name) == 0) {
-                    verbose_print("Found parameter %s\n", param_name);
-                    return param;
-                }
-            }
-            verbose_print("Parameter %s not found in function's parameter list\n", param_name);
-            break;
+    Symbol* func = find_function(table, function_name);
+    if (!func) {
+        verbose_print("Function %s not found in global scope\n", function_name);
+        return NULL;
+    }
+    verbose_print("Found function %s with %d parameters\n", 
+                 function_name, func->info.func.param_count);
+    
+    // Search through function parameters
+    const char* interned = find_name(table, param_name);
+    for (int i = 0; interned && i < func->info.func.param_count; i++) {
+        Symbol* param = func->info.func.parameters[i];
+        if (param && param->name == interned) {
+            verbose_print("Found parameter %s\n", param_name);
+            return param;
         }
-        func = func->next;
     }
-    verbose_print("Function %s not found in global scope\n", function_name);
+    verbose_print("Parameter %s not found in function's parameter list\n", param_name);
     return NULL;
 }
 
@@ -754,21 +1106,16 @@ Symbol* symtable_lookup(SymbolTable* table, const char* name) {
         debug_symbol_table_operation("Lookup Failed", "Invalid parameters");
         return NULL;
     }
-
-    unsigned int h = hash(name);
-    Scope* scope = table->current;
-
-    // Search through all scopes starting from current
-    while (scope) {
-        Symbol* symbol = scope->symbols[h];
-        while (symbol) {
-            if (strcmp(symbol->name, name) == 0) {
-                debug_symbol_lookup(name, symbol, "found in scope");
-                return symbol;
-            }
-            symbol = symbol->next;
+    table->lookups++;
+
+    // A name that was never interned can't be in any scope
+    const char* interned = find_name(table, name);
+    for (Scope* scope = table->current; interned && scope; scope = scope->parent) {
+        Symbol* symbol = find_in_scope(table, scope, interned);
+        if (symbol) {
+            debug_symbol_lookup(name, symbol, "found in scope");
+            return symbol;
         }
-        scope = scope->parent;
     }
 
     verbose_print("symbol %s not found in global scope\n", name);
@@ -781,31 +1128,16 @@ Symbol* symtable_lookup_global(SymbolTable* table, const char* name) {
     if (!table || !name || !table->global) return NULL;
     
     verbose_print("Looking up symbol %s in global scope only\n", name);
-    unsigned int h = hash(name);
-    Symbol* symbol = table->global->symbols[h];
-    
-    while (symbol) {
-        if (strcmp(symbol->name, name) == 0) {
-            return symbol;
-        }
-        symbol = symbol->next;
-    }
-    return NULL;
+    table->lookups++;
+    return find_global_named(table, name);
 }
 
 Symbol* symtable_lookup_current_scope(SymbolTable* table, const char* name) {
     if (!table || !name) return NULL;
+    table->lookups++;
 
-    unsigned int h = hash(name);
-    Symbol* symbol = table->current->symbols[h];
-    while (symbol) {
-        if (strcmp(symbol->name, name) == 0) {
-            return symbol;
-        }
-        symbol = symbol->next;
-    }
-
-    return NULL;
+    const char* interned = find_name(table, name);
+    return interned ? find_in_scope(table, table->current, interned) : NULL;
 }
 
 bool symtable_is_type_compatible(const char* type1, const char* type2) {
@@ -823,25 +1155,22 @@ void symtable_print_current_scope(SymbolTable* table) {
     if (!table || !table->current) return;
 
     verbose_print("Current Scope (level %d):\n", table->scope_level);
-    for (int i = 0; i < HASH_SIZE; i++) {
+    for (int i = 0; i < table->current->symbol_count; i++) {
         Symbol* symbol = table->current->symbols[i];
-        while (symbol) {
-            verbose_print("  %s: ", symbol->name);
-            switch (symbol->kind) {
-                case SYMBOL_VARIABLE:
-                    verbose_print("Variable (type: %s%s)\n", 
-                           symbol->info.var.type,
-                           symbol->info.var.is_array ? "[]" : "");
-                    break;
-                case SYMBOL_FUNCTION:
-                    verbose_print("Function (returns: %s)\n",
-                           symbol->info.func.return_type ?
-                           symbol->info.func.return_type : "void");
-                    break;
-                default:
-                    verbose_print("Unknown symbol kind\n");
-            }
-            symbol = symbol->next;
+        verbose_print("  %s: ", symbol->name);
+        switch (symbol->kind) {
+            case SYMBOL_VARIABLE:
+                verbose_print("Variable (type: %s%s)\n", 
+                       symbol->info.var.type,
+                       symbol->info.var.is_array ? "[]" : "");
+                break;
+            case SYMBOL_FUNCTION:
+                verbose_print("Function (returns: %s)\n",
+                       symbol->info.func.return_type ?
+                       symbol->info.func.return_type : "void");
+                break;
+            default:
+                verbose_print("Unknown symbol kind\n");
         }
     }
 }
@@ -902,7 +1231,7 @@ void record_add_field(ASTNode* child, RecordTypeData* record_data) {
     size_t new_capacity = (record_data->field_count + 1) * 2;
     RecordField** new_fields = (RecordField**)realloc(record_data->fields, new_capacity * sizeof(RecordField*));
     if (!new_fields) {
-        error_report(ERROR_INTERNAL, SEVERITY_ERROR, child->loc,
+        error_report(ERROR_INTERNAL, SEVERITY_ERROR, ast_location(child),
                     "Failed to allocate memory for record fields");
         return;
     }
@@ -910,7 +1239,12 @@ void record_add_field(ASTNode* child, RecordTypeData* record_data) {
 
     record_data->fields[record_data->field_count] = malloc(sizeof(RecordField));
     record_data->fields[record_data->field_count]->record_type = malloc(sizeof(RecordTypeData));
-    *record_data->fields[record_data->field_count]->record_type = child->record_type;
+    RecordTypeData* child_record = ast_record_type(child);
+    if (child_record) {
+        *record_data->fields[record_data->field_count]->record_type = *child_record;
+    } else {
+        memset(record_data->fields[record_data->field_count]->record_type, 0, sizeof(RecordTypeData));
+    }
     if (child->data.value)
         record_data->fields[record_data->field_count]->record_type->name = child->data.value;
     record_data->field_count++;
@@ -926,19 +1260,19 @@ void recursive_add_field(ASTNode* parent, RecordTypeData* record_data) {
 Symbol* symtable_add_type(SymbolTable* table, const char* name, ASTNode* record) {
     if (!table || !name || !record) return NULL;
 
-    RecordTypeData* record_type = &record->record_type;
-    Symbol* symbol = symbol_create(name, SYMBOL_TYPE);
+    RecordTypeData* record_type = ast_record_type(record);
+    if (!record_type) return NULL;
+    Symbol* symbol = symbol_create(table, name, SYMBOL_TYPE);
     if (!symbol) return NULL;
 
     symbol->info.record = *record_type;
     recursive_add_field(record, &symbol->info.record);
     
     // Add to current scope
-    unsigned int h = hash(name);
-    symbol->scope = table->current;
-    symbol->next = table->current->symbols[h];
-    table->current->symbols[h] = symbol;
-    table->current->symbol_count++;
+    if (!scope_add(table->current, symbol)) {
+        symbol_destroy(symbol);
+        return NULL;
+    }
 
     return symbol;
 }
@@ -965,15 +1299,12 @@ void symtable_debug_dump_scope(Scope* scope, int level) {
         verbose_print("Function name: %s\n", scope->function_name);
     }
     
-    for (int i = 0; i < HASH_SIZE; i++) {
-        Symbol* sym = scope->symbols[i];
-        while (sym) {
-            symtable_debug_dump_symbol(sym, level + 1);
-            sym = sym->next;
-        }
+    for (int i = 0; i < scope->symbol_count; i++) {
+        symtable_debug_dump_symbol(scope->symbols[i], level + 1);
     }
 }
 
+#ifndef PLIKE_RELEASE
 void symtable_debug_dump_all(SymbolTable* table) {
     if (!table) return;
     
@@ -990,4 +1321,5 @@ void symtable_debug_dump_all(SymbolTable* table) {
         symtable_debug_dump_scope(table->current, 0);
     }
     verbose_print("\n=== END SYMBOL TABLE DUMP ===\n\n");
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <time.h>
 
 /*static void print_usage(const char* program_name) {
     fprintf(stderr, "Usage: %s [options] input_file [output_file]\n", program_name);
@@ -44,6 +45,79 @@
     return flags;
 }*/
 
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// With --stats, how much of parsing went to skipping ahead after errors
+static void print_recovery_stats(const Parser* parser, double parse_seconds) {
+    RecoveryStats recovery = parser_recovery_stats(parser);
+    if (!g_config.print_stats || recovery.recoveries == 0) return;
+    fprintf(stderr, "Error recovery: %zu times, %zu tokens skipped, %zu cascaded errors not reported\n",
+            recovery.recoveries, recovery.skipped, recovery.suppressed);
+    fprintf(stderr, "  %.3f ms of %.3f ms parsing (%.1f%%)\n", recovery.seconds * 1e3,
+            parse_seconds * 1e3, parse_seconds > 0 ? 100 * recovery.seconds / parse_seconds : 0.0);
+}
+
+// With --stats, how many names were looked up in the symbol table while
+// parsing and while generating code, per thousand lines translated
+static void print_lookup_stats(const Parser* parser, size_t parse_lookups, size_t generate_lookups) {
+    if (!g_config.print_stats) return;
+    double kloc = lexer_lines_scanned(parser->ctx.lexer) / 1000.0;
+    if (kloc <= 0) kloc = 1;
+    fprintf(stderr, "Symbol lookups: %zu parsing (%.1f per KLOC), %zu generating code (%.1f per KLOC)\n",
+            parse_lookups, parse_lookups / kloc, generate_lookups, generate_lookups / kloc);
+}
+
+// Parses, generates and frees one top-level declaration at a time. After
+// an error nothing more is generated and the output is removed, as a
+// failed translation writes none.
+static int translate_streaming(Parser* parser) {
+    FILE* output = fopen(g_config.output_filename, "w");
+    if (!output) {
+        fprintf(stderr, "Failed to open output file: %s\n", g_config.output_filename);
+        return 1;
+    }
+
+    CodeGenerator* codegen = codegen_create(output, parser->ctx.symbols);
+    if (!codegen) {
+        fprintf(stderr, "Failed to create code generator\n");
+        fclose(output);
+        remove(g_config.output_filename);
+        return 1;
+    }
+
+    printf("Generating code...\n");
+    codegen_write_headers(codegen);
+    double start = now_seconds();
+    size_t* lookups = &parser->ctx.symbols->lookups;
+    size_t generate_lookups = 0;
+    ASTNode* unit;
+    while ((unit = parser_parse_next(parser)) != NULL) {
+        if (error_count() == 0) {
+            size_t before = *lookups;
+            codegen_generate_declaration(codegen, unit);
+            generate_lookups += *lookups - before;
+        }
+        parser_release_unit(parser, unit);
+    }
+    print_recovery_stats(parser, now_seconds() - start);
+    print_lookup_stats(parser, *lookups - generate_lookups, generate_lookups);
+    codegen_check_forward_calls(codegen);
+    fclose(output);
+    codegen_destroy(codegen);
+
+    if (error_count() > 0) {
+        remove(g_config.output_filename);
+        fprintf(stderr, "Compilation failed with %d errors\n", error_count());
+        return 1;
+    }
+    printf("Compilation completed. Output written to %s\n", g_config.output_filename);
+    return 0;
+}
+
 int main(int argc, char** argv) {
     // Initialize configuration with defaults
     config_init();
@@ -76,11 +150,16 @@ int main(int argc, char** argv) {
 
     verbose_print("Creating lexer for file: %s\n", g_config.input_filename);
     // Create lexer
-    Lexer* lexer = lexer_create(g_config.input_filename);
+    Lexer* lexer = g_config.stream ? lexer_create_streamed(g_config.input_filename)
+                                   : lexer_create(g_config.input_filename);
     if (!lexer) {
         fprintf(stderr, "Failed to create lexer\n");
         return 1;
     }
+    error_set_source(lexer);
+    if (g_config.jobs > 1 && !g_config.stream && lexer_lex_parallel(lexer, g_config.jobs)) {
+        verbose_print("Lexed ahead on %d threads\n", g_config.jobs);
+    }
 
     verbose_print("Creating parser...\n");
     // Create parser
@@ -91,17 +170,30 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    if (g_config.stream) {
+        int status = translate_streaming(parser);
+        parser_destroy(parser);
+        lexer_destroy(lexer);
+        if (status == 0) {
+            config_cleanup();
+            logger_cleanup();
+        }
+        return status;
+    }
+
     verbose_print("Starting parsing...\n");
     // Parse input file
     debug_visualize_symbol_table(parser->ctx.symbols, "visualize/symbols_initial.dot");
+    double parse_start = now_seconds();
     ASTNode* ast = parser_parse(parser);
+    print_recovery_stats(parser, now_seconds() - parse_start);
+    size_t parse_lookups = parser->ctx.symbols->lookups;
     debug_visualize_symbol_table(parser->ctx.symbols, "visualize/symbols_post_parse.dot");
 
     verbose_print("Checking for errors...\n");
     // Check for errors before proceeding
     if (error_count() > 0) {
         fprintf(stderr, "Compilation failed with %d errors\n", error_count());
-        if (ast) ast_destroy_node(ast);
         parser_destroy(parser);
         lexer_destroy(lexer);
         return 1;
@@ -114,16 +206,45 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    if (g_config.print_stats) {
+        AstStats stats = parser_ast_stats(parser);
+        size_t total = stats.node_bytes + stats.child_bytes + stats.side_bytes +
+                       stats.bounds_bytes + stats.string_bytes;
+        // Records and locations used to be inline, so the side tables go too
+        size_t unpacked = total - stats.node_bytes - stats.side_bytes +
+                          stats.nodes * sizeof(AstUnpackedNode);
+        double per_node = stats.nodes ? (double)total / stats.nodes : 0.0;
+        double unpacked_per_node = stats.nodes ? (double)unpacked / stats.nodes : 0.0;
+        fprintf(stderr, "AST: %zu nodes of %zu bytes (%zu with payloads inline)\n", stats.nodes,
+                sizeof(ASTNode), sizeof(AstUnpackedNode));
+        fprintf(stderr, "  nodes       %10zu bytes\n", stats.node_bytes);
+        fprintf(stderr, "  children    %10zu bytes\n", stats.child_bytes);
+        fprintf(stderr, "  side tables %10zu bytes\n", stats.side_bytes);
+        fprintf(stderr, "  bounds      %10zu bytes\n", stats.bounds_bytes);
+        fprintf(stderr, "  strings     %10zu bytes\n", stats.string_bytes);
+        fprintf(stderr, "  total       %10zu bytes (%.1f per node, %.1f with payloads inline)\n",
+                total, per_node, unpacked_per_node);
+    }
+
     verbose_print("Parsing successful, visualizing AST...\n");
     debug_print_ast(ast, 0, false);
     debug_visualize_ast(ast, "visualize/ast.dot");
 
+    // Checking signatures needs no output file
+    if (g_config.check_signatures && !g_config.output_filename) {
+        printf("Signatures checked\n");
+        parser_destroy(parser);
+        lexer_destroy(lexer);
+        config_cleanup();
+        logger_cleanup();
+        return 0;
+    }
+
     verbose_print("Opening output file: %s\n", g_config.output_filename);
     // Open output file
     FILE* output = fopen(g_config.output_filename, "w");
     if (!output) {
         fprintf(stderr, "Failed to open output file: %s\n", g_config.output_filename);
-        ast_destroy_node(ast);
         parser_destroy(parser);
         lexer_destroy(lexer);
         return 1;
@@ -135,22 +256,26 @@ int main(int argc, char** argv) {
     if (!codegen) {
         fprintf(stderr, "Failed to create code generator\n");
         fclose(output);
-        ast_destroy_node(ast);
         parser_destroy(parser);
         lexer_destroy(lexer);
         return 1;
     }
 
-    printf("Generating code...\n");
-    // Generate code
-    codegen_generate(codegen, ast);
+    if (g_config.check_signatures) {
+        printf("Generating prototypes...\n");
+        codegen_generate_prototypes(codegen, ast);
+    } else {
+        printf("Generating code...\n");
+        // Generate code
+        codegen_generate(codegen, ast);
+    }
+    print_lookup_stats(parser, parse_lookups, parser->ctx.symbols->lookups - parse_lookups);
 
     verbose_print("Cleanup...\n");
     // Clean up
     fclose(output);
     codegen_destroy(codegen);
-    ast_destroy_node(ast);
-    parser_destroy(parser);
+    parser_destroy(parser);   // Frees the AST with its arena
     lexer_destroy(lexer);
 
 
@@ -0,0 +1,108 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include <stdint.h>
+
+#define ARENA_ALIGNMENT alignof(max_align_t)
+
+static size_t align_up(size_t size, size_t alignment) {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+// Bytes needed to bring the block's next free byte up to alignment
+static size_t padding_for(const ArenaBlock* block, size_t alignment) {
+    uintptr_t next = (uintptr_t)(block->data + block->used);
+    return (size_t)(((next + alignment - 1) & ~(uintptr_t)(alignment - 1)) - next);
+}
+
+void arena_init(Arena* arena, size_t block_size) {
+    arena->head = NULL;
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    arena->bytes_used = 0;
+    arena->block_count = 0;
+}
+
+static ArenaBlock* arena_new_block(Arena* arena, size_t min_size) {
+    size_t capacity = arena->block_size;
+    if (min_size > capacity) capacity = min_size;
+
+    ArenaBlock* block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + capacity);
+    if (!block) return NULL;
+
+    block->next = arena->head;
+    block->used = 0;
+    block->capacity = capacity;
+    arena->head = block;
+    arena->block_count++;
+    return block;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    return arena_alloc_aligned(arena, size, ARENA_ALIGNMENT);
+}
+
+void* arena_alloc_aligned(Arena* arena, size_t size, size_t alignment) {
+    size = align_up(size ? size : 1, alignment);
+
+    ArenaBlock* block = arena->head;
+    size_t offset = block ? padding_for(block, alignment) + block->used : 0;
+    if (!block || offset + size > block->capacity) {
+        block = arena_new_block(arena, size + alignment);
+        if (!block) return NULL;
+        offset = padding_for(block, alignment);
+    }
+
+    void* result = block->data + offset;
+    arena->bytes_used += offset + size - block->used;
+    block->used = offset + size;
+    return result;
+}
+
+char* arena_strndup(Arena* arena, const char* text, size_t length) {
+    // Strings don't need max alignment, so pack them into the current block
+    ArenaBlock* block = arena->head;
+    if (!block || block->capacity - block->used < length + 1) {
+        block = arena_new_block(arena, length + 1);
+        if (!block) return NULL;
+    }
+
+    char* copy = block->data + block->used;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    block->used += length + 1;
+    arena->bytes_used += length + 1;
+    return copy;
+}
+
+// Hand every block of from over to into, leaving from empty. New
+// allocations keep going to into's current block.
+void arena_merge(Arena* into, Arena* from) {
+    if (!from->head) return;
+    ArenaBlock* tail = from->head;
+    while (tail->next) tail = tail->next;
+
+    if (into->head) {
+        tail->next = into->head->next;
+        into->head->next = from->head;
+    } else {
+        into->head = from->head;
+    }
+    into->bytes_used += from->bytes_used;
+    into->block_count += from->block_count;
+    from->head = NULL;
+    from->bytes_used = 0;
+    from->block_count = 0;
+}
+
+void arena_release(Arena* arena) {
+    ArenaBlock* block = arena->head;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arena->bytes_used = 0;
+    arena->block_count = 0;
+}
@@ -0,0 +1,456 @@
+#include "lexer.h"
+#include "lexer_tables.h"
+#include "config.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Lexer table generator
+// Builds an NFA from the token spec below plus the keyword tables in
+// src/core/keywords.c, turns it into a DFA by subset construction and writes
+// the transition tables for every operator style as C source.
+//
+// Usage: lexgen <output.c>
+
+// Token spec
+// Fixed spellings, matched case-sensitively. Longest match wins, so "<"
+// and "<=" can both be listed.
+typedef struct {
+    const char* text;
+    TokenType type;
+    LexAction action;
+} LiteralRule;
+
+static const LiteralRule literals[] = {
+    {"(", TOK_LPAREN, LEX_ACTION_TOKEN},
+    {")", TOK_RPAREN, LEX_ACTION_TOKEN},
+    {"[", TOK_LBRACKET, LEX_ACTION_TOKEN},
+    {"]", TOK_RBRACKET, LEX_ACTION_TOKEN},
+    {",", TOK_COMMA, LEX_ACTION_TOKEN},
+    {";", TOK_SEMICOLON, LEX_ACTION_TOKEN},
+    {":", TOK_COLON, LEX_ACTION_TOKEN},
+    {":=", TOK_ASSIGN, LEX_ACTION_TOKEN},
+    {"=", TOK_EQ, LEX_ACTION_EQUALS},
+    {"==", TOK_EQ, LEX_ACTION_TOKEN},
+    {".", TOK_DOT, LEX_ACTION_TOKEN},
+    {"..", TOK_DOTDOT, LEX_ACTION_TOKEN},
+    {"...", TOK_DOTDOTDOT, LEX_ACTION_TOKEN},
+    {"+", TOK_PLUS, LEX_ACTION_TOKEN},
+    {"-", TOK_MINUS, LEX_ACTION_TOKEN},
+    {"->", TOK_ARROW, LEX_ACTION_TOKEN},
+    {"*", TOK_MULTIPLY, LEX_ACTION_STAR},
+    {"/", TOK_DIVIDE, LEX_ACTION_TOKEN},
+    {"%", TOK_MOD, LEX_ACTION_TOKEN},
+    {"<", TOK_LT, LEX_ACTION_TOKEN},
+    {"<=", TOK_LE, LEX_ACTION_TOKEN},
+    {"<<", TOK_LSHIFT, LEX_ACTION_TOKEN},
+    {">", TOK_GT, LEX_ACTION_TOKEN},
+    {">=", TOK_GE, LEX_ACTION_TOKEN},
+    {">>", TOK_RSHIFT, LEX_ACTION_TOKEN},
+    {"!", TOK_NOT, LEX_ACTION_TOKEN},
+    {"!=", TOK_NE, LEX_ACTION_TOKEN},
+    {"&", TOK_BITAND, LEX_ACTION_AMP},
+    {"&&", TOK_AND, LEX_ACTION_TOKEN},
+    {"|", TOK_BITOR, LEX_ACTION_TOKEN},
+    {"||", TOK_OR, LEX_ACTION_TOKEN},
+    {"^", TOK_BITXOR, LEX_ACTION_TOKEN},
+    {"~", TOK_BITNOT, LEX_ACTION_TOKEN},
+    {"@", TOK_AT, LEX_ACTION_TOKEN},
+    {"\"", TOK_STRING_LITERAL, LEX_ACTION_STRING},
+    {"in/out", TOK_INOUT, LEX_ACTION_TOKEN},  // Lowercase only, unlike the keyword table entry
+    {NULL, TOK_EOF, LEX_ACTION_NONE}
+};
+
+// Keywords made of letters are matched ignoring case and beat a plain
+// identifier of the same length. Dotted keywords (".and.") are matched
+// ignoring case too, but only count when no letter or '.' follows; the
+// scanner then falls back to a plain '.'.
+#define DOTTED_VETO "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz."
+
+// Patterns (built in add_patterns())
+//   identifier   [A-Za-z_][A-Za-z0-9_]*
+//   dimension    [0-9][dD]                 "2d array" specifier, an identifier
+//   decimal      [0-9]+
+//   hex          0[xX][0-9A-Fa-f]*
+//   octal        0[oO][0-7]*
+//   binary       0[bB][01]*
+//   real         [0-9]+\.[0-9]+[fF]? | [0-9]+[fF] | [0-9]+\. not followed by [A-Za-z.]
+
+enum { PRIORITY_FIXED = 1, PRIORITY_IDENTIFIER = 2 };
+
+#define MAX_NFA_STATES 4096
+#define MAX_DFA_STATES 4096
+#define SET_WORDS (MAX_NFA_STATES / 64)
+
+typedef struct {
+    uint64_t chars[4];
+    int to;
+} Edge;
+
+typedef struct {
+    Edge* edges;
+    int edge_count;
+    int edge_capacity;
+    uint16_t accept;
+    int priority;
+    bool has_veto;
+    uint64_t veto[4];
+} NfaState;
+
+typedef struct {
+    uint64_t members[SET_WORDS];
+    uint16_t accept;
+    bool has_veto;
+    uint64_t veto[4];
+} DfaState;
+
+static NfaState nfa[MAX_NFA_STATES];
+static int nfa_count;
+static DfaState dfa[MAX_DFA_STATES];
+static int dfa_count;
+static uint16_t transitions[MAX_DFA_STATES][256];
+
+static void fail(const char* message) {
+    fprintf(stderr, "lexgen: %s\n", message);
+    exit(1);
+}
+
+static int nfa_new(void) {
+    if (nfa_count == MAX_NFA_STATES) fail("too many NFA states");
+    memset(&nfa[nfa_count], 0, sizeof(NfaState));
+    return nfa_count++;
+}
+
+static void set_add(uint64_t* set, unsigned char c) {
+    set[c / 64] |= 1ull << (c % 64);
+}
+
+static bool set_has(const uint64_t* set, unsigned char c) {
+    return (set[c / 64] >> (c % 64)) & 1;
+}
+
+static void set_add_chars(uint64_t* set, const char* chars) {
+    for (; *chars; chars++) set_add(set, (unsigned char)*chars);
+}
+
+static void set_add_range(uint64_t* set, char first, char last) {
+    for (int c = (unsigned char)first; c <= (unsigned char)last; c++) set_add(set, (unsigned char)c);
+}
+
+static void nfa_edge(int from, const uint64_t* chars, int to) {
+    NfaState* state = &nfa[from];
+    if (state->edge_count == state->edge_capacity) {
+        state->edge_capacity = state->edge_capacity ? state->edge_capacity * 2 : 4;
+        state->edges = realloc(state->edges, state->edge_capacity * sizeof(Edge));
+        if (!state->edges) fail("out of memory");
+    }
+    Edge* edge = &state->edges[state->edge_count++];
+    memcpy(edge->chars, chars, sizeof(edge->chars));
+    edge->to = to;
+}
+
+static void nfa_edge_chars(int from, const char* chars, int to) {
+    uint64_t set[4] = {0};
+    set_add_chars(set, chars);
+    nfa_edge(from, set, to);
+}
+
+static void nfa_accept(int state, LexAction action, int value, int priority) {
+    nfa[state].accept = LEX_ACCEPT(action, value);
+    nfa[state].priority = priority;
+}
+
+// Chain of states spelling text from start; returns the final state
+static int add_spelling(int start, const char* text, bool fold_case) {
+    int state = start;
+    for (const char* p = text; *p; p++) {
+        uint64_t set[4] = {0};
+        set_add(set, (unsigned char)*p);
+        if (fold_case && *p >= 'a' && *p <= 'z') set_add(set, (unsigned char)(*p - 'a' + 'A'));
+        if (fold_case && *p >= 'A' && *p <= 'Z') set_add(set, (unsigned char)(*p - 'A' + 'a'));
+        int next = nfa_new();
+        nfa_edge(state, set, next);
+        state = next;
+    }
+    return state;
+}
+
+static bool is_word_keyword(const char* text) {
+    for (const char* p = text; *p; p++) {
+        bool word = (*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') ||
+                    (*p >= '0' && *p <= '9') || *p == '_';
+        if (!word) return false;
+    }
+    return true;
+}
+
+// Returns the identifier tail state
+static int add_patterns(int start) {
+    uint64_t letters[4] = {0}, word[4] = {0}, digits[4] = {0}, nonzero[4] = {0};
+    set_add_range(letters, 'a', 'z');
+    set_add_range(letters, 'A', 'Z');
+    set_add(letters, '_');
+    memcpy(word, letters, sizeof(word));
+    set_add_range(word, '0', '9');
+    set_add_range(digits, '0', '9');
+    set_add_range(nonzero, '1', '9');
+
+    int identifier = nfa_new();
+    nfa_edge(start, letters, identifier);
+    nfa_edge(identifier, word, identifier);
+    nfa_accept(identifier, LEX_ACTION_TOKEN, TOK_IDENTIFIER, PRIORITY_IDENTIFIER);
+
+    // The first digit is special: it can start a prefix or a "2d" specifier
+    int zero = nfa_new();
+    int first = nfa_new();
+    int more = nfa_new();
+    int point = nfa_new();
+    int fraction = nfa_new();
+    int suffix = nfa_new();
+    int dimension = nfa_new();
+    nfa_edge_chars(start, "0", zero);
+    nfa_edge(start, nonzero, first);
+    for (int i = 0; i < 2; i++) {
+        int state = i ? first : zero;
+        nfa_edge(state, digits, more);
+        nfa_edge_chars(state, "dD", dimension);
+        nfa_edge_chars(state, ".", point);
+        nfa_edge_chars(state, "fF", suffix);
+        nfa_accept(state, LEX_ACTION_NUMBER, NUMBER_DECIMAL, PRIORITY_FIXED);
+    }
+    nfa_edge(more, digits, more);
+    nfa_edge_chars(more, ".", point);
+    nfa_edge_chars(more, "fF", suffix);
+    nfa_accept(more, LEX_ACTION_NUMBER, NUMBER_DECIMAL, PRIORITY_FIXED);
+
+    nfa_edge(point, digits, fraction);
+    nfa_accept(point, LEX_ACTION_NUMBER, NUMBER_REAL, PRIORITY_FIXED);
+    nfa[point].has_veto = true;
+    set_add_chars(nfa[point].veto, DOTTED_VETO);
+
+    nfa_edge(fraction, digits, fraction);
+    nfa_edge_chars(fraction, "fF", suffix);
+    nfa_accept(fraction, LEX_ACTION_NUMBER, NUMBER_REAL, PRIORITY_FIXED);
+    nfa_accept(suffix, LEX_ACTION_NUMBER, NUMBER_REAL, PRIORITY_FIXED);
+    nfa_accept(dimension, LEX_ACTION_TOKEN, TOK_IDENTIFIER, PRIORITY_FIXED);
+
+    static const struct {
+        const char* prefix;
+        const char* digits;
+        NumberKind kind;
+    } prefixed[] = {
+        {"xX", "0123456789abcdefABCDEF", NUMBER_HEX},
+        {"oO", "01234567", NUMBER_OCTAL},
+        {"bB", "01", NUMBER_BINARY},
+    };
+    for (size_t i = 0; i < sizeof(prefixed) / sizeof(prefixed[0]); i++) {
+        int state = nfa_new();
+        nfa_edge_chars(zero, prefixed[i].prefix, state);
+        nfa_edge_chars(state, prefixed[i].digits, state);
+        nfa_accept(state, LEX_ACTION_NUMBER, prefixed[i].kind, PRIORITY_FIXED);
+    }
+
+    return identifier;
+}
+
+static void add_keywords(int start, const Keyword* table) {
+    for (const Keyword* k = table; k->text != NULL; k++) {
+        if (k->text[0] == '.') {
+            int state = add_spelling(start, k->text, true);
+            nfa_accept(state, LEX_ACTION_TEXT, k->type, PRIORITY_FIXED);
+            nfa[state].has_veto = true;
+            set_add_chars(nfa[state].veto, DOTTED_VETO);
+        } else if (is_word_keyword(k->text)) {
+            int state = add_spelling(start, k->text, true);
+            nfa_accept(state, LEX_ACTION_TOKEN, k->type, PRIORITY_FIXED);
+        }
+        // Anything else ("in/out") is spelled out in literals[]
+    }
+}
+
+static void add_literals(int start) {
+    for (const LiteralRule* rule = literals; rule->text != NULL; rule++) {
+        int state = add_spelling(start, rule->text, false);
+        nfa_accept(state, rule->action, rule->type, PRIORITY_FIXED);
+    }
+}
+
+static void dfa_settle(DfaState* state) {
+    int best = -1;
+    for (int i = 0; i < nfa_count; i++) {
+        if (!((state->members[i / 64] >> (i % 64)) & 1) || !nfa[i].accept) continue;
+        if (best < 0 || nfa[i].priority < nfa[best].priority) {
+            best = i;
+        } else if (nfa[i].priority == nfa[best].priority && nfa[i].accept != nfa[best].accept) {
+            fail("two rules match the same text with the same priority");
+        }
+    }
+    state->accept = best >= 0 ? nfa[best].accept : 0;
+    state->has_veto = best >= 0 && nfa[best].has_veto;
+    if (state->has_veto) memcpy(state->veto, nfa[best].veto, sizeof(state->veto));
+}
+
+static int dfa_find_or_add(const uint64_t* members) {
+    for (int i = LEX_STATE_START; i < dfa_count; i++) {
+        if (memcmp(dfa[i].members, members, sizeof(dfa[i].members)) == 0) return i;
+    }
+    if (dfa_count == MAX_DFA_STATES) fail("too many DFA states");
+    DfaState* state = &dfa[dfa_count];
+    memcpy(state->members, members, sizeof(state->members));
+    dfa_settle(state);
+    return dfa_count++;
+}
+
+static void build_dfa(int nfa_start) {
+    memset(dfa, 0, sizeof(DfaState) * LEX_STATE_START);
+    dfa_count = LEX_STATE_START;
+
+    uint64_t members[SET_WORDS] = {0};
+    members[nfa_start / 64] |= 1ull << (nfa_start % 64);
+    dfa_find_or_add(members);
+
+    memset(transitions, 0, sizeof(uint16_t) * 256 * LEX_STATE_START);
+    for (int s = LEX_STATE_START; s < dfa_count; s++) {
+        for (int c = 0; c < 256; c++) {
+            memset(members, 0, sizeof(members));
+            bool any = false;
+            for (int i = 0; i < nfa_count; i++) {
+                if (!((dfa[s].members[i / 64] >> (i % 64)) & 1)) continue;
+                for (int e = 0; e < nfa[i].edge_count; e++) {
+                    if (set_has(nfa[i].edges[e].chars, (unsigned char)c)) {
+                        int to = nfa[i].edges[e].to;
+                        members[to / 64] |= 1ull << (to % 64);
+                        any = true;
+                    }
+                }
+            }
+            if (dfa[s].has_veto && set_has(dfa[s].veto, (unsigned char)c)) {
+                if (any) fail("a vetoed match can also continue");
+                transitions[s][c] = LEX_STATE_VETO;
+            } else {
+                transitions[s][c] = any ? (uint16_t)dfa_find_or_add(members) : LEX_STATE_DEAD;
+            }
+        }
+    }
+}
+
+// Bytes that behave the same in every state share a class
+static int build_classes(uint8_t* classes, int* representatives) {
+    int class_count = 0;
+    for (int c = 0; c < 256; c++) {
+        int found = -1;
+        for (int k = 0; k < class_count && found < 0; k++) {
+            int r = representatives[k];
+            bool same = true;
+            for (int s = LEX_STATE_START; s < dfa_count && same; s++) {
+                same = transitions[s][c] == transitions[s][r];
+            }
+            if (same) found = k;
+        }
+        if (found < 0) {
+            found = class_count;
+            representatives[class_count++] = c;
+        }
+        classes[c] = (uint8_t)found;
+    }
+    return class_count;
+}
+
+static void write_tables(FILE* out, const char* name, const Keyword* table) {
+    for (int i = 0; i < nfa_count; i++) free(nfa[i].edges);
+    nfa_count = 0;
+
+    int start = nfa_new();
+    add_literals(start);
+    add_keywords(start, table);
+    int identifier = add_patterns(start);
+    build_dfa(start);
+
+    uint8_t classes[256];
+    int representatives[256];
+    int class_count = build_classes(classes, representatives);
+
+    uint64_t tail[SET_WORDS] = {0};
+    tail[identifier / 64] |= 1ull << (identifier % 64);
+    int identifier_tail = LEX_STATE_DEAD;
+    for (int s = LEX_STATE_START; s < dfa_count; s++) {
+        if (memcmp(dfa[s].members, tail, sizeof(tail)) == 0) identifier_tail = s;
+    }
+
+    fprintf(out, "\n// %s: %d states, %d classes\n", name, dfa_count, class_count);
+    fprintf(out, "static const uint8_t %s_classes[256] = {", name);
+    for (int c = 0; c < 256; c++) {
+        fprintf(out, "%s%d,", c % 16 ? " " : "\n    ", classes[c]);
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "static const uint16_t %s_transitions[%d] = {", name, dfa_count * class_count);
+    for (int s = 0; s < dfa_count; s++) {
+        fprintf(out, "\n   ");
+        for (int k = 0; k < class_count; k++) {
+            fprintf(out, " %d,", transitions[s][representatives[k]]);
+        }
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "static const uint16_t %s_accepts[%d] = {", name, dfa_count);
+    for (int s = 0; s < dfa_count; s++) {
+        fprintf(out, "%s0x%04x,", s % 8 ? " " : "\n    ", dfa[s].accept);
+    }
+    fprintf(out, "\n};\n");
+
+    fprintf(stderr, "lexgen: %s: %d states, %d classes, %zu bytes\n", name, dfa_count, class_count,
+            256 + (size_t)dfa_count * class_count * sizeof(uint16_t) + dfa_count * sizeof(uint16_t));
+    if (identifier_tail == LEX_STATE_DEAD) fail("no plain identifier state");
+    fprintf(out, "#define %s_identifier_tail %d\n", name, identifier_tail);
+    fprintf(out, "#define %s_state_count %d\n", name, dfa_count);
+    fprintf(out, "#define %s_class_count %d\n", name, class_count);
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <output.c>\n", argv[0]);
+        return 1;
+    }
+    FILE* out = fopen(argv[1], "w");
+    if (!out) {
+        fprintf(stderr, "lexgen: could not create %s\n", argv[1]);
+        return 1;
+    }
+
+    static const struct {
+        const char* name;
+        OperatorStyle style;
+        const Keyword* table;
+    } styles[] = {
+        {"standard", OP_STYLE_STANDARD, keywords_standard},
+        {"dotted", OP_STYLE_DOTTED, keywords_dotted},
+        {"mixed", OP_STYLE_MIXED, keywords_mixed},
+    };
+    size_t style_count = sizeof(styles) / sizeof(styles[0]);
+
+    fprintf(out, "// Generated by tools/lexgen.c. Do not edit.\n\n");
+    fprintf(out, "#include \"lexer_tables.h\"\n#include \"config.h\"\n");
+    for (size_t i = 0; i < style_count; i++) {
+        write_tables(out, styles[i].name, styles[i].table);
+    }
+
+    fprintf(out, "\nconst LexerTables lexer_tables[] = {\n");
+    for (size_t i = 0; i < style_count; i++) {
+        const char* name = styles[i].name;
+        fprintf(out, "    [%s] = {\"%s\", %s_state_count, %s_class_count, %s_identifier_tail,\n"
+                     "        %s_classes, %s_transitions, %s_accepts},\n",
+                styles[i].style == OP_STYLE_STANDARD ? "OP_STYLE_STANDARD" :
+                styles[i].style == OP_STYLE_DOTTED ? "OP_STYLE_DOTTED" : "OP_STYLE_MIXED",
+                name, name, name, name, name, name, name);
+    }
+    fprintf(out, "};\n");
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "lexgen: could not write %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}